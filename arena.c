@@ -0,0 +1,138 @@
+/* arena - bump allocator for the data of one SII image
+ */
+
+#include "arena.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define ARENA_BLOCK_SIZE  (16*1024)
+#define ARENA_ALIGN       16
+
+struct _arena_block {
+	struct _arena_block *next;
+	size_t size;
+	size_t used;
+	unsigned char *data;
+};
+
+struct _arena {
+	struct _arena_block *head;
+	struct _arena_block *current; /* blocks before are full */
+	void *last; /* last allocation, can grow in place */
+};
+
+static size_t align_offset(const struct _arena_block *b)
+{
+	uintptr_t p = (uintptr_t)(b->data + b->used);
+	return b->used + ((ARENA_ALIGN - (p % ARENA_ALIGN)) % ARENA_ALIGN);
+}
+
+static struct _arena_block *block_new(size_t size)
+{
+	struct _arena_block *b = malloc(sizeof(struct _arena_block) + size);
+	if (b == NULL)
+		return NULL;
+
+	b->next = NULL;
+	b->size = size;
+	b->used = 0;
+	b->data = (unsigned char *)(b + 1);
+
+	return b;
+}
+
+Arena *arena_new(void)
+{
+	return calloc(1, sizeof(Arena));
+}
+
+void arena_free(Arena *arena)
+{
+	if (arena == NULL)
+		return;
+
+	struct _arena_block *b = arena->head;
+	while (b != NULL) {
+		struct _arena_block *next = b->next;
+		free(b);
+		b = next;
+	}
+
+	free(arena);
+}
+
+void arena_reset(Arena *arena)
+{
+	for (struct _arena_block *b = arena->head; b; b = b->next)
+		b->used = 0;
+
+	arena->current = arena->head;
+	arena->last = NULL;
+}
+
+void *arena_alloc(Arena *arena, size_t size)
+{
+	struct _arena_block *b;
+	struct _arena_block *prev = NULL;
+	size_t offset = 0;
+
+	/* skip blocks too small for this allocation, after a reset these are
+	 * the smaller blocks of the first round */
+	for (b = arena->current; b; prev = b, b = b->next) {
+		offset = align_offset(b);
+		if (offset <= b->size && size <= b->size - offset)
+			break;
+	}
+
+	if (b == NULL) {
+		size_t blocksize = ARENA_BLOCK_SIZE;
+		while (blocksize < size + ARENA_ALIGN)
+			blocksize *= 2;
+
+		b = block_new(blocksize);
+		if (b == NULL)
+			return NULL;
+
+		if (prev != NULL)
+			prev->next = b;
+		else
+			arena->head = b;
+
+		offset = align_offset(b);
+	}
+
+	arena->current = b;
+	b->used = offset + size;
+
+	void *ptr = b->data + offset;
+	memset(ptr, 0, size);
+
+	arena->last = ptr;
+
+	return ptr;
+}
+
+void *arena_realloc(Arena *arena, void *ptr, size_t oldsize, size_t size)
+{
+	if (ptr == NULL)
+		return arena_alloc(arena, size);
+
+	if (size <= oldsize)
+		return ptr;
+
+	struct _arena_block *b = arena->current;
+	if (ptr == arena->last && b != NULL &&
+	    (unsigned char *)ptr + size <= b->data + b->size) {
+		memset((unsigned char *)ptr + oldsize, 0, size - oldsize);
+		b->used = (size_t)((unsigned char *)ptr - b->data) + size;
+		return ptr;
+	}
+
+	void *new = arena_alloc(arena, size);
+	if (new != NULL)
+		memcpy(new, ptr, oldsize);
+
+	return new;
+}
@@ -0,0 +1,28 @@
+/* arena - bump allocator for the data of one SII image
+ *
+ * All allocations are released at once with arena_reset() or arena_free(),
+ * there is no free() of single allocations. After a reset the blocks are
+ * reused, so building images of similar size doesn't call malloc() anymore.
+ */
+
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+
+typedef struct _arena Arena;
+
+Arena *arena_new(void);
+void arena_free(Arena *arena);
+
+/* release all allocations, the memory is kept for the next ones */
+void arena_reset(Arena *arena);
+
+/* zero initialized memory, NULL if out of memory */
+void *arena_alloc(Arena *arena, size_t size);
+
+/* like realloc(), grows in place if ptr is the last allocation, otherwise
+ * the old memory is only reclaimed by the next reset */
+void *arena_realloc(Arena *arena, void *ptr, size_t oldsize, size_t size);
+
+#endif /* ARENA_H */
@@ -4,34 +4,260 @@
 #define POLYNOM   0x07
 #define MSB        0x80  /* this is byte specific */
 
+/* crc8_table[0] is the CRC of one byte, crc8_table[k][b] is crc8_table[0]
+ * applied k more times, i.e. the contribution of byte b followed by k zero
+ * bytes. Generated from POLYNOM. */
+static const uint8_t crc8_table[8][256] = {
+	{
+		0x00, 0x07, 0x0e, 0x09, 0x1c, 0x1b, 0x12, 0x15, 0x38, 0x3f, 0x36, 0x31,
+		0x24, 0x23, 0x2a, 0x2d, 0x70, 0x77, 0x7e, 0x79, 0x6c, 0x6b, 0x62, 0x65,
+		0x48, 0x4f, 0x46, 0x41, 0x54, 0x53, 0x5a, 0x5d, 0xe0, 0xe7, 0xee, 0xe9,
+		0xfc, 0xfb, 0xf2, 0xf5, 0xd8, 0xdf, 0xd6, 0xd1, 0xc4, 0xc3, 0xca, 0xcd,
+		0x90, 0x97, 0x9e, 0x99, 0x8c, 0x8b, 0x82, 0x85, 0xa8, 0xaf, 0xa6, 0xa1,
+		0xb4, 0xb3, 0xba, 0xbd, 0xc7, 0xc0, 0xc9, 0xce, 0xdb, 0xdc, 0xd5, 0xd2,
+		0xff, 0xf8, 0xf1, 0xf6, 0xe3, 0xe4, 0xed, 0xea, 0xb7, 0xb0, 0xb9, 0xbe,
+		0xab, 0xac, 0xa5, 0xa2, 0x8f, 0x88, 0x81, 0x86, 0x93, 0x94, 0x9d, 0x9a,
+		0x27, 0x20, 0x29, 0x2e, 0x3b, 0x3c, 0x35, 0x32, 0x1f, 0x18, 0x11, 0x16,
+		0x03, 0x04, 0x0d, 0x0a, 0x57, 0x50, 0x59, 0x5e, 0x4b, 0x4c, 0x45, 0x42,
+		0x6f, 0x68, 0x61, 0x66, 0x73, 0x74, 0x7d, 0x7a, 0x89, 0x8e, 0x87, 0x80,
+		0x95, 0x92, 0x9b, 0x9c, 0xb1, 0xb6, 0xbf, 0xb8, 0xad, 0xaa, 0xa3, 0xa4,
+		0xf9, 0xfe, 0xf7, 0xf0, 0xe5, 0xe2, 0xeb, 0xec, 0xc1, 0xc6, 0xcf, 0xc8,
+		0xdd, 0xda, 0xd3, 0xd4, 0x69, 0x6e, 0x67, 0x60, 0x75, 0x72, 0x7b, 0x7c,
+		0x51, 0x56, 0x5f, 0x58, 0x4d, 0x4a, 0x43, 0x44, 0x19, 0x1e, 0x17, 0x10,
+		0x05, 0x02, 0x0b, 0x0c, 0x21, 0x26, 0x2f, 0x28, 0x3d, 0x3a, 0x33, 0x34,
+		0x4e, 0x49, 0x40, 0x47, 0x52, 0x55, 0x5c, 0x5b, 0x76, 0x71, 0x78, 0x7f,
+		0x6a, 0x6d, 0x64, 0x63, 0x3e, 0x39, 0x30, 0x37, 0x22, 0x25, 0x2c, 0x2b,
+		0x06, 0x01, 0x08, 0x0f, 0x1a, 0x1d, 0x14, 0x13, 0xae, 0xa9, 0xa0, 0xa7,
+		0xb2, 0xb5, 0xbc, 0xbb, 0x96, 0x91, 0x98, 0x9f, 0x8a, 0x8d, 0x84, 0x83,
+		0xde, 0xd9, 0xd0, 0xd7, 0xc2, 0xc5, 0xcc, 0xcb, 0xe6, 0xe1, 0xe8, 0xef,
+		0xfa, 0xfd, 0xf4, 0xf3
+	},
+	{
+		0x00, 0x15, 0x2a, 0x3f, 0x54, 0x41, 0x7e, 0x6b, 0xa8, 0xbd, 0x82, 0x97,
+		0xfc, 0xe9, 0xd6, 0xc3, 0x57, 0x42, 0x7d, 0x68, 0x03, 0x16, 0x29, 0x3c,
+		0xff, 0xea, 0xd5, 0xc0, 0xab, 0xbe, 0x81, 0x94, 0xae, 0xbb, 0x84, 0x91,
+		0xfa, 0xef, 0xd0, 0xc5, 0x06, 0x13, 0x2c, 0x39, 0x52, 0x47, 0x78, 0x6d,
+		0xf9, 0xec, 0xd3, 0xc6, 0xad, 0xb8, 0x87, 0x92, 0x51, 0x44, 0x7b, 0x6e,
+		0x05, 0x10, 0x2f, 0x3a, 0x5b, 0x4e, 0x71, 0x64, 0x0f, 0x1a, 0x25, 0x30,
+		0xf3, 0xe6, 0xd9, 0xcc, 0xa7, 0xb2, 0x8d, 0x98, 0x0c, 0x19, 0x26, 0x33,
+		0x58, 0x4d, 0x72, 0x67, 0xa4, 0xb1, 0x8e, 0x9b, 0xf0, 0xe5, 0xda, 0xcf,
+		0xf5, 0xe0, 0xdf, 0xca, 0xa1, 0xb4, 0x8b, 0x9e, 0x5d, 0x48, 0x77, 0x62,
+		0x09, 0x1c, 0x23, 0x36, 0xa2, 0xb7, 0x88, 0x9d, 0xf6, 0xe3, 0xdc, 0xc9,
+		0x0a, 0x1f, 0x20, 0x35, 0x5e, 0x4b, 0x74, 0x61, 0xb6, 0xa3, 0x9c, 0x89,
+		0xe2, 0xf7, 0xc8, 0xdd, 0x1e, 0x0b, 0x34, 0x21, 0x4a, 0x5f, 0x60, 0x75,
+		0xe1, 0xf4, 0xcb, 0xde, 0xb5, 0xa0, 0x9f, 0x8a, 0x49, 0x5c, 0x63, 0x76,
+		0x1d, 0x08, 0x37, 0x22, 0x18, 0x0d, 0x32, 0x27, 0x4c, 0x59, 0x66, 0x73,
+		0xb0, 0xa5, 0x9a, 0x8f, 0xe4, 0xf1, 0xce, 0xdb, 0x4f, 0x5a, 0x65, 0x70,
+		0x1b, 0x0e, 0x31, 0x24, 0xe7, 0xf2, 0xcd, 0xd8, 0xb3, 0xa6, 0x99, 0x8c,
+		0xed, 0xf8, 0xc7, 0xd2, 0xb9, 0xac, 0x93, 0x86, 0x45, 0x50, 0x6f, 0x7a,
+		0x11, 0x04, 0x3b, 0x2e, 0xba, 0xaf, 0x90, 0x85, 0xee, 0xfb, 0xc4, 0xd1,
+		0x12, 0x07, 0x38, 0x2d, 0x46, 0x53, 0x6c, 0x79, 0x43, 0x56, 0x69, 0x7c,
+		0x17, 0x02, 0x3d, 0x28, 0xeb, 0xfe, 0xc1, 0xd4, 0xbf, 0xaa, 0x95, 0x80,
+		0x14, 0x01, 0x3e, 0x2b, 0x40, 0x55, 0x6a, 0x7f, 0xbc, 0xa9, 0x96, 0x83,
+		0xe8, 0xfd, 0xc2, 0xd7
+	},
+	{
+		0x00, 0x6b, 0xd6, 0xbd, 0xab, 0xc0, 0x7d, 0x16, 0x51, 0x3a, 0x87, 0xec,
+		0xfa, 0x91, 0x2c, 0x47, 0xa2, 0xc9, 0x74, 0x1f, 0x09, 0x62, 0xdf, 0xb4,
+		0xf3, 0x98, 0x25, 0x4e, 0x58, 0x33, 0x8e, 0xe5, 0x43, 0x28, 0x95, 0xfe,
+		0xe8, 0x83, 0x3e, 0x55, 0x12, 0x79, 0xc4, 0xaf, 0xb9, 0xd2, 0x6f, 0x04,
+		0xe1, 0x8a, 0x37, 0x5c, 0x4a, 0x21, 0x9c, 0xf7, 0xb0, 0xdb, 0x66, 0x0d,
+		0x1b, 0x70, 0xcd, 0xa6, 0x86, 0xed, 0x50, 0x3b, 0x2d, 0x46, 0xfb, 0x90,
+		0xd7, 0xbc, 0x01, 0x6a, 0x7c, 0x17, 0xaa, 0xc1, 0x24, 0x4f, 0xf2, 0x99,
+		0x8f, 0xe4, 0x59, 0x32, 0x75, 0x1e, 0xa3, 0xc8, 0xde, 0xb5, 0x08, 0x63,
+		0xc5, 0xae, 0x13, 0x78, 0x6e, 0x05, 0xb8, 0xd3, 0x94, 0xff, 0x42, 0x29,
+		0x3f, 0x54, 0xe9, 0x82, 0x67, 0x0c, 0xb1, 0xda, 0xcc, 0xa7, 0x1a, 0x71,
+		0x36, 0x5d, 0xe0, 0x8b, 0x9d, 0xf6, 0x4b, 0x20, 0x0b, 0x60, 0xdd, 0xb6,
+		0xa0, 0xcb, 0x76, 0x1d, 0x5a, 0x31, 0x8c, 0xe7, 0xf1, 0x9a, 0x27, 0x4c,
+		0xa9, 0xc2, 0x7f, 0x14, 0x02, 0x69, 0xd4, 0xbf, 0xf8, 0x93, 0x2e, 0x45,
+		0x53, 0x38, 0x85, 0xee, 0x48, 0x23, 0x9e, 0xf5, 0xe3, 0x88, 0x35, 0x5e,
+		0x19, 0x72, 0xcf, 0xa4, 0xb2, 0xd9, 0x64, 0x0f, 0xea, 0x81, 0x3c, 0x57,
+		0x41, 0x2a, 0x97, 0xfc, 0xbb, 0xd0, 0x6d, 0x06, 0x10, 0x7b, 0xc6, 0xad,
+		0x8d, 0xe6, 0x5b, 0x30, 0x26, 0x4d, 0xf0, 0x9b, 0xdc, 0xb7, 0x0a, 0x61,
+		0x77, 0x1c, 0xa1, 0xca, 0x2f, 0x44, 0xf9, 0x92, 0x84, 0xef, 0x52, 0x39,
+		0x7e, 0x15, 0xa8, 0xc3, 0xd5, 0xbe, 0x03, 0x68, 0xce, 0xa5, 0x18, 0x73,
+		0x65, 0x0e, 0xb3, 0xd8, 0x9f, 0xf4, 0x49, 0x22, 0x34, 0x5f, 0xe2, 0x89,
+		0x6c, 0x07, 0xba, 0xd1, 0xc7, 0xac, 0x11, 0x7a, 0x3d, 0x56, 0xeb, 0x80,
+		0x96, 0xfd, 0x40, 0x2b
+	},
+	{
+		0x00, 0x16, 0x2c, 0x3a, 0x58, 0x4e, 0x74, 0x62, 0xb0, 0xa6, 0x9c, 0x8a,
+		0xe8, 0xfe, 0xc4, 0xd2, 0x67, 0x71, 0x4b, 0x5d, 0x3f, 0x29, 0x13, 0x05,
+		0xd7, 0xc1, 0xfb, 0xed, 0x8f, 0x99, 0xa3, 0xb5, 0xce, 0xd8, 0xe2, 0xf4,
+		0x96, 0x80, 0xba, 0xac, 0x7e, 0x68, 0x52, 0x44, 0x26, 0x30, 0x0a, 0x1c,
+		0xa9, 0xbf, 0x85, 0x93, 0xf1, 0xe7, 0xdd, 0xcb, 0x19, 0x0f, 0x35, 0x23,
+		0x41, 0x57, 0x6d, 0x7b, 0x9b, 0x8d, 0xb7, 0xa1, 0xc3, 0xd5, 0xef, 0xf9,
+		0x2b, 0x3d, 0x07, 0x11, 0x73, 0x65, 0x5f, 0x49, 0xfc, 0xea, 0xd0, 0xc6,
+		0xa4, 0xb2, 0x88, 0x9e, 0x4c, 0x5a, 0x60, 0x76, 0x14, 0x02, 0x38, 0x2e,
+		0x55, 0x43, 0x79, 0x6f, 0x0d, 0x1b, 0x21, 0x37, 0xe5, 0xf3, 0xc9, 0xdf,
+		0xbd, 0xab, 0x91, 0x87, 0x32, 0x24, 0x1e, 0x08, 0x6a, 0x7c, 0x46, 0x50,
+		0x82, 0x94, 0xae, 0xb8, 0xda, 0xcc, 0xf6, 0xe0, 0x31, 0x27, 0x1d, 0x0b,
+		0x69, 0x7f, 0x45, 0x53, 0x81, 0x97, 0xad, 0xbb, 0xd9, 0xcf, 0xf5, 0xe3,
+		0x56, 0x40, 0x7a, 0x6c, 0x0e, 0x18, 0x22, 0x34, 0xe6, 0xf0, 0xca, 0xdc,
+		0xbe, 0xa8, 0x92, 0x84, 0xff, 0xe9, 0xd3, 0xc5, 0xa7, 0xb1, 0x8b, 0x9d,
+		0x4f, 0x59, 0x63, 0x75, 0x17, 0x01, 0x3b, 0x2d, 0x98, 0x8e, 0xb4, 0xa2,
+		0xc0, 0xd6, 0xec, 0xfa, 0x28, 0x3e, 0x04, 0x12, 0x70, 0x66, 0x5c, 0x4a,
+		0xaa, 0xbc, 0x86, 0x90, 0xf2, 0xe4, 0xde, 0xc8, 0x1a, 0x0c, 0x36, 0x20,
+		0x42, 0x54, 0x6e, 0x78, 0xcd, 0xdb, 0xe1, 0xf7, 0x95, 0x83, 0xb9, 0xaf,
+		0x7d, 0x6b, 0x51, 0x47, 0x25, 0x33, 0x09, 0x1f, 0x64, 0x72, 0x48, 0x5e,
+		0x3c, 0x2a, 0x10, 0x06, 0xd4, 0xc2, 0xf8, 0xee, 0x8c, 0x9a, 0xa0, 0xb6,
+		0x03, 0x15, 0x2f, 0x39, 0x5b, 0x4d, 0x77, 0x61, 0xb3, 0xa5, 0x9f, 0x89,
+		0xeb, 0xfd, 0xc7, 0xd1
+	},
+	{
+		0x00, 0x62, 0xc4, 0xa6, 0x8f, 0xed, 0x4b, 0x29, 0x19, 0x7b, 0xdd, 0xbf,
+		0x96, 0xf4, 0x52, 0x30, 0x32, 0x50, 0xf6, 0x94, 0xbd, 0xdf, 0x79, 0x1b,
+		0x2b, 0x49, 0xef, 0x8d, 0xa4, 0xc6, 0x60, 0x02, 0x64, 0x06, 0xa0, 0xc2,
+		0xeb, 0x89, 0x2f, 0x4d, 0x7d, 0x1f, 0xb9, 0xdb, 0xf2, 0x90, 0x36, 0x54,
+		0x56, 0x34, 0x92, 0xf0, 0xd9, 0xbb, 0x1d, 0x7f, 0x4f, 0x2d, 0x8b, 0xe9,
+		0xc0, 0xa2, 0x04, 0x66, 0xc8, 0xaa, 0x0c, 0x6e, 0x47, 0x25, 0x83, 0xe1,
+		0xd1, 0xb3, 0x15, 0x77, 0x5e, 0x3c, 0x9a, 0xf8, 0xfa, 0x98, 0x3e, 0x5c,
+		0x75, 0x17, 0xb1, 0xd3, 0xe3, 0x81, 0x27, 0x45, 0x6c, 0x0e, 0xa8, 0xca,
+		0xac, 0xce, 0x68, 0x0a, 0x23, 0x41, 0xe7, 0x85, 0xb5, 0xd7, 0x71, 0x13,
+		0x3a, 0x58, 0xfe, 0x9c, 0x9e, 0xfc, 0x5a, 0x38, 0x11, 0x73, 0xd5, 0xb7,
+		0x87, 0xe5, 0x43, 0x21, 0x08, 0x6a, 0xcc, 0xae, 0x97, 0xf5, 0x53, 0x31,
+		0x18, 0x7a, 0xdc, 0xbe, 0x8e, 0xec, 0x4a, 0x28, 0x01, 0x63, 0xc5, 0xa7,
+		0xa5, 0xc7, 0x61, 0x03, 0x2a, 0x48, 0xee, 0x8c, 0xbc, 0xde, 0x78, 0x1a,
+		0x33, 0x51, 0xf7, 0x95, 0xf3, 0x91, 0x37, 0x55, 0x7c, 0x1e, 0xb8, 0xda,
+		0xea, 0x88, 0x2e, 0x4c, 0x65, 0x07, 0xa1, 0xc3, 0xc1, 0xa3, 0x05, 0x67,
+		0x4e, 0x2c, 0x8a, 0xe8, 0xd8, 0xba, 0x1c, 0x7e, 0x57, 0x35, 0x93, 0xf1,
+		0x5f, 0x3d, 0x9b, 0xf9, 0xd0, 0xb2, 0x14, 0x76, 0x46, 0x24, 0x82, 0xe0,
+		0xc9, 0xab, 0x0d, 0x6f, 0x6d, 0x0f, 0xa9, 0xcb, 0xe2, 0x80, 0x26, 0x44,
+		0x74, 0x16, 0xb0, 0xd2, 0xfb, 0x99, 0x3f, 0x5d, 0x3b, 0x59, 0xff, 0x9d,
+		0xb4, 0xd6, 0x70, 0x12, 0x22, 0x40, 0xe6, 0x84, 0xad, 0xcf, 0x69, 0x0b,
+		0x09, 0x6b, 0xcd, 0xaf, 0x86, 0xe4, 0x42, 0x20, 0x10, 0x72, 0xd4, 0xb6,
+		0x9f, 0xfd, 0x5b, 0x39
+	},
+	{
+		0x00, 0x29, 0x52, 0x7b, 0xa4, 0x8d, 0xf6, 0xdf, 0x4f, 0x66, 0x1d, 0x34,
+		0xeb, 0xc2, 0xb9, 0x90, 0x9e, 0xb7, 0xcc, 0xe5, 0x3a, 0x13, 0x68, 0x41,
+		0xd1, 0xf8, 0x83, 0xaa, 0x75, 0x5c, 0x27, 0x0e, 0x3b, 0x12, 0x69, 0x40,
+		0x9f, 0xb6, 0xcd, 0xe4, 0x74, 0x5d, 0x26, 0x0f, 0xd0, 0xf9, 0x82, 0xab,
+		0xa5, 0x8c, 0xf7, 0xde, 0x01, 0x28, 0x53, 0x7a, 0xea, 0xc3, 0xb8, 0x91,
+		0x4e, 0x67, 0x1c, 0x35, 0x76, 0x5f, 0x24, 0x0d, 0xd2, 0xfb, 0x80, 0xa9,
+		0x39, 0x10, 0x6b, 0x42, 0x9d, 0xb4, 0xcf, 0xe6, 0xe8, 0xc1, 0xba, 0x93,
+		0x4c, 0x65, 0x1e, 0x37, 0xa7, 0x8e, 0xf5, 0xdc, 0x03, 0x2a, 0x51, 0x78,
+		0x4d, 0x64, 0x1f, 0x36, 0xe9, 0xc0, 0xbb, 0x92, 0x02, 0x2b, 0x50, 0x79,
+		0xa6, 0x8f, 0xf4, 0xdd, 0xd3, 0xfa, 0x81, 0xa8, 0x77, 0x5e, 0x25, 0x0c,
+		0x9c, 0xb5, 0xce, 0xe7, 0x38, 0x11, 0x6a, 0x43, 0xec, 0xc5, 0xbe, 0x97,
+		0x48, 0x61, 0x1a, 0x33, 0xa3, 0x8a, 0xf1, 0xd8, 0x07, 0x2e, 0x55, 0x7c,
+		0x72, 0x5b, 0x20, 0x09, 0xd6, 0xff, 0x84, 0xad, 0x3d, 0x14, 0x6f, 0x46,
+		0x99, 0xb0, 0xcb, 0xe2, 0xd7, 0xfe, 0x85, 0xac, 0x73, 0x5a, 0x21, 0x08,
+		0x98, 0xb1, 0xca, 0xe3, 0x3c, 0x15, 0x6e, 0x47, 0x49, 0x60, 0x1b, 0x32,
+		0xed, 0xc4, 0xbf, 0x96, 0x06, 0x2f, 0x54, 0x7d, 0xa2, 0x8b, 0xf0, 0xd9,
+		0x9a, 0xb3, 0xc8, 0xe1, 0x3e, 0x17, 0x6c, 0x45, 0xd5, 0xfc, 0x87, 0xae,
+		0x71, 0x58, 0x23, 0x0a, 0x04, 0x2d, 0x56, 0x7f, 0xa0, 0x89, 0xf2, 0xdb,
+		0x4b, 0x62, 0x19, 0x30, 0xef, 0xc6, 0xbd, 0x94, 0xa1, 0x88, 0xf3, 0xda,
+		0x05, 0x2c, 0x57, 0x7e, 0xee, 0xc7, 0xbc, 0x95, 0x4a, 0x63, 0x18, 0x31,
+		0x3f, 0x16, 0x6d, 0x44, 0x9b, 0xb2, 0xc9, 0xe0, 0x70, 0x59, 0x22, 0x0b,
+		0xd4, 0xfd, 0x86, 0xaf
+	},
+	{
+		0x00, 0xdf, 0xb9, 0x66, 0x75, 0xaa, 0xcc, 0x13, 0xea, 0x35, 0x53, 0x8c,
+		0x9f, 0x40, 0x26, 0xf9, 0xd3, 0x0c, 0x6a, 0xb5, 0xa6, 0x79, 0x1f, 0xc0,
+		0x39, 0xe6, 0x80, 0x5f, 0x4c, 0x93, 0xf5, 0x2a, 0xa1, 0x7e, 0x18, 0xc7,
+		0xd4, 0x0b, 0x6d, 0xb2, 0x4b, 0x94, 0xf2, 0x2d, 0x3e, 0xe1, 0x87, 0x58,
+		0x72, 0xad, 0xcb, 0x14, 0x07, 0xd8, 0xbe, 0x61, 0x98, 0x47, 0x21, 0xfe,
+		0xed, 0x32, 0x54, 0x8b, 0x45, 0x9a, 0xfc, 0x23, 0x30, 0xef, 0x89, 0x56,
+		0xaf, 0x70, 0x16, 0xc9, 0xda, 0x05, 0x63, 0xbc, 0x96, 0x49, 0x2f, 0xf0,
+		0xe3, 0x3c, 0x5a, 0x85, 0x7c, 0xa3, 0xc5, 0x1a, 0x09, 0xd6, 0xb0, 0x6f,
+		0xe4, 0x3b, 0x5d, 0x82, 0x91, 0x4e, 0x28, 0xf7, 0x0e, 0xd1, 0xb7, 0x68,
+		0x7b, 0xa4, 0xc2, 0x1d, 0x37, 0xe8, 0x8e, 0x51, 0x42, 0x9d, 0xfb, 0x24,
+		0xdd, 0x02, 0x64, 0xbb, 0xa8, 0x77, 0x11, 0xce, 0x8a, 0x55, 0x33, 0xec,
+		0xff, 0x20, 0x46, 0x99, 0x60, 0xbf, 0xd9, 0x06, 0x15, 0xca, 0xac, 0x73,
+		0x59, 0x86, 0xe0, 0x3f, 0x2c, 0xf3, 0x95, 0x4a, 0xb3, 0x6c, 0x0a, 0xd5,
+		0xc6, 0x19, 0x7f, 0xa0, 0x2b, 0xf4, 0x92, 0x4d, 0x5e, 0x81, 0xe7, 0x38,
+		0xc1, 0x1e, 0x78, 0xa7, 0xb4, 0x6b, 0x0d, 0xd2, 0xf8, 0x27, 0x41, 0x9e,
+		0x8d, 0x52, 0x34, 0xeb, 0x12, 0xcd, 0xab, 0x74, 0x67, 0xb8, 0xde, 0x01,
+		0xcf, 0x10, 0x76, 0xa9, 0xba, 0x65, 0x03, 0xdc, 0x25, 0xfa, 0x9c, 0x43,
+		0x50, 0x8f, 0xe9, 0x36, 0x1c, 0xc3, 0xa5, 0x7a, 0x69, 0xb6, 0xd0, 0x0f,
+		0xf6, 0x29, 0x4f, 0x90, 0x83, 0x5c, 0x3a, 0xe5, 0x6e, 0xb1, 0xd7, 0x08,
+		0x1b, 0xc4, 0xa2, 0x7d, 0x84, 0x5b, 0x3d, 0xe2, 0xf1, 0x2e, 0x48, 0x97,
+		0xbd, 0x62, 0x04, 0xdb, 0xc8, 0x17, 0x71, 0xae, 0x57, 0x88, 0xee, 0x31,
+		0x22, 0xfd, 0x9b, 0x44
+	},
+	{
+		0x00, 0x13, 0x26, 0x35, 0x4c, 0x5f, 0x6a, 0x79, 0x98, 0x8b, 0xbe, 0xad,
+		0xd4, 0xc7, 0xf2, 0xe1, 0x37, 0x24, 0x11, 0x02, 0x7b, 0x68, 0x5d, 0x4e,
+		0xaf, 0xbc, 0x89, 0x9a, 0xe3, 0xf0, 0xc5, 0xd6, 0x6e, 0x7d, 0x48, 0x5b,
+		0x22, 0x31, 0x04, 0x17, 0xf6, 0xe5, 0xd0, 0xc3, 0xba, 0xa9, 0x9c, 0x8f,
+		0x59, 0x4a, 0x7f, 0x6c, 0x15, 0x06, 0x33, 0x20, 0xc1, 0xd2, 0xe7, 0xf4,
+		0x8d, 0x9e, 0xab, 0xb8, 0xdc, 0xcf, 0xfa, 0xe9, 0x90, 0x83, 0xb6, 0xa5,
+		0x44, 0x57, 0x62, 0x71, 0x08, 0x1b, 0x2e, 0x3d, 0xeb, 0xf8, 0xcd, 0xde,
+		0xa7, 0xb4, 0x81, 0x92, 0x73, 0x60, 0x55, 0x46, 0x3f, 0x2c, 0x19, 0x0a,
+		0xb2, 0xa1, 0x94, 0x87, 0xfe, 0xed, 0xd8, 0xcb, 0x2a, 0x39, 0x0c, 0x1f,
+		0x66, 0x75, 0x40, 0x53, 0x85, 0x96, 0xa3, 0xb0, 0xc9, 0xda, 0xef, 0xfc,
+		0x1d, 0x0e, 0x3b, 0x28, 0x51, 0x42, 0x77, 0x64, 0xbf, 0xac, 0x99, 0x8a,
+		0xf3, 0xe0, 0xd5, 0xc6, 0x27, 0x34, 0x01, 0x12, 0x6b, 0x78, 0x4d, 0x5e,
+		0x88, 0x9b, 0xae, 0xbd, 0xc4, 0xd7, 0xe2, 0xf1, 0x10, 0x03, 0x36, 0x25,
+		0x5c, 0x4f, 0x7a, 0x69, 0xd1, 0xc2, 0xf7, 0xe4, 0x9d, 0x8e, 0xbb, 0xa8,
+		0x49, 0x5a, 0x6f, 0x7c, 0x05, 0x16, 0x23, 0x30, 0xe6, 0xf5, 0xc0, 0xd3,
+		0xaa, 0xb9, 0x8c, 0x9f, 0x7e, 0x6d, 0x58, 0x4b, 0x32, 0x21, 0x14, 0x07,
+		0x63, 0x70, 0x45, 0x56, 0x2f, 0x3c, 0x09, 0x1a, 0xfb, 0xe8, 0xdd, 0xce,
+		0xb7, 0xa4, 0x91, 0x82, 0x54, 0x47, 0x72, 0x61, 0x18, 0x0b, 0x3e, 0x2d,
+		0xcc, 0xdf, 0xea, 0xf9, 0x80, 0x93, 0xa6, 0xb5, 0x0d, 0x1e, 0x2b, 0x38,
+		0x41, 0x52, 0x67, 0x74, 0x95, 0x86, 0xb3, 0xa0, 0xd9, 0xca, 0xff, 0xec,
+		0x3a, 0x29, 0x1c, 0x0f, 0x76, 0x65, 0x50, 0x43, 0xa2, 0xb1, 0x84, 0x97,
+		0xee, 0xfd, 0xc8, 0xdb
+	}
+};
+
 uint8_t crc8byte(uint8_t *crc, uint8_t msg)
 {
-	uint8_t rem = *crc ^ msg;
+	*crc = crc8_table[0][*crc ^ msg];
+
+	return *crc;
+}
+
+uint8_t crc8_init(void)
+{
+	return CRC8_INIT;
+}
 
-	for (uint8_t b=0; b<8; b++) {
-		if (rem&MSB)
-			rem = (rem<<1) ^ (uint8_t)POLYNOM;
-		else
-			rem = (rem<<1);
+/* slicing-by-8: the CRC has no state beyond the last byte, so the CRC of
+ * eight bytes is the xor of the contributions of every single byte */
+uint8_t crc8_update(uint8_t crc, const uint8_t *msg, size_t blen)
+{
+	while (blen >= 8) {
+		crc = crc8_table[7][crc ^ msg[0]] ^ crc8_table[6][msg[1]] ^
+			crc8_table[5][msg[2]] ^ crc8_table[4][msg[3]] ^
+			crc8_table[3][msg[4]] ^ crc8_table[2][msg[5]] ^
+			crc8_table[1][msg[6]] ^ crc8_table[0][msg[7]];
+		msg += 8;
+		blen -= 8;
 	}
 
-	*crc = rem;
+	while (blen--)
+		crc = crc8_table[0][crc ^ *msg++];
 
-	return rem;
+	return crc;
+}
+
+uint8_t crc8_final(uint8_t crc)
+{
+	return crc; /* no final xor */
 }
 
 uint8_t crc8(const uint8_t *msg, size_t blen)
+{
+	return crc8_final(crc8_update(crc8_init(), msg, blen));
+}
+
+#if 0 /* test */
+#include <stdio.h>
+#include <time.h>
+
+/* the former bit by bit implementation, reference for test and benchmark */
+static uint8_t crc8_bitwise(const uint8_t *msg, size_t blen)
 {
 	uint8_t rem = 0xff;
-	uint8_t rpoly = POLYNOM;
-	int b;
 
 	for (size_t i=0; i<blen; i++) {
 		rem ^= msg[i];
 
-		for (b=0; b<8; b++) {
+		for (int b=0; b<8; b++) {
 			if (rem&MSB)
-				rem = (rem<<1) ^ rpoly;
+				rem = (rem<<1) ^ (uint8_t)POLYNOM;
 			else
 				rem = (rem<<1);
 		}
@@ -40,10 +266,17 @@ uint8_t crc8(const uint8_t *msg, size_t blen)
 	return rem;
 }
 
-#if 0 /* test */
-#include <stdio.h>
+static double now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
 
-int main(int argc, char *argv[])
+#define BENCH_SIZE    (4096)
+#define BENCH_ROUNDS  (20000)
+
+int main(void)
 {
 	uint8_t crc = 0xff;
 
@@ -51,31 +284,66 @@ int main(int argc, char *argv[])
 	crc = crc8(input, sizeof(input)/sizeof(*input));
 
 	printf("polynom: %.2x\n", POLYNOM);
-	printf("Message (size %d): 0x", sizeof(input)/sizeof(*input));
-	for (int i=0; i<sizeof(input)/sizeof(*input); i++)
+	printf("Message (size %zu): 0x", sizeof(input)/sizeof(*input));
+	for (size_t i=0; i<sizeof(input)/sizeof(*input); i++)
 		printf("%.2x", input[i]);
 	printf("\n");
-	printf("CRC: %x\n\n", crc);
+	printf("CRC: %x (expected 0)\n\n", crc);
 
 	uint8_t input1[] = { 0x08, 0x0e, 0x02, 0x88, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 };
 	crc = crc8(input1, sizeof(input1)/sizeof(*input1));
-
-	printf("polynom: %.2x\n", POLYNOM);
-	printf("Message (size %d): 0x", sizeof(input1)/sizeof(*input1));
-	for (int i=0; i<sizeof(input1)/sizeof(*input1); i++)
-		printf("%.2x", input1[i]);
-	printf("\n");
-	printf("CRC: %x\n\n", crc);
+	printf("CRC of the first 14 bytes: %x (expected 2f)\n\n", crc);
 
 	printf("Now testing crc8byte()\n");
-
 	uint8_t crcb = 0xff;
-	for (int i=0; i<(sizeof(input)/sizeof(*input)); i++) {
-		printf("%.2x", input[i]);
-		crcb = crc8byte(&crcb, input[i]);
+	for (size_t i=0; i<(sizeof(input)/sizeof(*input)); i++)
+		crc8byte(&crcb, input[i]);
+	printf("CRC = 0x%.2x (expected 0)\n\n", crcb);
+
+	/* compare against the bitwise version for all lengths and alignments */
+	static uint8_t buf[BENCH_SIZE];
+	unsigned int seed = 1;
+	for (size_t i=0; i<sizeof(buf); i++) {
+		seed = seed * 1103515245 + 12345;
+		buf[i] = (uint8_t)(seed >> 16);
 	}
 
-	printf("CRC = 0x%.2x\n", crc);
-	return 0;
+	int errors = 0;
+	for (size_t off=0; off<8; off++) {
+		for (size_t len=0; len<300; len++) {
+			uint8_t split = crc8_update(crc8_update(crc8_init(), buf+off, len/3), buf+off+len/3, len-len/3);
+			if (crc8(buf+off, len) != crc8_bitwise(buf+off, len) || split != crc8(buf+off, len))
+				errors++;
+		}
+	}
+	printf("Comparison with bitwise implementation: %d errors\n\n", errors);
+
+	/* microbenchmark, BENCH_SIZE bytes is the size of a large SII */
+	volatile uint8_t sink = 0;
+	double t = now();
+	for (int r=0; r<BENCH_ROUNDS; r++)
+		sink ^= crc8_bitwise(buf, sizeof(buf));
+	double bitwise = now() - t;
+
+	t = now();
+	for (int r=0; r<BENCH_ROUNDS; r++) {
+		uint8_t c = 0xff;
+		for (size_t i=0; i<sizeof(buf); i++)
+			crc8byte(&c, buf[i]);
+		sink ^= c;
+	}
+	double bytewise = now() - t;
+
+	t = now();
+	for (int r=0; r<BENCH_ROUNDS; r++)
+		sink ^= crc8(buf, sizeof(buf));
+	double sliced = now() - t;
+
+	double mb = (double)sizeof(buf) * BENCH_ROUNDS / 1e6;
+	printf("bitwise:        %8.1f MB/s\n", mb / bitwise);
+	printf("table per byte: %8.1f MB/s\n", mb / bytewise);
+	printf("slicing-by-8:   %8.1f MB/s\n", mb / sliced);
+
+	return errors;
 }
 #endif
@@ -4,10 +4,24 @@
 #include <stdlib.h>
 #include <stdint.h>
 
+/* start value of the SII preamble checksum */
+#define CRC8_INIT   0xff
+
 /* calculates crc-8 sum for each byte given by msg */
 uint8_t crc8byte(uint8_t *crc, uint8_t msg);
 
 /* calculates crc-8 sum for array of bytes */
 uint8_t crc8(const uint8_t *msg, size_t blen);
 
+/* Streaming interface, the message may be passed in arbitrary pieces:
+ *
+ *   uint8_t crc = crc8_init();
+ *   crc = crc8_update(crc, part1, len1);
+ *   crc = crc8_update(crc, part2, len2);
+ *   sum = crc8_final(crc);
+ */
+uint8_t crc8_init(void);
+uint8_t crc8_update(uint8_t crc, const uint8_t *msg, size_t blen);
+uint8_t crc8_final(uint8_t crc);
+
 #endif /* CRC8_H */
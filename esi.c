@@ -4,23 +4,51 @@
 #include "esifile.h"
 #include "sii.h"
 #include "crc8.h"
+#include "log.h"
+#include "esitag.h"
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <pthread.h>
 
 #include <libxml/parser.h>
 #include <libxml/tree.h>
+#include <libxml/xmlreader.h>
 
 #define Char2xmlChar(s)   ((xmlChar *)s)
 
 #define MAX_BOOTSTRAP_STRING   18
 
+/* entry of the device index */
+struct _esi_device {
+	xmlNode *node;
+	uint32_t product_id;
+	uint32_t revision_id;
+	const xmlChar *name;
+	int next_product;  /* next device with the same product code or -1 */
+	int next_name;     /* next device with the same name hash or -1 */
+};
+
+/* One pass index over <Devices>, the hash tables hold the position of the
+ * first device per bucket. */
+struct _esi_index {
+	xmlNode *vendor;
+	xmlNode *groups;
+	struct _esi_device *device;
+	int count;
+	int *product_hash;
+	int *name_hash;
+	unsigned int hashmask;
+};
+
 struct _esi_data {
 	SiiInfo *sii;
 	char *siifile; /* also opt for sii->outfile */
 	xmlDocPtr doc; /* do I need both? */
 	xmlNode *xmlroot;
 	char *xmlfile;
+	struct _esi_index *index;
 };
 
 static inline void scan_hex_dec(const char *str, uint32_t *value)
@@ -186,27 +214,18 @@ static uint16_t preamble_crc8(struct _sii_preamble *pa)
 	if (pa == NULL)
 		return 0;
 
-	uint8_t crc = 0xff;
-
-	crc8byte(&crc, pa->pdi_ctrl&0xff);
-	crc8byte(&crc, (pa->pdi_ctrl>>8)&0xff);
-
-	crc8byte(&crc, pa->pdi_conf&0xff);
-	crc8byte(&crc, (pa->pdi_conf>>8)&0xff);
-
-	crc8byte(&crc, pa->sync_impulse&0xff);
-	crc8byte(&crc, (pa->sync_impulse>>8)&0xff);
-
-	crc8byte(&crc, pa->pdi_conf2&0xff);
-	crc8byte(&crc, (pa->pdi_conf2>>8)&0xff);
-
-	crc8byte(&crc, pa->alias&0xff);
-	crc8byte(&crc, (pa->alias>>8)&0xff);
+	/* the first 7 words of the preamble in EEPROM byte order */
+	uint8_t bytes[14] = {
+		pa->pdi_ctrl&0xff, (pa->pdi_ctrl>>8)&0xff,
+		pa->pdi_conf&0xff, (pa->pdi_conf>>8)&0xff,
+		pa->sync_impulse&0xff, (pa->sync_impulse>>8)&0xff,
+		pa->pdi_conf2&0xff, (pa->pdi_conf2>>8)&0xff,
+		pa->alias&0xff, (pa->alias>>8)&0xff,
+		pa->reserved[0]&0xff, pa->reserved[1]&0xff,
+		pa->reserved[2]&0xff, pa->reserved[3]&0xff
+	};
 
-	crc8byte(&crc, pa->reserved[0]&0xff);
-	crc8byte(&crc, pa->reserved[1]&0xff);
-	crc8byte(&crc, pa->reserved[2]&0xff);
-	crc8byte(&crc, pa->reserved[3]&0xff);
+	uint8_t crc = crc8_final(crc8_update(crc8_init(), bytes, sizeof(bytes)));
 
 	pa->checksum = crc;
 	pa->checksum_ok = 1;
@@ -214,18 +233,26 @@ static uint16_t preamble_crc8(struct _sii_preamble *pa)
 	return pa->checksum;
 }
 
-/* Searches the first occurence of node named 'name' */
-static xmlNode *search_node(xmlNode *root, const char *name)
+/* tag of an element, ESI_TAG_UNKNOWN for text, comments, ... */
+static enum eEsiTag node_tag(const xmlNode *node)
+{
+	if (node->type != XML_ELEMENT_NODE)
+		return ESI_TAG_UNKNOWN;
+
+	return esi_tag(node->name);
+}
+
+/* Searches the first occurence of element 'tag' */
+static xmlNode *search_node(xmlNode *root, enum eEsiTag tag)
 {
 	xmlNode *tmp = NULL;
 
 	for (xmlNode *curr = root; curr; curr = curr->next) {
-		if (curr->type == XML_ELEMENT_NODE &&
-			strncmp((const char *)curr->name, name, strlen((const char *)curr->name)) == 0)
+		if (node_tag(curr) == tag)
 			return curr;
 
 
-		tmp = search_node(curr->children, name);
+		tmp = search_node(curr->children, tag);
 		if (tmp != NULL)
 			return tmp;
 	}
@@ -233,19 +260,18 @@ static xmlNode *search_node(xmlNode *root, const char *name)
 	return NULL;
 }
 
-static xmlNode *search_node_bfs(xmlNode *root, const char *name)
+static xmlNode *search_node_bfs(xmlNode *root, enum eEsiTag tag)
 {
 	xmlNode *tmp = NULL;
 
 	for (xmlNode *curr = root; curr != NULL; curr = curr->next) {
-		if (curr->type == XML_ELEMENT_NODE &&
-			strncmp((const char *)curr->name, name, strlen((const char *)curr->name)) == 0) {
+		if (node_tag(curr) == tag) {
 			return curr;
 		}
 	}
 
 	for (xmlNode *curr = root; curr != NULL; curr = curr->next) {
-		tmp = search_node_bfs(curr->children, name);
+		tmp = search_node_bfs(curr->children, tag);
 
 		if (tmp != NULL) {
 			return tmp;
@@ -255,25 +281,233 @@ static xmlNode *search_node_bfs(xmlNode *root, const char *name)
 	return NULL;
 }
 
-static xmlNode *search_device(xmlNode *root, int device_number)
+static unsigned int hash_u32(uint32_t v)
+{
+	v ^= v >> 16;
+	v *= 0x7feb352d;
+	v ^= v >> 15;
+	v *= 0x846ca68b;
+	v ^= v >> 16;
+
+	return v;
+}
+
+static unsigned int hash_string(const xmlChar *str)
+{
+	uint32_t h = 2166136261u; /* FNV-1a */
+
+	while (str != NULL && *str != '\0') {
+		h ^= *str++;
+		h *= 16777619u;
+	}
+
+	return h;
+}
+
+static const xmlChar *node_text(xmlNode *node)
+{
+	if (node == NULL || node->children == NULL)
+		return Char2xmlChar("");
+
+	return node->children->content;
+}
+
+static void index_add_device(struct _esi_index *index, xmlNode *node)
 {
-	xmlNode *d = search_node(search_node(root, "Devices"), "Device");
-	while (device_number != 0 && d->next != NULL) {
-		d = d->next;
-		if (d->type == XML_ELEMENT_NODE) {
-			device_number--;
+	struct _esi_device *dev = &index->device[index->count];
+
+	/* the device array grows with realloc(), a device without <Type>
+	 * keeps id 0 and an empty name */
+	memset(dev, 0, sizeof(*dev));
+	dev->node = node;
+	dev->next_product = -1;
+	dev->next_name = -1;
+
+	for (xmlNode *n = node->children; n; n = n->next) {
+		if (node_tag(n) != ESI_TAG_TYPE)
+			continue;
+
+		for (xmlAttr *prop = n->properties; prop; prop = prop->next) {
+			switch (esi_tag(prop->name)) {
+			case ESI_TAG_PRODUCT_CODE:
+				scan_hex_dec((const char *)prop->children->content, &dev->product_id);
+				break;
+			case ESI_TAG_REVISION_NO:
+				scan_hex_dec((const char *)prop->children->content, &dev->revision_id);
+				break;
+			default:
+				break;
+			}
 		}
+
+		dev->name = node_text(n);
+		break;
+	}
+
+	if (dev->name == NULL)
+		dev->name = Char2xmlChar("");
+
+	index->count++;
+}
+
+static int index_hash_devices(struct _esi_index *index)
+{
+	unsigned int size = 16;
+	while (size < 2 * (unsigned int)index->count)
+		size <<= 1;
+
+	index->hashmask = size - 1;
+	index->product_hash = malloc(size * sizeof(int));
+	index->name_hash = malloc(size * sizeof(int));
+	if (index->product_hash == NULL || index->name_hash == NULL)
+		return -1;
+
+	for (unsigned int i = 0; i < size; i++) {
+		index->product_hash[i] = -1;
+		index->name_hash[i] = -1;
 	}
 
-	return (device_number > 0) ? NULL : d;
+	/* insert backwards so the chains keep document order */
+	for (int i = index->count - 1; i >= 0; i--) {
+		struct _esi_device *dev = &index->device[i];
+		unsigned int p = hash_u32(dev->product_id) & index->hashmask;
+		unsigned int n = hash_string(dev->name) & index->hashmask;
+
+		dev->next_product = index->product_hash[p];
+		index->product_hash[p] = i;
+		dev->next_name = index->name_hash[n];
+		index->name_hash[n] = i;
+	}
+
+	return 0;
+}
+
+static void index_release(struct _esi_index *index)
+{
+	if (index == NULL)
+		return;
+
+	free(index->device);
+	free(index->product_hash);
+	free(index->name_hash);
+	free(index);
+}
+
+/* NULL if out of memory */
+static struct _esi_index *index_build(xmlNode *root)
+{
+	struct _esi_index *index = calloc(1, sizeof(struct _esi_index));
+	if (index == NULL)
+		return NULL;
+
+	index->vendor = search_node(root, ESI_TAG_VENDOR);
+	index->groups = search_node(root, ESI_TAG_GROUPS);
+
+	xmlNode *devices = search_node(root, ESI_TAG_DEVICES);
+	int capacity = 0;
+
+	for (xmlNode *n = (devices != NULL) ? devices->children : NULL; n; n = n->next) {
+		if (node_tag(n) != ESI_TAG_DEVICE)
+			continue;
+
+		if (index->count == capacity) {
+			int newcapacity = (capacity == 0) ? 8 : capacity * 2;
+			struct _esi_device *tmp = realloc(index->device, newcapacity * sizeof(struct _esi_device));
+			if (tmp == NULL) {
+				index_release(index);
+				return NULL;
+			}
+
+			index->device = tmp;
+			capacity = newcapacity;
+		}
+
+		index_add_device(index, n);
+	}
+
+	if (index_hash_devices(index) != 0) {
+		index_release(index);
+		return NULL;
+	}
+
+	return index;
+}
+
+static int device_matches(const struct _esi_device_selector *sel, uint32_t product_id,
+		uint32_t revision_id, const xmlChar *name)
+{
+	if ((sel->keys & ESI_SELECT_PRODUCT) && sel->product_id != product_id)
+		return 0;
+
+	if ((sel->keys & ESI_SELECT_REVISION) && sel->revision_id != revision_id)
+		return 0;
+
+	if ((sel->keys & ESI_SELECT_NAME) && xmlStrcmp(Char2xmlChar(sel->name), name) != 0)
+		return 0;
+
+	return 1;
+}
+
+static struct _esi_device *index_lookup(struct _esi_index *index, const struct _esi_device_selector *sel)
+{
+	struct _esi_device *dev;
+	int i;
+
+	if (sel->keys & ESI_SELECT_NUMBER) {
+		if (sel->number < 0 || sel->number >= index->count)
+			return NULL;
+
+		dev = &index->device[sel->number];
+		return device_matches(sel, dev->product_id, dev->revision_id, dev->name) ? dev : NULL;
+	}
+
+	if (sel->keys & ESI_SELECT_PRODUCT) {
+		for (i = index->product_hash[hash_u32(sel->product_id) & index->hashmask]; i >= 0; i = dev->next_product) {
+			dev = &index->device[i];
+			if (device_matches(sel, dev->product_id, dev->revision_id, dev->name))
+				return dev;
+		}
+
+		return NULL;
+	}
+
+	if (sel->keys & ESI_SELECT_NAME) {
+		for (i = index->name_hash[hash_string(Char2xmlChar(sel->name)) & index->hashmask]; i >= 0; i = dev->next_name) {
+			dev = &index->device[i];
+			if (device_matches(sel, dev->product_id, dev->revision_id, dev->name))
+				return dev;
+		}
+
+		return NULL;
+	}
+
+	/* revision only, not worth a separate table */
+	for (i = 0; i < index->count; i++) {
+		dev = &index->device[i];
+		if (device_matches(sel, dev->product_id, dev->revision_id, dev->name))
+			return dev;
+	}
+
+	return NULL;
+}
+
+static struct _esi_index *esi_index(EsiData *esi)
+{
+	if (esi->index == NULL) {
+		esi->index = index_build(xmlDocGetRootElement(esi->doc));
+		if (esi->index == NULL)
+			sii_error("Error, out of memory for the device index\n");
+	}
+
+	return esi->index;
 }
 
 /* TODO: Add function to search for all nodes named by 'name' (e.g. multiple <Sm>-Tags */
 
 /* functions to parse xml */
-static struct _sii_preamble *parse_preamble(xmlNode *node)
+static struct _sii_preamble *parse_preamble(SiiInfo *sii, xmlNode *node)
 {
-	struct _sii_preamble *pa = calloc(1, sizeof(struct _sii_preamble));
+	struct _sii_preamble *pa = sii_alloc(sii, sizeof(struct _sii_preamble));
 
 	char string[1025];
 	strncpy(string, (char *)node->children->content, sizeof(string) - 1);
@@ -315,41 +549,28 @@ static struct _sii_preamble *parse_preamble(xmlNode *node)
 	return pa;
 }
 
-static struct _sii_stdconfig *parse_config(xmlNode *root, xmlNode *device)
+static struct _sii_stdconfig *parse_config(SiiInfo *sii, xmlNode *vendor, struct _esi_device *device)
 {
 	xmlNode *n, *tmp;
 
-	//xmlNode *n = search_node(root, "Vendor");
-	n = search_node(root, "Vendor");
+	n = vendor;
 	if (n==NULL) {
 		return NULL;
 	}
 
-	struct _sii_stdconfig *sc = calloc(1, sizeof(struct _sii_stdconfig));
+	struct _sii_stdconfig *sc = sii_alloc(sii, sizeof(struct _sii_stdconfig));
 
-	tmp = search_node(n, "Id");
+	tmp = search_node(n, ESI_TAG_ID);
 	//char *vendoridstr = tmp->children->content;
 
 	/* get id */
 	// FIXME add some error and validty checking, esp. if node is set correctly and has the type
 	scan_hex_dec((const char *)tmp->children->content, &(sc->vendor_id));
 
-	n = device; //search_node(search_node(root, "Devices"), "Device");
-
-	tmp = search_node(n, "Type");
-	xmlAttr *prop = tmp->properties;
-
-	while (prop != NULL) {
-		if (xmlStrncmp(prop->name, Char2xmlChar("ProductCode"), xmlStrlen(prop->name)) == 0) {
-			scan_hex_dec((const char *)prop->children->content, &(sc->product_id));
-		}
-
-		if (xmlStrncmp(prop->name, Char2xmlChar("RevisionNo"), xmlStrlen(prop->name)) == 0) {
-			scan_hex_dec((const char *)prop->children->content, &(sc->revision_id));
-		}
-
-		prop = prop->next;
-	}
+	/* product code and revision are already known from the device index */
+	n = device->node;
+	sc->product_id = device->product_id;
+	sc->revision_id = device->revision_id;
 
 	sc->serial = 0; /* FIXME the serial number is not in the esi? */
 
@@ -367,44 +588,47 @@ static struct _sii_stdconfig *parse_config(xmlNode *root, xmlNode *device)
 
 	tmp = n->children;
 	while (tmp != NULL) {
-		if (xmlStrncmp(tmp->name, Char2xmlChar("Sm"), xmlStrlen(tmp->name)) == 0) {
+		if (node_tag(tmp) == ESI_TAG_SM) {
 			xmlNode *smchild = tmp->children;
 			while (smchild != NULL) {
 				uint32_t atmp = 0;
-				if (xmlStrncmp(smchild->content, Char2xmlChar("MBoxOut"), xmlStrlen(smchild->content))== 0) {
-					xmlAttr *p = tmp->properties;
-					while (p!=NULL) {
-						if (xmlStrncmp(p->name, Char2xmlChar("DefaultSize"), xmlStrlen(p->name)) == 0) {
+				switch (esi_tag(smchild->content)) {
+				case ESI_TAG_MBOX_OUT:
+					for (xmlAttr *p = tmp->properties; p != NULL; p = p->next) {
+						switch (esi_tag(p->name)) {
+						case ESI_TAG_DEFAULT_SIZE:
 							scan_hex_dec((const char *)p->children->content, &atmp);
 							sc->std_rec_mbox_size = (uint16_t)atmp;
-						}
-
-						if (xmlStrncmp(p->name, Char2xmlChar("StartAddress"), xmlStrlen(p->name)) == 0) {
+							break;
+						case ESI_TAG_START_ADDRESS:
 							scan_hex_dec((const char *)p->children->content, &atmp);
 							sc->std_rec_mbox_offset = atmp;
+							break;
+						default:
+							break;
 						}
-
-						p = p->next;
 					}
+					break;
 
-				}
-
-				if (xmlStrncmp(smchild->content, Char2xmlChar("MBoxIn"), xmlStrlen(smchild->content))== 0) {
-					xmlAttr *p = tmp->properties;
-					while (p!=NULL) {
-						if (xmlStrncmp(p->name, Char2xmlChar("DefaultSize"), xmlStrlen(p->name)) == 0) {
+				case ESI_TAG_MBOX_IN:
+					for (xmlAttr *p = tmp->properties; p != NULL; p = p->next) {
+						switch (esi_tag(p->name)) {
+						case ESI_TAG_DEFAULT_SIZE:
 							scan_hex_dec((const char *)p->children->content, &atmp);
 							sc->std_snd_mbox_size = (uint16_t)atmp;
-						}
-
-						if (xmlStrncmp(p->name, Char2xmlChar("StartAddress"), xmlStrlen(p->name)) == 0) {
+							break;
+						case ESI_TAG_START_ADDRESS:
 							scan_hex_dec((const char *)p->children->content, &atmp);
 							sc->std_snd_mbox_offset = atmp;
+							break;
+						default:
+							break;
 						}
-
-						p = p->next;
 					}
+					break;
 
+				default:
+					break;
 				}
 
 				smchild = smchild->next;
@@ -416,36 +640,36 @@ static struct _sii_stdconfig *parse_config(xmlNode *root, xmlNode *device)
 
 	/* get the supported mailboxes - these also occure again in the general section */
 
-	tmp = search_node_bfs(n, "Mailbox");
+	tmp = search_node_bfs(n, ESI_TAG_MAILBOX);
 	xmlNode *mbox;
 
-	mbox = search_node(tmp, "CoE");
+	mbox = search_node(tmp, ESI_TAG_COE);
 	if (mbox != NULL)
 		sc->mailbox_protocol.bit.coe = 1;
 
-	mbox = search_node(tmp, "EoE");
+	mbox = search_node(tmp, ESI_TAG_EOE);
 	if (mbox != NULL)
 		sc->mailbox_protocol.bit.eoe = 1;
 
-	mbox = search_node(tmp, "FoE");
+	mbox = search_node(tmp, ESI_TAG_FOE);
 	if (mbox != NULL)
 		sc->mailbox_protocol.bit.foe = 1;
 
-	mbox = search_node(tmp, "VoE");
+	mbox = search_node(tmp, ESI_TAG_VOE);
 	if (mbox != NULL)
 		sc->mailbox_protocol.bit.voe = 1;
 
 	/* fetch eeprom size */
-	tmp = search_node(n, "ByteSize");
+	tmp = search_node(n, ESI_TAG_BYTE_SIZE);
 	/* convert byte -> kbyte */
 	sc->eeprom_size = BYTES_TO_EE(atoi((char *)tmp->children->content));
 	sc->version = 1; /* also not in Esi */
 
-	tmp = search_node_bfs(n, "Eeprom");
+	tmp = search_node_bfs(n, ESI_TAG_EEPROM);
 	if (tmp == NULL) {
-		fprintf(stderr, "Warning <Eeprom> tag not found");
+		sii_warning("Warning <Eeprom> tag not found");
 	} else {
-		xmlNode *bootstrap = search_node(tmp, "BootStrap");
+		xmlNode *bootstrap = search_node(tmp, ESI_TAG_BOOT_STRAP);
 		if (bootstrap != NULL) {
 			char bsraw[MAX_BOOTSTRAP_STRING] = { 0 };
 			memmove(bsraw, (char *)bootstrap->children->content, MAX_BOOTSTRAP_STRING);
@@ -465,12 +689,11 @@ static struct _sii_stdconfig *parse_config(xmlNode *root, xmlNode *device)
 	return sc;
 }
 
-static struct _sii_general *parse_general(SiiInfo *sii, xmlNode *root, xmlNode *device)
+static void parse_general(SiiInfo *sii, xmlNode *groups, xmlNode *device, struct _sii_general *general)
 {
 	xmlNode *parent;
 	xmlNode *node;
 	xmlNode *tmp;
-	struct _sii_general *general = calloc(1, sizeof(struct _sii_general));
 
 	/* Search group-,image-, order- and namestring and store these strings
 	 * to the corresponding *index.
@@ -478,15 +701,15 @@ static struct _sii_general *parse_general(SiiInfo *sii, xmlNode *root, xmlNode *
 	 * Note, these strings are Vendor specific.
 	 */
 
-	parent = search_node(root, "Groups");
-	node = search_node(parent, "Group");
-	tmp = search_node(node, "Type");
+	parent = groups;
+	node = search_node(parent, ESI_TAG_GROUP);
+	tmp = search_node(node, ESI_TAG_TYPE);
 	general->groupindex = sii_strings_add(sii, (const char *)tmp->children->content);
 
 	general->imageindex = 0;
 	general->orderindex = 0;
 
-	tmp = search_node(device, "Name"); /* FIXME check language id and use the english version LcId="1033" */
+	tmp = search_node(device, ESI_TAG_NAME); /* FIXME check language id and use the english version LcId="1033" */
 	general->nameindex = sii_strings_add(sii, (const char *)tmp->children->content);
 
 	/* reset temporial nodes */
@@ -498,7 +721,7 @@ static struct _sii_general *parse_general(SiiInfo *sii, xmlNode *root, xmlNode *
 	parent = device;
 
 	for (xmlAttr *attr = parent->properties; attr; attr = attr->next) {
-		if (xmlStrcmp(attr->name, Char2xmlChar("Physics")) == 0) {
+		if (esi_tag(attr->name) == ESI_TAG_PHYSICS) {
 			char *phys = malloc(xmlStrlen(attr->children->content)+1);
 			memmove(phys, attr->children->content, xmlStrlen(attr->children->content)+1);
 			for (char *c = phys, port=0; *c != '\0'; c++, port++) {
@@ -529,7 +752,7 @@ static struct _sii_general *parse_general(SiiInfo *sii, xmlNode *root, xmlNode *
 					general->phys_port_3 = val&0xf;
 					break;
 				default:
-					fprintf(stderr, "Error invalid port %d\n", port);
+					sii_error("Error invalid port %d\n", port);
 					break;
 				}
 			}
@@ -538,67 +761,66 @@ static struct _sii_general *parse_general(SiiInfo *sii, xmlNode *root, xmlNode *
 		}
 	}
 
-	node = search_node_bfs(parent, "Mailbox");
-	tmp = search_node(node, "CoE");
+	node = search_node_bfs(parent, ESI_TAG_MAILBOX);
+	tmp = search_node(node, ESI_TAG_COE);
 	if (tmp != NULL) {
 		general->coe_enable_sdo = 1;
 		/* parse the attributes */
 		for (xmlAttr *attr = tmp->properties; attr; attr = attr->next) {
-			if (xmlStrcmp(attr->name, Char2xmlChar("SdoInfo")) == 0)
+			switch (esi_tag(attr->name)) {
+			case ESI_TAG_SDO_INFO:
 				general->coe_enable_sdo_info = parse_boolean(attr->children->content);
-
-			if (xmlStrcmp(attr->name, Char2xmlChar("PdoAssign")) == 0)
+				break;
+			case ESI_TAG_PDO_ASSIGN:
 				general->coe_enable_pdo_assign = parse_boolean(attr->children->content);
-
-			if (xmlStrcmp(attr->name, Char2xmlChar("PdoConfig")) == 0)
+				break;
+			case ESI_TAG_PDO_CONFIG:
 				general->coe_enable_pdo_conf = parse_boolean(attr->children->content);
-
-			if (xmlStrcmp(attr->name, Char2xmlChar("PdoUpload")) == 0)
+				break;
+			case ESI_TAG_PDO_UPLOAD:
 				general->coe_enable_upload_start = parse_boolean(attr->children->content);
-
-			if (xmlStrcmp(attr->name, Char2xmlChar("??sdoComplete")) == 0)
-				general->coe_enable_sdo_complete = parse_boolean(attr->children->content);
-
-			//attr = attr->next;
+				break;
+			/* FIXME coe_enable_sdo_complete, the attribute name is unknown ("??sdoComplete") */
+			default:
+				break;
+			}
 		}
 	}
 
-	tmp = search_node(node, "EoE");
+	tmp = search_node(node, ESI_TAG_EOE);
 	if (tmp != NULL)
 		general->eoe_enabled = 1;
 
-	tmp = search_node(node, "FoE");
+	tmp = search_node(node, ESI_TAG_FOE);
 	if (tmp != NULL)
 		general->foe_enabled = 1;
-
-	return general;
 }
 
 static void parse_fmmu(xmlNode *current, SiiInfo *sii)
 {
 	struct _sii_cat *cat = sii_category_find(sii, SII_CAT_FMMU);
 	if (cat == NULL) { /* create new category */
-		cat = calloc(1, sizeof(struct _sii_cat));
-		cat->type = SII_CAT_FMMU;
+		cat = sii_category_new(sii, SII_CAT_FMMU);
 		sii_category_add(sii, cat);
 	}
 
-	if (cat->data == NULL) { /* if category exists but doesn't contain any data */
-		cat->data = (void *)calloc(1, sizeof(struct _sii_fmmu));
-	}
-
 	struct _sii_fmmu *fmmu = (struct _sii_fmmu *)cat->data;
 
 	/* now fetch the data */
-	xmlChar *content = current->children->content;
-	if (xmlStrncmp(content, Char2xmlChar("Inputs"), xmlStrlen(content)) == 0)
+	switch (esi_tag(current->children->content)) {
+	case ESI_TAG_INPUTS:
 		fmmu_add_entry(fmmu, FMMU_INPUTS);
-	else if (xmlStrncmp(content, Char2xmlChar("Outputs"), xmlStrlen(content)) == 0)
+		break;
+	case ESI_TAG_OUTPUTS:
 		fmmu_add_entry(fmmu, FMMU_OUTPUTS);
-	else if (xmlStrncmp(content, Char2xmlChar("MBoxState"), xmlStrlen(content)) == 0)
+		break;
+	case ESI_TAG_MBOX_STATE:
 		fmmu_add_entry(fmmu, FMMU_SYNCMSTAT);
-	else
+		break;
+	default:
 		fmmu_add_entry(fmmu, FMMU_UNUSED);
+		break;
+	}
 
 	/* add entry to fmmu struct */
 	cat->size += 8; /* add size of new fmmu entry */
@@ -608,56 +830,62 @@ static void parse_syncm(xmlNode *current, SiiInfo *sii)
 {
 	struct _sii_cat *cat = sii_category_find(sii, SII_CAT_SYNCM);
 	if (cat == NULL) {
-		cat = calloc(1, sizeof(struct _sii_cat));
-		cat->type = SII_CAT_SYNCM;
+		cat = sii_category_new(sii, SII_CAT_SYNCM);
 		sii_category_add(sii, cat);
 	}
 
-	if (cat->data == NULL) {
-		cat->data = (void *)calloc(1, sizeof(struct _sii_syncm));
-	}
-
 	/* now fetch the data */
 	//size_t smsize = 0;
 	struct _sii_syncm *sm = (struct _sii_syncm *)cat->data;
-	struct _syncm_entry *entry = calloc(1, sizeof(struct _syncm_entry));
-	entry->id = -1;
+	struct _syncm_entry entry = { .id = -1 };
 
 	xmlAttr *args = current->properties;
 	for (xmlAttr *a = args; a ; a = a->next) {
-		if (xmlStrncmp(a->name, Char2xmlChar("DefaultSize"), xmlStrlen(a->name)) == 0) {
-			uint32_t tmp = 0;
+		uint32_t tmp = 0;
+
+		switch (esi_tag(a->name)) {
+		case ESI_TAG_DEFAULT_SIZE:
 			scan_hex_dec((char *)a->children->content, &tmp);
-			entry->length = tmp&0xffff;
-		} else if (xmlStrncmp(a->name, Char2xmlChar("StartAddress"), xmlStrlen(a->name)) == 0) {
-			uint32_t tmp = 0;
+			entry.length = tmp&0xffff;
+			break;
+		case ESI_TAG_START_ADDRESS:
 			scan_hex_dec((char *)a->children->content, &tmp);
-			entry->phys_address = tmp&0xffff;
-		} else if (xmlStrncmp(a->name, Char2xmlChar("ControlByte"), xmlStrlen(a->name)) == 0) {
-			uint32_t tmp = 0;
+			entry.phys_address = tmp&0xffff;
+			break;
+		case ESI_TAG_CONTROL_BYTE:
 			scan_hex_dec((char *)a->children->content, &tmp);
-			entry->control = tmp&0xff;
-		} else if (xmlStrncmp(a->name, Char2xmlChar("Enable"), xmlStrlen(a->name)) == 0) {
-			entry->enable = atoi((char *)a->children->content);
+			entry.control = tmp&0xff;
+			break;
+		case ESI_TAG_ENABLE:
+			entry.enable = atoi((char *)a->children->content);
+			break;
+		default:
+			break;
 		}
 	}
 
-	entry->status = 0; /* don't care */
+	entry.status = 0; /* don't care */
 
 	/* type is encoded in the value of the node */
-	xmlChar *type = current->children->content;
-	if (xmlStrncmp(type, Char2xmlChar("MBoxIn"), xmlStrlen(type)) == 0)
-		entry->type = SMT_MBOXIN;
-	else if (xmlStrncmp(type, Char2xmlChar("MBoxOut"), xmlStrlen(type)) == 0)
-		entry->type = SMT_MBOXOUT;
-	else if (xmlStrncmp(type, Char2xmlChar("Inputs"), xmlStrlen(type)) == 0)
-		entry->type = SMT_INPUTS;
-	else if (xmlStrncmp(type, Char2xmlChar("Outputs"), xmlStrlen(type)) == 0)
-		entry->type = SMT_OUTPUTS;
-	else
-		entry->type = SMT_UNUSED;
+	switch (esi_tag(current->children->content)) {
+	case ESI_TAG_MBOX_IN:
+		entry.type = SMT_MBOXIN;
+		break;
+	case ESI_TAG_MBOX_OUT:
+		entry.type = SMT_MBOXOUT;
+		break;
+	case ESI_TAG_INPUTS:
+		entry.type = SMT_INPUTS;
+		break;
+	case ESI_TAG_OUTPUTS:
+		entry.type = SMT_OUTPUTS;
+		break;
+	default:
+		entry.type = SMT_UNUSED;
+		break;
+	}
 
-	syncm_entry_add(sm, entry);
+	syncm_entry_add(sm, &entry);
 	cat->size += 8; /* a syncmanager entry is 8 bytes */
 }
 
@@ -665,40 +893,48 @@ static void parse_dclock(xmlNode *current, SiiInfo *sii)
 {
 	size_t dcsize = 0;
 
-    for (xmlNode *op = search_node(current, "OpMode"); op ; op = op->next) {
-        if (xmlStrncmp(op->name, Char2xmlChar("OpMode"), xmlStrlen(op->name)) != 0) {
+    for (xmlNode *op = search_node(current, ESI_TAG_OP_MODE); op ; op = op->next) {
+        if (node_tag(op) != ESI_TAG_OP_MODE) {
             continue;
         }
 
-        struct _sii_cat *cat = calloc(1, sizeof(struct _sii_cat));
-        cat->type = SII_CAT_DCLOCK;
-        struct _sii_dclock *dc = calloc(1, sizeof(struct _sii_dclock));
+        struct _sii_cat *cat = sii_category_new(sii, SII_CAT_DCLOCK);
+        struct _sii_dclock *dc = (struct _sii_dclock *)cat->data;
 
         for (xmlNode *vals = op->children; vals; vals = vals->next) {
             int tmp = 0;
-            if (xmlStrncmp(vals->name, Char2xmlChar("Name"), xmlStrlen(vals->name)) == 0) {
+            switch (node_tag(vals)) {
+            case ESI_TAG_NAME:
                 dc->nameIdx = (uint8_t)sii_strings_add(sii, (char *)vals->children->content);
-            } else if (xmlStrncmp(vals->name, Char2xmlChar("Desc"), xmlStrlen(vals->name)) == 0) {
+                break;
+            case ESI_TAG_DESC:
                 dc->descIdx = (uint8_t)sii_strings_add(sii, (char *)vals->children->content);
-            } else if (xmlStrncmp(vals->name, Char2xmlChar("AssignActivate"), xmlStrlen(vals->name)) == 0) {
+                break;
+            case ESI_TAG_ASSIGN_ACTIVATE:
                 sscanf((char *)vals->children->content, "%d", &tmp);
                 dc->assignActivate = (uint16_t)tmp;
-            } else if (xmlStrncmp(vals->name, Char2xmlChar("CycleTimeSync0"), xmlStrlen(vals->name)) == 0) {
+                break;
+            case ESI_TAG_CYCLE_TIME_SYNC0:
                 sscanf((char *)vals->children->content, "%d", &tmp);
                 dc->cycleTime0 = (uint32_t)tmp;
-            } else if (xmlStrncmp(vals->name, Char2xmlChar("CycleTimeSync1"), xmlStrlen(vals->name)) == 0) {
+                break;
+            case ESI_TAG_CYCLE_TIME_SYNC1:
                 sscanf((char *)vals->children->content, "%d", &tmp);
                 dc->cycleTime1 = (uint32_t)tmp;
-            } else if (xmlStrncmp(vals->name, Char2xmlChar("ShiftTimeSync0"), xmlStrlen(vals->name)) == 0) {
+                break;
+            case ESI_TAG_SHIFT_TIME_SYNC0:
                 sscanf((char *)vals->children->content, "%d", &tmp);
                 dc->shiftTime0 = (uint32_t)tmp;
-            } else if (xmlStrncmp(vals->name, Char2xmlChar("ShiftTimeSync1"), xmlStrlen(vals->name)) == 0) {
+                break;
+            case ESI_TAG_SHIFT_TIME_SYNC1:
                 sscanf((char *)vals->children->content, "%d", &tmp);
                 dc->shiftTime1 = (uint32_t)tmp;
+                break;
+            default:
+                break;
             }
         }
 
-        cat->data = (void *)dc;
         cat->size = dcsize;
         sii_category_add(sii, cat);
     }
@@ -752,27 +988,36 @@ static int parse_pdo_get_data_type(char *xmldatatype)
 	return -1; /* unrecognized */
 }
 
-static struct _pdo_entry *parse_pdo_entry(xmlNode *val, SiiInfo *sii, int include_pdo_strings)
+static void parse_pdo_entry(xmlNode *val, SiiInfo *sii, int include_pdo_strings, struct _pdo_entry *entry)
 {
-	struct _pdo_entry *entry = calloc(1, sizeof(struct _pdo_entry));
-
 	int tmp = 0;
 
+	memset(entry, 0, sizeof(*entry));
+
 	for (xmlNode *child = val->children; child; child = child->next) {
-		if (xmlStrncmp(child->name, Char2xmlChar("Index"), xmlStrlen(child->name)) == 0) {
+		int dt;
+
+		switch (node_tag(child)) {
+		case ESI_TAG_INDEX:
 			scan_hex_dec((char *)child->children->content, (uint32_t *)&tmp);
 			entry->index = tmp&0xffff;
 			tmp = 0;
-		} else if (xmlStrncmp(child->name, Char2xmlChar("SubIndex"), xmlStrlen(child->name)) == 0) {
+			break;
+
+		case ESI_TAG_SUB_INDEX:
 			tmp = atoi((char *)child->children->content);
 			entry->subindex = tmp&0xff;
 			tmp = 0;
-		} else if (xmlStrncmp(child->name, Char2xmlChar("BitLen"), xmlStrlen(child->name)) == 0) {
+			break;
+
+		case ESI_TAG_BIT_LEN:
 			entry->bit_length = atoi((char *)child->children->content);
-		} else if (xmlStrncmp(child->name, Char2xmlChar("Name"), xmlStrlen(child->name)) == 0) {
+			break;
+
+		case ESI_TAG_NAME:
 			/* again, write this to the string category and store index to string here. */
 			if (child->children == NULL) {
-				fprintf(stderr, "[WARNING] Reading child content of size 0 (line: %d)\n", child->line);
+				sii_warning("[WARNING] Reading child content of size 0 (line: %d)\n", child->line);
 				tmp = -1;
 			} else {
 				if (include_pdo_strings)
@@ -782,40 +1027,43 @@ static struct _pdo_entry *parse_pdo_entry(xmlNode *val, SiiInfo *sii, int includ
 			}
 
 			if (tmp < 0) {
-				fprintf(stderr, "Error creating input string!\n");
+				sii_error("Error creating input string!\n");
 				entry->string_index = 0;
 			} else {
 				entry->string_index = (uint8_t)tmp&0xff;
 			}
-		} else if (xmlStrncmp(child->name, Char2xmlChar("DataType"), xmlStrlen(child->name)) == 0) {
+			break;
+
+		case ESI_TAG_DATA_TYPE:
 			if (child->children == NULL) {
-				fprintf(stderr, "Warning unspecified datatype found. Please check your ESI, datatype is set to 0\n");
-				continue;
+				sii_warning("Warning unspecified datatype found. Please check your ESI, datatype is set to 0\n");
+				break;
 			}
 
-			int dt = parse_pdo_get_data_type((char *)child->children->content);
+			dt = parse_pdo_get_data_type((char *)child->children->content);
 			if (dt <= 0)
-				fprintf(stderr, "Warning unrecognized esi data type '%s'\n", (char *)child->children->content);
+				sii_warning("Warning unrecognized esi data type '%s'\n", (char *)child->children->content);
 			else
 				entry->data_type = (uint8_t)dt;
+			break;
+
+		default:
 #if 0 /* doesn't help much, except for debugging */
-		} else {
-			fprintf(stderr, "Warning, unrecognized pdo setting: '%s'\n",
+			sii_warning("Warning, unrecognized pdo setting: '%s'\n",
 					(char *)child->name);
 #endif
+			break;
 		}
 	}
 
 	/* ETG2000 describes the fixed flag for PDO entries but in ETG2010 the
 	 * PDO entries don't have the flags described. */
 	for (xmlAttr *attr = val->properties; attr; attr = attr->next) {
-		if (xmlStrncmp(attr->name, Char2xmlChar("Fixed"), xmlStrlen(attr->name)) == 0) {
+		if (esi_tag(attr->name) == ESI_TAG_FIXED) {
 			int tmp = scan_bool_value((const char *)attr->children->content);
 			entry->flags |= (tmp<<4)&0xff;
 		}
 	}
-
-	return entry;
 }
 
 static void parse_pdo_attribute_flags(xmlNode *current, struct _sii_pdo *pdo)
@@ -823,24 +1071,28 @@ static void parse_pdo_attribute_flags(xmlNode *current, struct _sii_pdo *pdo)
 	int tmp = 0;
 	/* Get Arguments for SyncManager */
 	for (xmlAttr *attr = current->properties; attr; attr = attr->next) {
-		if (xmlStrncmp(attr->name, Char2xmlChar("Sm"), xmlStrlen(attr->name)) == 0) {
+		switch (esi_tag(attr->name)) {
+		case ESI_TAG_SM:
 			pdo->syncmanager = atoi((char *)attr->children->content);
-		}
-		else if (xmlStrncmp(attr->name, Char2xmlChar("Fixed"), xmlStrlen(attr->name)) == 0) {
+			break;
+		case ESI_TAG_FIXED:
 			tmp = scan_bool_value((const char *)attr->children->content);
 			pdo->flags |= (tmp<<4)&0xff;
-		}
-		else if (xmlStrncmp(attr->name, Char2xmlChar("Mandatory"), xmlStrlen(attr->name)) == 0) {
+			break;
+		case ESI_TAG_MANDATORY:
 			tmp = scan_bool_value((const char *)attr->children->content);
 			pdo->flags |= (tmp<<0)&0xff;
-		}
-		else if (xmlStrncmp(attr->name, Char2xmlChar("Virtual"), xmlStrlen(attr->name)) == 0) {
+			break;
+		case ESI_TAG_VIRTUAL:
 			tmp = scan_bool_value((const char *)attr->children->content);
 			pdo->flags |= (tmp<<5)&0xff;
-		}
-		else if (xmlStrncmp(attr->name, Char2xmlChar("OverwrittenByModule"), xmlStrlen(attr->name)) == 0) {
+			break;
+		case ESI_TAG_OVERWRITTEN_BY_MODULE:
 			tmp = scan_bool_value((const char *)attr->children->content);
 			pdo->flags |= (tmp<<7)&0xff;
+			break;
+		default:
+			break;
 		}
 	}
 }
@@ -848,23 +1100,21 @@ static void parse_pdo_attribute_flags(xmlNode *current, struct _sii_pdo *pdo)
 static void parse_pdo(xmlNode *current, SiiInfo *sii, int include_pdo_strings)
 {
 	enum eSection type;
-	if (xmlStrcmp(current->name, Char2xmlChar("RxPdo")) == 0)
+	switch (node_tag(current)) {
+	case ESI_TAG_RX_PDO:
 		type = SII_CAT_RXPDO;
-	else if(xmlStrcmp(current->name, Char2xmlChar("TxPdo")) == 0)
+		break;
+	case ESI_TAG_TX_PDO:
 		type = SII_CAT_TXPDO;
-	else {
-		fprintf(stderr, "[%s] Error, no PDO type\n", __func__);
+		break;
+	default:
+		sii_error("[%s] Error, no PDO type\n", __func__);
 		return;
 	}
 
-	struct _sii_cat *cat = calloc(1, sizeof(struct _sii_cat));
-	cat->type = type;
+	struct _sii_cat *cat = sii_category_new(sii, type);
 	sii_category_add(sii, cat);
 
-	if (cat->data == NULL) {
-		cat->data = (void *)calloc(1, sizeof(struct _sii_pdo));
-	}
-
 	struct _sii_pdo *pdo = (struct _sii_pdo *)cat->data;
 	if (type == SII_CAT_RXPDO)
 		pdo->type = RxPDO; //SII_RX_PDO;
@@ -883,26 +1133,37 @@ static void parse_pdo(xmlNode *current, SiiInfo *sii, int include_pdo_strings)
 	/* get node Name and node Index */
 	/* then parse the pdo list - all <Entry> children */
 	for (xmlNode *val = current->children; val; val = val->next) {
-		if (xmlStrncmp(val->name, Char2xmlChar("Name"), xmlStrlen(val->name)) == 0) {
-			int tmp = 0;
+		int tmp = 0;
+		uint32_t index = 0;
+		struct _pdo_entry entry;
+
+		switch (node_tag(val)) {
+		case ESI_TAG_NAME:
 			if (include_pdo_strings)
 			    tmp = sii_strings_add(sii, (char *)val->children->content);
 			if (tmp < 0) {
-				fprintf(stderr, "Error creating input string!\n");
+				sii_error("Error creating input string!\n");
 				pdo->name_index = 0;
 			} else {
 				pdo->name_index = (uint8_t)tmp&0xff;
 			}
-		} else if (xmlStrncmp(val->name, Char2xmlChar("Index"), xmlStrlen(val->name)) == 0) {
-			uint32_t tmp = 0;
-			scan_hex_dec((char *)val->children->content, &tmp);
-			pdo->index = tmp&0xffff;
-		} else if (xmlStrncmp(val->name, Char2xmlChar("Entry"), xmlStrlen(val->name)) == 0) {
+			break;
+
+		case ESI_TAG_INDEX:
+			scan_hex_dec((char *)val->children->content, &index);
+			pdo->index = index&0xffff;
+			break;
+
+		case ESI_TAG_ENTRY:
 			/* add new pdo entry */
 			pdo->entries += 1;
-			struct _pdo_entry *entry = parse_pdo_entry(val, sii, include_pdo_strings);
-			pdo_entry_add(pdo, entry);
+			parse_pdo_entry(val, sii, include_pdo_strings, &entry);
+			pdo_entry_add(pdo, &entry);
 			pdosize += 8; /* size of every pdo entry */
+			break;
+
+		default:
+			break;
 		}
 	}
 
@@ -910,12 +1171,517 @@ static void parse_pdo(xmlNode *current, SiiInfo *sii, int include_pdo_strings)
 }
 
 
+/* streaming input
+ *
+ * The xmlTextReader walks the document once and only the parts esi_parse()
+ * needs are copied into a reduced document: <Vendor>, <Groups> and the
+ * selected <Device>. Everything else, including object dictionaries and
+ * bitmaps, is read past without building any nodes. */
+
+static int stream_skip_element(const xmlChar *name)
+{
+	switch (esi_tag(name)) {
+	case ESI_TAG_DICTIONARY:
+	case ESI_TAG_IMAGE_DATA_16X14:
+		return 1;
+	default:
+		return 0;
+	}
+}
+
+/* Read up to the end of the element at depth which contains the reader */
+static int stream_skip_to_depth(xmlTextReaderPtr reader, int depth)
+{
+	int ret;
+
+	while ((ret = xmlTextReaderRead(reader)) == 1) {
+		if (xmlTextReaderNodeType(reader) == XML_READER_TYPE_END_ELEMENT &&
+		    xmlTextReaderDepth(reader) == depth)
+			break;
+	}
+
+	return ret;
+}
+
+/* Skip the element the reader is positioned on including all children */
+static int stream_skip_subtree(xmlTextReaderPtr reader)
+{
+	int depth = xmlTextReaderDepth(reader);
+	int ret = 1;
+
+	if (xmlTextReaderIsEmptyElement(reader))
+		return 1;
+
+	while ((ret = xmlTextReaderRead(reader)) == 1) {
+		if (xmlTextReaderNodeType(reader) == XML_READER_TYPE_END_ELEMENT &&
+		    xmlTextReaderDepth(reader) == depth)
+			break;
+	}
+
+	return ret;
+}
+
+static xmlNode *stream_new_element(xmlTextReaderPtr reader, xmlDocPtr doc, xmlNode *parent)
+{
+	xmlNode *node = xmlNewDocNode(doc, NULL, xmlTextReaderConstName(reader), NULL);
+	node->line = (unsigned short)xmlTextReaderGetParserLineNumber(reader);
+
+	while (xmlTextReaderMoveToNextAttribute(reader) == 1)
+		xmlNewProp(node, xmlTextReaderConstName(reader), xmlTextReaderConstValue(reader));
+	xmlTextReaderMoveToElement(reader);
+
+	if (parent == NULL)
+		xmlDocSetRootElement(doc, node);
+	else
+		xmlAddChild(parent, node);
+
+	return node;
+}
+
+/* value of a hex/dec attribute of the element the reader is positioned on,
+ * 0 if it is missing */
+static uint32_t stream_attribute_hex_dec(xmlTextReaderPtr reader, const char *name)
+{
+	uint32_t value = 0;
+	xmlChar *text = xmlTextReaderGetAttribute(reader, Char2xmlChar(name));
+
+	if (text != NULL) {
+		scan_hex_dec((const char *)text, &value);
+		xmlFree(text);
+	}
+
+	return value;
+}
+
+/* Drop the device top again and skip the rest of it, the reader is within
+ * the device at depth */
+static int stream_drop_device(xmlTextReaderPtr reader, int depth, xmlNode *top, int *matched)
+{
+	int ret = 1;
+
+	xmlUnlinkNode(top);
+	xmlFreeNode(top);
+	*matched = 0;
+
+	if (xmlTextReaderDepth(reader) == depth)
+		return 1;
+
+	while ((ret = xmlTextReaderRead(reader)) == 1) {
+		if (xmlTextReaderNodeType(reader) == XML_READER_TYPE_END_ELEMENT &&
+		    xmlTextReaderDepth(reader) == depth)
+			break;
+	}
+
+	return ret;
+}
+
+/* Copy the element the reader is positioned on into doc, except for the
+ * children stream_skip_element() filters.
+ *
+ * With a selector the element is a <Device>: product code and revision are
+ * checked at the start of its <Type>, the name as soon as the <Type> is
+ * complete. A device which doesn't match or has no <Type> is dropped again
+ * and the remainder is skipped. *matched tells which case happened. */
+static int stream_copy_subtree(xmlTextReaderPtr reader, xmlDocPtr doc, xmlNode *parent,
+		const struct _esi_device_selector *sel, int *matched)
+{
+	int depth = xmlTextReaderDepth(reader);
+	xmlNode *top = stream_new_element(reader, doc, parent);
+	xmlNode *current = top;
+	xmlNode *text;
+	int ret = 1;
+
+	if (matched != NULL)
+		*matched = 1;
+
+	if (xmlTextReaderIsEmptyElement(reader))
+		return (sel != NULL) ? stream_drop_device(reader, depth, top, matched) : 1;
+
+	while ((ret = xmlTextReaderRead(reader)) == 1) {
+		switch (xmlTextReaderNodeType(reader)) {
+		case XML_READER_TYPE_ELEMENT:
+			if (stream_skip_element(xmlTextReaderConstName(reader))) {
+				ret = stream_skip_subtree(reader);
+				if (ret != 1)
+					return ret;
+				break;
+			}
+
+			xmlNode *child = stream_new_element(reader, doc, current);
+			int empty = xmlTextReaderIsEmptyElement(reader);
+
+			if (sel != NULL && current == top && node_tag(child) == ESI_TAG_TYPE) {
+				uint32_t product_id = stream_attribute_hex_dec(reader, "ProductCode");
+				uint32_t revision_id = stream_attribute_hex_dec(reader, "RevisionNo");
+				struct _esi_device_selector idsel = *sel;
+
+				idsel.keys &= ~ESI_SELECT_NAME;
+				if (!device_matches(&idsel, product_id, revision_id, NULL))
+					return stream_drop_device(reader, depth, top, matched);
+
+				/* the name is the text of <Type>, known at its end */
+				if (!(sel->keys & ESI_SELECT_NAME))
+					sel = NULL;
+				else if (empty && !device_matches(sel, product_id, revision_id, Char2xmlChar("")))
+					return stream_drop_device(reader, depth, top, matched);
+				else if (empty)
+					sel = NULL;
+			}
+
+			if (!empty)
+				current = child;
+			break;
+
+		case XML_READER_TYPE_END_ELEMENT:
+			if (xmlTextReaderDepth(reader) == depth) {
+				/* no <Type> which could be checked */
+				if (sel != NULL)
+					return stream_drop_device(reader, depth, top, matched);
+				return 1;
+			}
+
+			if (sel != NULL && current->parent == top &&
+			    node_tag(current) == ESI_TAG_TYPE) {
+				if (xmlStrcmp(Char2xmlChar(sel->name), node_text(current)) != 0)
+					return stream_drop_device(reader, depth, top, matched);
+
+				sel = NULL; /* match, copy the rest */
+			}
+
+			current = current->parent;
+			break;
+
+		case XML_READER_TYPE_TEXT:
+		case XML_READER_TYPE_WHITESPACE:
+		case XML_READER_TYPE_SIGNIFICANT_WHITESPACE:
+			text = xmlNewDocText(doc, xmlTextReaderConstValue(reader));
+			text->line = (unsigned short)xmlTextReaderGetParserLineNumber(reader);
+			xmlAddChild(current, text);
+			break;
+
+		case XML_READER_TYPE_CDATA:
+			text = xmlNewCDataBlock(doc, xmlTextReaderConstValue(reader),
+					xmlStrlen(xmlTextReaderConstValue(reader)));
+			xmlAddChild(current, text);
+			break;
+
+		default: /* comments, processing instructions, ... */
+			break;
+		}
+	}
+
+	return ret;
+}
+
+static xmlDocPtr stream_read_device(xmlTextReaderPtr reader, const struct _esi_device_selector *sel)
+{
+	xmlDocPtr doc = xmlNewDoc(Char2xmlChar("1.0"));
+	xmlNode *root = NULL;
+	xmlNode *descriptions = NULL;
+	xmlNode *devices = NULL;
+	int device_count = 0;
+	int found = 0;
+	int ret;
+
+	while (!found && (ret = xmlTextReaderRead(reader)) == 1) {
+		if (xmlTextReaderNodeType(reader) != XML_READER_TYPE_ELEMENT)
+			continue;
+
+		enum eEsiTag tag = esi_tag(xmlTextReaderConstName(reader));
+
+		switch (xmlTextReaderDepth(reader)) {
+		case 0:
+			root = stream_new_element(reader, doc, NULL);
+			continue;
+
+		case 1:
+			if (tag == ESI_TAG_VENDOR) {
+				ret = stream_copy_subtree(reader, doc, root, NULL, NULL);
+			} else if (tag == ESI_TAG_DESCRIPTIONS) {
+				descriptions = stream_new_element(reader, doc, root);
+				continue;
+			} else {
+				ret = stream_skip_subtree(reader);
+			}
+			break;
+
+		case 2: /* only reached within <Descriptions> */
+			if (tag == ESI_TAG_GROUPS) {
+				ret = stream_copy_subtree(reader, doc, descriptions, NULL, NULL);
+			} else if (tag == ESI_TAG_DEVICES) {
+				devices = stream_new_element(reader, doc, descriptions);
+				continue;
+			} else {
+				ret = stream_skip_subtree(reader);
+			}
+			break;
+
+		case 3: /* only reached within <Devices> */
+			if (tag != ESI_TAG_DEVICE) {
+				ret = stream_skip_subtree(reader);
+			} else if (sel->keys == ESI_SELECT_NUMBER) {
+				/* positional selection doesn't need to look inside */
+				if (device_count++ == sel->number) {
+					ret = stream_copy_subtree(reader, doc, devices, NULL, &found);
+				} else {
+					ret = stream_skip_subtree(reader);
+				}
+			} else {
+				struct _esi_device_selector devsel = *sel;
+				devsel.keys &= ~ESI_SELECT_NUMBER;
+
+				if ((sel->keys & ESI_SELECT_NUMBER) && device_count != sel->number)
+					ret = stream_skip_subtree(reader);
+				else
+					ret = stream_copy_subtree(reader, doc, devices, &devsel, &found);
+
+				device_count++;
+			}
+			break;
+
+		default:
+			ret = stream_skip_subtree(reader);
+			break;
+		}
+
+		if (ret != 1)
+			break;
+	}
+
+	if (ret < 0) {
+		sii_error("Failed to parse XML.\n");
+		xmlFreeDoc(doc);
+		return NULL;
+	}
+
+	if (!found) {
+		sii_error("Error, no matching device found\n");
+		xmlFreeDoc(doc);
+		return NULL;
+	}
+
+	return doc;
+}
+
+/* identification only: nothing is copied, the reader stops as soon as the
+ * requested values of the selected device are known */
+
+static int stream_read_hex_dec(xmlTextReaderPtr reader, uint32_t *value)
+{
+	xmlChar *text = xmlTextReaderReadString(reader);
+	if (text == NULL)
+		return -1;
+
+	scan_hex_dec((const char *)text, value);
+	xmlFree(text);
+
+	return stream_skip_subtree(reader);
+}
+
+/* Id of the <Vendor> the reader is positioned on */
+static int stream_ident_vendor(xmlTextReaderPtr reader, uint32_t *vendor_id)
+{
+	int depth = xmlTextReaderDepth(reader);
+	int ret = 1;
+
+	if (xmlTextReaderIsEmptyElement(reader))
+		return 1;
+
+	while ((ret = xmlTextReaderRead(reader)) == 1) {
+		int type = xmlTextReaderNodeType(reader);
+
+		if (type == XML_READER_TYPE_END_ELEMENT && xmlTextReaderDepth(reader) == depth)
+			break;
+
+		if (type != XML_READER_TYPE_ELEMENT)
+			continue;
+
+		if (esi_tag(xmlTextReaderConstName(reader)) == ESI_TAG_ID)
+			ret = stream_read_hex_dec(reader, vendor_id);
+		else
+			ret = stream_skip_subtree(reader);
+
+		if (ret != 1)
+			break;
+	}
+
+	return ret;
+}
+
+/* alias of the preamble in <ConfigData>, bytes 8 and 9 of the hex string */
+static int stream_ident_alias(xmlTextReaderPtr reader, uint16_t *alias)
+{
+	xmlChar *text = xmlTextReaderReadString(reader);
+	unsigned int low = 0, high = 0;
+
+	if (text == NULL)
+		return -1;
+
+	if (xmlStrlen(text) >= 20 && sscanf((const char *)text + 16, "%2x%2x", &low, &high) == 2)
+		*alias = (uint16_t)BYTES_TO_WORD(low, high);
+	xmlFree(text);
+
+	return stream_skip_subtree(reader);
+}
+
+/* Check the <Device> the reader is positioned on against sel, *found is set
+ * if it matches and ident is filled. Reading stops within the device once
+ * the <Type> or, with ESI_IDENT_ALIAS, the <ConfigData> is seen. */
+static int stream_ident_device(xmlTextReaderPtr reader, const struct _esi_device_selector *sel,
+		unsigned int flags, struct _esi_ident *ident, int *found)
+{
+	int depth = xmlTextReaderDepth(reader);
+	int ret = 1;
+
+	if (xmlTextReaderIsEmptyElement(reader))
+		return 1;
+
+	while ((ret = xmlTextReaderRead(reader)) == 1) {
+		int type = xmlTextReaderNodeType(reader);
+
+		if (type == XML_READER_TYPE_END_ELEMENT && xmlTextReaderDepth(reader) == depth)
+			break;
+
+		if (type != XML_READER_TYPE_ELEMENT)
+			continue;
+
+		enum eEsiTag tag = esi_tag(xmlTextReaderConstName(reader));
+
+		if (xmlTextReaderDepth(reader) == depth + 1 && tag == ESI_TAG_TYPE) {
+			xmlChar *value;
+
+			ident->product_id = 0;
+			ident->revision_id = 0;
+
+			if ((value = xmlTextReaderGetAttribute(reader, Char2xmlChar("ProductCode"))) != NULL) {
+				scan_hex_dec((const char *)value, &ident->product_id);
+				xmlFree(value);
+			}
+
+			if ((value = xmlTextReaderGetAttribute(reader, Char2xmlChar("RevisionNo"))) != NULL) {
+				scan_hex_dec((const char *)value, &ident->revision_id);
+				xmlFree(value);
+			}
+
+			value = xmlTextReaderReadString(reader);
+			snprintf(ident->name, sizeof(ident->name), "%s", value != NULL ? (const char *)value : "");
+			xmlFree(value);
+
+			if (!device_matches(sel, ident->product_id, ident->revision_id, Char2xmlChar(ident->name)))
+				return stream_skip_to_depth(reader, depth);
+
+			*found = 1;
+			if (!(flags & ESI_IDENT_ALIAS))
+				return 1;
+
+			ret = stream_skip_subtree(reader);
+		} else if (*found && tag == ESI_TAG_CONFIG_DATA &&
+				xmlTextReaderDepth(reader) == depth + 2) {
+			return stream_ident_alias(reader, &ident->alias);
+		} else if (tag == ESI_TAG_EEPROM && xmlTextReaderDepth(reader) == depth + 1) {
+			continue; /* look at the ConfigData inside */
+		} else {
+			ret = stream_skip_subtree(reader);
+		}
+
+		if (ret != 1)
+			break;
+	}
+
+	return ret;
+}
+
+static int stream_ident(xmlTextReaderPtr reader, const struct _esi_device_selector *sel,
+		unsigned int flags, struct _esi_ident *ident)
+{
+	int device_count = 0;
+	int found = 0;
+	int ret;
+
+	while (!found && (ret = xmlTextReaderRead(reader)) == 1) {
+		if (xmlTextReaderNodeType(reader) != XML_READER_TYPE_ELEMENT)
+			continue;
+
+		enum eEsiTag tag = esi_tag(xmlTextReaderConstName(reader));
+
+		switch (xmlTextReaderDepth(reader)) {
+		case 0:
+			continue;
+
+		case 1:
+			if (tag == ESI_TAG_VENDOR)
+				ret = stream_ident_vendor(reader, &ident->vendor_id);
+			else if (tag == ESI_TAG_DESCRIPTIONS)
+				continue;
+			else
+				ret = stream_skip_subtree(reader);
+			break;
+
+		case 2: /* only reached within <Descriptions> */
+			if (tag == ESI_TAG_DEVICES)
+				continue;
+			ret = stream_skip_subtree(reader);
+			break;
+
+		case 3: /* only reached within <Devices> */
+			if (tag != ESI_TAG_DEVICE) {
+				ret = stream_skip_subtree(reader);
+			} else {
+				struct _esi_device_selector devsel = *sel;
+				devsel.keys &= ~ESI_SELECT_NUMBER;
+
+				if ((sel->keys & ESI_SELECT_NUMBER) && device_count != sel->number)
+					ret = stream_skip_subtree(reader);
+				else
+					ret = stream_ident_device(reader, &devsel, flags, ident, &found);
+
+				device_count++;
+			}
+			break;
+
+		default:
+			ret = stream_skip_subtree(reader);
+			break;
+		}
+
+		if (ret != 1)
+			break;
+	}
+
+	if (ret < 0) {
+		sii_error("Failed to parse XML.\n");
+		return -1;
+	}
+
+	if (!found) {
+		sii_error("Error, no matching device found\n");
+		return -1;
+	}
+
+	return 0;
+}
+
+static void library_init_once(void)
+{
+	LIBXML_TEST_VERSION
+	xmlInitParser();
+}
+
+/* libxml2 keeps process wide state which is set up on first use, do it
+ * exactly once even if the first documents are read by several threads */
+void esi_library_init(void)
+{
+	static pthread_once_t once = PTHREAD_ONCE_INIT;
+
+	pthread_once(&once, library_init_once);
+}
+
 /* API function */
 
 struct _esi_data *esi_init(const char *file)
 {
 	if (file == NULL) {
-		fprintf(stderr, "Warning, init with empty filename\n");
+		sii_warning("Warning, init with empty filename\n");
 		return NULL;
 	}
 
@@ -927,7 +1693,7 @@ struct _esi_data *esi_init(const char *file)
 		/* init with sii bin */
 		esi->sii = sii_init_file(file);
 		if (esi->sii == NULL) {
-			fprintf(stderr, "Failed to read SII bin file '%s'\n", file);
+			sii_error("Failed to read SII bin file '%s'\n", file);
 			free(esi);
 			return NULL;
 		}
@@ -935,13 +1701,13 @@ struct _esi_data *esi_init(const char *file)
 
 	case XML:
 		/* init with xml */
-		LIBXML_TEST_VERSION
+		esi_library_init();
 
 		esi->sii = sii_init();
 		esi->doc = xmlReadFile(file, NULL, 0);
 		if (esi->doc == NULL) {
-			fprintf(stderr, "Failed to parse XML file '%s'\n", file);
-			free(esi->sii);
+			sii_error("Failed to parse XML file '%s'\n", file);
+			sii_release(esi->sii);
 			free(esi);
 			return NULL;
 		}
@@ -975,7 +1741,7 @@ EsiData *esi_init_string(const unsigned char *buf, size_t size)
 		/* init with sii bin */
 		esi->sii = sii_init_string(buf, size);
 		if (esi->sii == NULL) {
-			fprintf(stderr, "Failed to read SII bin.\n");
+			sii_error("Failed to read SII bin.\n");
 			free(esi);
 			return NULL;
 		}
@@ -983,14 +1749,13 @@ EsiData *esi_init_string(const unsigned char *buf, size_t size)
 
 	case XML:
 		/* init with xml */
-		LIBXML_TEST_VERSION
+		esi_library_init();
 
 		esi->sii = sii_init();
 		esi->doc = xmlReadMemory((const char *)buf, size, "noname.xml", NULL, 0);
 		if (esi->doc == NULL) {
-			fprintf(stderr, "Failed to parse XML.\n");
-			sii_release(esi->sii);
-			esi_release(esi);
+			sii_error("Failed to parse XML.\n");
+			esi_release(esi); /* also releases esi->sii */
 			return NULL;
 		}
 		break;
@@ -1006,6 +1771,48 @@ EsiData *esi_init_string(const unsigned char *buf, size_t size)
 	return esi;
 }
 
+EsiData *esi_init_stream(const unsigned char *buf, size_t size,
+		const struct _esi_device_selector *sel)
+{
+	esi_library_init();
+
+	xmlTextReaderPtr reader = xmlReaderForMemory((const char *)buf, size, "noname.xml", NULL, 0);
+	if (reader == NULL) {
+		sii_error("Failed to parse XML.\n");
+		return NULL;
+	}
+
+	xmlDocPtr doc = stream_read_device(reader, sel);
+	xmlFreeTextReader(reader);
+	if (doc == NULL)
+		return NULL;
+
+	EsiData *esi = calloc(1, sizeof(struct _esi_data));
+	esi->sii = sii_init();
+	esi->doc = doc;
+
+	return esi;
+}
+
+int esi_stream_ident(const unsigned char *buf, size_t size,
+		const struct _esi_device_selector *sel, unsigned int flags, struct _esi_ident *ident)
+{
+	esi_library_init();
+
+	memset(ident, 0, sizeof(*ident));
+
+	xmlTextReaderPtr reader = xmlReaderForMemory((const char *)buf, size, "noname.xml", NULL, 0);
+	if (reader == NULL) {
+		sii_error("Failed to parse XML.\n");
+		return -1;
+	}
+
+	int ret = stream_ident(reader, sel, flags, ident);
+	xmlFreeTextReader(reader);
+
+	return ret;
+}
+
 void esi_release(struct _esi_data *esi)
 {
 	xmlFreeDoc(esi->doc);
@@ -1022,63 +1829,198 @@ void esi_release(struct _esi_data *esi)
 	if (esi->xmlfile != NULL)
 		free(esi->xmlfile);
 
+	index_release(esi->index);
+
 	free(esi);
 }
 
+int esi_selector_parse(struct _esi_device_selector *sel, const char *str)
+{
+	char *end;
+
+	memset(sel, 0, sizeof(*sel));
+
+	/* plain device number */
+	long number = strtol(str, &end, 10);
+	if (end != str && *end == '\0') {
+		sel->keys = ESI_SELECT_NUMBER;
+		sel->number = (int)number;
+		return (number < 0) ? -1 : 0;
+	}
+
+	const char *key = str;
+	while (*key != '\0') {
+		const char *value = strchr(key, '=');
+		if (value == NULL)
+			return -1;
+
+		size_t keylen = (size_t)(value - key);
+		value++;
+		size_t valuelen = strcspn(value, ",");
+
+		if (keylen == 4 && strncmp(key, "name", 4) == 0) {
+			if (valuelen >= sizeof(sel->name))
+				return -1;
+
+			memmove(sel->name, value, valuelen);
+			sel->name[valuelen] = '\0';
+			sel->keys |= ESI_SELECT_NAME;
+		} else {
+			char tmp[32] = { 0 };
+
+			if (valuelen == 0 || valuelen >= sizeof(tmp))
+				return -1;
+
+			memmove(tmp, value, valuelen);
+			if (tmp[0] == '#' && tmp[1] == 'x') /* ESI notation */
+				tmp[0] = '0';
+
+			unsigned long ul = strtoul(tmp, &end, 0);
+			if (*end != '\0')
+				return -1;
+
+			if (keylen == 7 && strncmp(key, "product", 7) == 0) {
+				sel->product_id = (uint32_t)ul;
+				sel->keys |= ESI_SELECT_PRODUCT;
+			} else if ((keylen == 3 && strncmp(key, "rev", 3) == 0) ||
+				   (keylen == 8 && strncmp(key, "revision", 8) == 0)) {
+				sel->revision_id = (uint32_t)ul;
+				sel->keys |= ESI_SELECT_REVISION;
+			} else if (keylen == 6 && strncmp(key, "device", 6) == 0) {
+				sel->number = (int)ul;
+				sel->keys |= ESI_SELECT_NUMBER;
+			} else {
+				return -1;
+			}
+		}
+
+		key = value + valuelen;
+		if (*key == ',')
+			key++;
+	}
+
+	return (sel->keys == 0) ? -1 : 0;
+}
+
+void esi_print_devices(FILE *f, EsiData *esi)
+{
+	struct _esi_index *index = esi_index(esi);
+	if (index == NULL)
+		return;
+
+	for (int i = 0; i < index->count; i++) {
+		struct _esi_device *dev = &index->device[i];
+		fprintf(f, "%d: product=0x%08x,rev=0x%08x,name=%s\n",
+			i, dev->product_id, dev->revision_id, (const char *)dev->name);
+	}
+}
+
 int esi_parse(EsiData *esi, int device_number, int include_pdo_strings)
 {
-	xmlNode *root = xmlDocGetRootElement(esi->doc);
+	struct _esi_device_selector sel;
+
+	memset(&sel, 0, sizeof(sel));
+	sel.keys = ESI_SELECT_NUMBER;
+	sel.number = device_number;
 
+	return esi_parse_select(esi, &sel, include_pdo_strings);
+}
+
+/* Fill sii from the indexed device, only reads from the document so several
+ * devices of the same document can be parsed in parallel. */
+static int parse_device(SiiInfo *sii, struct _esi_index *index, struct _esi_device *dev,
+		int include_pdo_strings)
+{
 	/* first, prepare category strings, since this is always needed */
-	struct _sii_cat *strings = sii_category_find(esi->sii, SII_CAT_STRINGS);
+	struct _sii_cat *strings = sii_category_find(sii, SII_CAT_STRINGS);
 	if (strings == NULL) {
-		strings = calloc(1, sizeof(struct _sii_cat));
-		strings->type = SII_CAT_STRINGS;
-		struct _sii_strings *strdata = calloc(1, sizeof(struct _sii_strings));
-		strings->data = strdata;
-		sii_category_add(esi->sii, strings);
+		strings = sii_category_new(sii, SII_CAT_STRINGS);
+		sii_category_add(sii, strings);
 	}
 
-	xmlNode *device = search_device(root, device_number);
-	if (!device) {
-		fprintf(stderr, "Error, invalid device number %d\n", device_number);
-		return -1;
-	}
-	xmlNode *n = search_node(device, "ConfigData");
-	esi->sii->preamble = parse_preamble(n);
-	esi->sii->config = parse_config(root, device);
+	xmlNode *device = dev->node;
+	xmlNode *n = search_node(device, ESI_TAG_CONFIG_DATA);
+	sii->preamble = parse_preamble(sii, n);
+	sii->config = parse_config(sii, index->vendor, dev);
 
-	struct _sii_general *general = parse_general(esi->sii, root, device);
-	struct _sii_cat *gencat = calloc(1, sizeof(struct _sii_cat));
-	gencat->type = SII_CAT_GENERAL;
+	struct _sii_cat *gencat = sii_category_new(sii, SII_CAT_GENERAL);
 	gencat->size = sizeof(struct _sii_general);
-	gencat->data = (void *)general;
-	sii_category_add(esi->sii, gencat);
+	parse_general(sii, index->groups, device, (struct _sii_general *)gencat->data);
+	sii_category_add(sii, gencat);
 
 	/* iterate through children of node 'Device' and get the necessary informations */
 	for (xmlNode *current = device->children; current; current = current->next) {
 		//printf("[DEBUG %s] start parsing of %s\n", __func__, current->name);
-		if (xmlStrncmp(current->name, Char2xmlChar("Fmmu"), xmlStrlen(current->name)) == 0) {
-			parse_fmmu(current, esi->sii);
-		} else if (xmlStrncmp(current->name, Char2xmlChar("Sm"), xmlStrlen(current->name)) == 0) {
-			parse_syncm(current, esi->sii);
-		} else if (xmlStrncmp(current->name, Char2xmlChar("Dc"), xmlStrlen(current->name)) == 0) {
-			parse_dclock(current, esi->sii);
-		} else if (xmlStrncmp(current->name, Char2xmlChar("RxPdo"), xmlStrlen(current->name)) == 0) {
-			parse_pdo(current, esi->sii, include_pdo_strings);
-		} else if (xmlStrncmp(current->name, Char2xmlChar("TxPdo"), xmlStrlen(current->name)) == 0) {
-			parse_pdo(current, esi->sii, include_pdo_strings);
+		switch (node_tag(current)) {
+		case ESI_TAG_FMMU:
+			parse_fmmu(current, sii);
+			break;
+		case ESI_TAG_SM:
+			parse_syncm(current, sii);
+			break;
+		case ESI_TAG_DC:
+			parse_dclock(current, sii);
+			break;
+		case ESI_TAG_RX_PDO:
+		case ESI_TAG_TX_PDO:
+			parse_pdo(current, sii, include_pdo_strings);
+			break;
+		default:
+			break;
 		}
 	}
 
 	return 0;
 }
 
+int esi_parse_select(EsiData *esi, const struct _esi_device_selector *sel, int include_pdo_strings)
+{
+	struct _esi_index *index = esi_index(esi);
+	if (index == NULL)
+		return -1;
+
+	struct _esi_device *dev = index_lookup(index, sel);
+	if (dev == NULL) {
+		if (sel->keys == ESI_SELECT_NUMBER)
+			sii_error("Error, invalid device number %d\n", sel->number);
+		else
+			sii_error("Error, no matching device found\n");
+		return -1;
+	}
+
+	return parse_device(esi->sii, index, dev, include_pdo_strings);
+}
+
+int esi_device_count(EsiData *esi)
+{
+	struct _esi_index *index = esi_index(esi);
+
+	return (index != NULL) ? index->count : -1;
+}
+
+SiiInfo *esi_parse_device(EsiData *esi, int device_number, int include_pdo_strings)
+{
+	struct _esi_index *index = esi->index;
+
+	if (index == NULL || device_number < 0 || device_number >= index->count) {
+		sii_error("Error, invalid device number %d\n", device_number);
+		return NULL;
+	}
+
+	SiiInfo *sii = sii_init();
+	if (parse_device(sii, index, &index->device[device_number], include_pdo_strings) != 0) {
+		sii_release(sii);
+		return NULL;
+	}
+
+	return sii;
+}
+
 void esi_print_xml(EsiData *esi)
 {
 	xmlNode *root = xmlDocGetRootElement(esi->doc);
 	//parse_example(root);
-	xmlNode *node = search_node(root, "Device");
+	xmlNode *node = search_node(root, ESI_TAG_DEVICE);
 	printf("\n+++ Printing all nodes +++\n");
 	print_all_nodes(node);
 	//xmlDocDump(stdout, esi->doc);
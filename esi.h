@@ -8,19 +8,100 @@
 
 #include "sii.h"
 #include <unistd.h>
+#include <stdint.h>
 
 typedef struct _esi_data EsiData;
 
+#define ESI_SELECT_NUMBER     0x01
+#define ESI_SELECT_PRODUCT    0x02
+#define ESI_SELECT_REVISION   0x04
+#define ESI_SELECT_NAME       0x08
+
+/* Selects a <Device>, either by position or by the content of its <Type>
+ * element. If several keys are set all of them must match, the first
+ * matching device is used. */
+struct _esi_device_selector {
+	unsigned int keys;     /* mask of ESI_SELECT_* */
+	int number;            /* position within <Devices> */
+	uint32_t product_id;   /* Type@ProductCode */
+	uint32_t revision_id;  /* Type@RevisionNo */
+	char name[128];        /* text of <Type> */
+};
+
+/**
+ * \brief Parse a device selector
+ *
+ * Accepts a plain device number or a comma separated list of the keys
+ * 'product', 'rev' and 'name', e.g. "product=0x2303,rev=0x0a".
+ *
+ * \return 0 on success, -1 if str is malformed
+ */
+int esi_selector_parse(struct _esi_device_selector *sel, const char *str);
+
+/* set up libxml2, safe to call from several threads, the esi_init_*()
+ * functions call it on their own */
+void esi_library_init(void);
+
 EsiData *esi_init(const char *file);
 EsiData *esi_init_file(const char *file);
 EsiData *esi_init_string(const unsigned char *file, size_t size);
 
+/**
+ * \brief Read only the selected device of an ESI
+ *
+ * The XML is streamed and only <Vendor>, <Groups> and the device matching sel
+ * are kept. In the returned object the selected device is
+ * device number 0.
+ */
+EsiData *esi_init_stream(const unsigned char *file, size_t size,
+		const struct _esi_device_selector *sel);
+
+/* vendor and <Type> of a device, alias of its <ConfigData> */
+struct _esi_ident {
+	uint32_t vendor_id;
+	uint32_t product_id;
+	uint32_t revision_id;
+	uint16_t alias;
+	char name[128];
+};
+
+#define ESI_IDENT_ALIAS  0x01  /* also read the <ConfigData> of the device */
+
+/**
+ * \brief Identify the device selected by sel without building a document
+ *
+ * The ESI is read only up to the <Type> of the matching device or, with
+ * ESI_IDENT_ALIAS, up to its <ConfigData>.
+ *
+ * \return 0 on success, -1 if the ESI is malformed or no device matches
+ */
+int esi_stream_ident(const unsigned char *file, size_t size,
+		const struct _esi_device_selector *sel, unsigned int flags, struct _esi_ident *ident);
+
 void esi_release(EsiData *esi);
 
 void esi_print_xml(EsiData *esi);
 void esi_print_sii(EsiData *esi);
 
+/* print position, product code, revision and type of every device */
+void esi_print_devices(FILE *f, EsiData *esi);
+
 int esi_parse(EsiData *esi, int device_number, int include_pdo_strings);
+int esi_parse_select(EsiData *esi, const struct _esi_device_selector *sel, int include_pdo_strings);
+
+/* number of <Device> entries, also builds the device index, -1 if out of
+ * memory */
+int esi_device_count(EsiData *esi);
+
+/**
+ * \brief Parse one device into a new SiiInfo
+ *
+ * Unlike esi_parse() the EsiData is not modified, so after esi_device_count()
+ * was called once this can run for different devices in parallel.
+ *
+ * \return new sii object, release with sii_release()
+ */
+SiiInfo *esi_parse_device(EsiData *esi, int device_number, int include_pdo_strings);
 
 SiiInfo *esi_get_sii(EsiData *esi);
 #endif /* ESI_H */
@@ -1,4 +1,5 @@
 #include "esifile.h"
+#include "log.h"
 #include <stdio.h>
 #include <string.h>
 
@@ -25,7 +26,7 @@ enum eFileType efile_type(const char *file)
 	// - first 4 bytes (?) -> "<?xml" or binary bits
 	const char *suffix = efile_suffix(file);
 	if (suffix == NULL) {
-		printf("Warning no suffix\n");
+		sii_warning("Warning no suffix\n");
 		type = UNKNOWN;
 	} else if (strncmp(suffix, "xml", 3) == 0) {
 		type = XML;
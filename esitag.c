@@ -0,0 +1,100 @@
+/* esitag - names of the ESI vocabulary
+ */
+
+#include "esitag.h"
+
+#include <string.h>
+
+struct _tag_entry {
+	const char *name;
+	size_t length;
+	enum eEsiTag tag;
+};
+
+/* Perfect hash of the vocabulary, generated by misc/esitag.py: every name
+ * has its own slot, so a lookup is one hash and one compare. */
+#define TAG_HASH_A  61
+#define TAG_HASH_B  2
+#define TAG_HASH_C  53
+#define TAG_HASH_SIZE  128
+
+static const struct _tag_entry tag_table[TAG_HASH_SIZE] = {
+	[2] = { "Type", 4, ESI_TAG_TYPE },
+	[5] = { "SubIndex", 8, ESI_TAG_SUB_INDEX },
+	[6] = { "VoE", 3, ESI_TAG_VOE },
+	[10] = { "Inputs", 6, ESI_TAG_INPUTS },
+	[11] = { "Enable", 6, ESI_TAG_ENABLE },
+	[14] = { "Index", 5, ESI_TAG_INDEX },
+	[16] = { "Groups", 6, ESI_TAG_GROUPS },
+	[17] = { "PdoUpload", 9, ESI_TAG_PDO_UPLOAD },
+	[19] = { "MBoxIn", 6, ESI_TAG_MBOX_IN },
+	[22] = { "ConfigData", 10, ESI_TAG_CONFIG_DATA },
+	[25] = { "OverwrittenByModule", 19, ESI_TAG_OVERWRITTEN_BY_MODULE },
+	[28] = { "Vendor", 6, ESI_TAG_VENDOR },
+	[30] = { "OpMode", 6, ESI_TAG_OP_MODE },
+	[32] = { "MBoxOut", 7, ESI_TAG_MBOX_OUT },
+	[43] = { "Dictionary", 10, ESI_TAG_DICTIONARY },
+	[44] = { "Mailbox", 7, ESI_TAG_MAILBOX },
+	[45] = { "Fmmu", 4, ESI_TAG_FMMU },
+	[47] = { "RevisionNo", 10, ESI_TAG_REVISION_NO },
+	[52] = { "Sm", 2, ESI_TAG_SM },
+	[54] = { "FoE", 3, ESI_TAG_FOE },
+	[59] = { "ByteSize", 8, ESI_TAG_BYTE_SIZE },
+	[65] = { "Device", 6, ESI_TAG_DEVICE },
+	[68] = { "PdoAssign", 9, ESI_TAG_PDO_ASSIGN },
+	[70] = { "ShiftTimeSync0", 14, ESI_TAG_SHIFT_TIME_SYNC0 },
+	[71] = { "ControlByte", 11, ESI_TAG_CONTROL_BYTE },
+	[72] = { "ShiftTimeSync1", 14, ESI_TAG_SHIFT_TIME_SYNC1 },
+	[73] = { "SdoInfo", 7, ESI_TAG_SDO_INFO },
+	[75] = { "Group", 5, ESI_TAG_GROUP },
+	[76] = { "Physics", 7, ESI_TAG_PHYSICS },
+	[77] = { "Desc", 4, ESI_TAG_DESC },
+	[82] = { "BootStrap", 9, ESI_TAG_BOOT_STRAP },
+	[83] = { "Fixed", 5, ESI_TAG_FIXED },
+	[84] = { "AssignActivate", 14, ESI_TAG_ASSIGN_ACTIVATE },
+	[86] = { "Descriptions", 12, ESI_TAG_DESCRIPTIONS },
+	[88] = { "BitLen", 6, ESI_TAG_BIT_LEN },
+	[91] = { "MBoxState", 9, ESI_TAG_MBOX_STATE },
+	[94] = { "Devices", 7, ESI_TAG_DEVICES },
+	[95] = { "ImageData16x14", 14, ESI_TAG_IMAGE_DATA_16X14 },
+	[97] = { "Virtual", 7, ESI_TAG_VIRTUAL },
+	[98] = { "PdoConfig", 9, ESI_TAG_PDO_CONFIG },
+	[99] = { "Id", 2, ESI_TAG_ID },
+	[100] = { "ProductCode", 11, ESI_TAG_PRODUCT_CODE },
+	[101] = { "DefaultSize", 11, ESI_TAG_DEFAULT_SIZE },
+	[105] = { "Mandatory", 9, ESI_TAG_MANDATORY },
+	[106] = { "DataType", 8, ESI_TAG_DATA_TYPE },
+	[107] = { "Eeprom", 6, ESI_TAG_EEPROM },
+	[108] = { "Entry", 5, ESI_TAG_ENTRY },
+	[109] = { "StartAddress", 12, ESI_TAG_START_ADDRESS },
+	[112] = { "Outputs", 7, ESI_TAG_OUTPUTS },
+	[117] = { "Name", 4, ESI_TAG_NAME },
+	[118] = { "CycleTimeSync0", 14, ESI_TAG_CYCLE_TIME_SYNC0 },
+	[119] = { "TxPdo", 5, ESI_TAG_TX_PDO },
+	[120] = { "CycleTimeSync1", 14, ESI_TAG_CYCLE_TIME_SYNC1 },
+	[121] = { "EoE", 3, ESI_TAG_EOE },
+	[123] = { "Dc", 2, ESI_TAG_DC },
+	[125] = { "RxPdo", 5, ESI_TAG_RX_PDO },
+	[127] = { "CoE", 3, ESI_TAG_COE },
+};
+
+static unsigned int tag_hash(const unsigned char *name, size_t length)
+{
+	return (unsigned int)(length + TAG_HASH_A * name[0] + TAG_HASH_B * name[length-1] +
+			TAG_HASH_C * name[length/2]) & (TAG_HASH_SIZE - 1);
+}
+
+enum eEsiTag esi_tag(const unsigned char *name)
+{
+	if (name == NULL || *name == '\0')
+		return ESI_TAG_UNKNOWN;
+
+	size_t length = strlen((const char *)name);
+	const struct _tag_entry *entry = &tag_table[tag_hash(name, length)];
+
+	if (entry->name == NULL || entry->length != length ||
+	    memcmp(entry->name, name, length) != 0)
+		return ESI_TAG_UNKNOWN;
+
+	return entry->tag;
+}
@@ -0,0 +1,78 @@
+/* esitag - names of the ESI vocabulary
+ *
+ * Element names, attribute names and the few element values the parser
+ * looks at are resolved to an enum once, the parser then dispatches with a
+ * switch. Matching is exact, unlike the former prefix compares.
+ */
+
+#ifndef ESITAG_H
+#define ESITAG_H
+
+#include <stddef.h>
+
+/* generated together with the lookup table by misc/esitag.py */
+enum eEsiTag {
+	ESI_TAG_UNKNOWN = 0
+	,ESI_TAG_VENDOR
+	,ESI_TAG_DESCRIPTIONS
+	,ESI_TAG_GROUPS
+	,ESI_TAG_GROUP
+	,ESI_TAG_DEVICES
+	,ESI_TAG_DEVICE
+	,ESI_TAG_TYPE
+	,ESI_TAG_NAME
+	,ESI_TAG_ID
+	,ESI_TAG_SM
+	,ESI_TAG_FMMU
+	,ESI_TAG_DC
+	,ESI_TAG_OP_MODE
+	,ESI_TAG_DESC
+	,ESI_TAG_ASSIGN_ACTIVATE
+	,ESI_TAG_CYCLE_TIME_SYNC0
+	,ESI_TAG_CYCLE_TIME_SYNC1
+	,ESI_TAG_SHIFT_TIME_SYNC0
+	,ESI_TAG_SHIFT_TIME_SYNC1
+	,ESI_TAG_RX_PDO
+	,ESI_TAG_TX_PDO
+	,ESI_TAG_ENTRY
+	,ESI_TAG_INDEX
+	,ESI_TAG_SUB_INDEX
+	,ESI_TAG_BIT_LEN
+	,ESI_TAG_DATA_TYPE
+	,ESI_TAG_MAILBOX
+	,ESI_TAG_COE
+	,ESI_TAG_EOE
+	,ESI_TAG_FOE
+	,ESI_TAG_VOE
+	,ESI_TAG_EEPROM
+	,ESI_TAG_BYTE_SIZE
+	,ESI_TAG_BOOT_STRAP
+	,ESI_TAG_CONFIG_DATA
+	,ESI_TAG_DICTIONARY
+	,ESI_TAG_IMAGE_DATA_16X14
+	,ESI_TAG_PRODUCT_CODE
+	,ESI_TAG_REVISION_NO
+	,ESI_TAG_PHYSICS
+	,ESI_TAG_SDO_INFO
+	,ESI_TAG_PDO_ASSIGN
+	,ESI_TAG_PDO_CONFIG
+	,ESI_TAG_PDO_UPLOAD
+	,ESI_TAG_DEFAULT_SIZE
+	,ESI_TAG_START_ADDRESS
+	,ESI_TAG_CONTROL_BYTE
+	,ESI_TAG_ENABLE
+	,ESI_TAG_FIXED
+	,ESI_TAG_MANDATORY
+	,ESI_TAG_VIRTUAL
+	,ESI_TAG_OVERWRITTEN_BY_MODULE
+	,ESI_TAG_INPUTS
+	,ESI_TAG_OUTPUTS
+	,ESI_TAG_MBOX_STATE
+	,ESI_TAG_MBOX_IN
+	,ESI_TAG_MBOX_OUT
+};
+
+/* tag of name, ESI_TAG_UNKNOWN if it is not part of the vocabulary */
+enum eEsiTag esi_tag(const unsigned char *name);
+
+#endif /* ESITAG_H */
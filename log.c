@@ -0,0 +1,39 @@
+/* log - diagnostic messages of sii, esi and friends
+ */
+
+#include "log.h"
+
+#include <stdio.h>
+#include <stdarg.h>
+
+#define MAX_MESSAGE_SIZE  (1024)
+
+struct _handler {
+	log_handler_fn fn;
+	void *arg;
+};
+
+static __thread struct _handler g_handler = { NULL, NULL };
+
+void log_set_handler(log_handler_fn fn, void *arg)
+{
+	g_handler.fn = fn;
+	g_handler.arg = arg;
+}
+
+void log_message(enum eLogLevel level, const char *format, ...)
+{
+	va_list ap;
+
+	va_start(ap, format);
+
+	if (g_handler.fn == NULL) {
+		vfprintf(stderr, format, ap);
+	} else {
+		char msg[MAX_MESSAGE_SIZE];
+		vsnprintf(msg, sizeof(msg), format, ap);
+		g_handler.fn(g_handler.arg, level, msg);
+	}
+
+	va_end(ap);
+}
@@ -0,0 +1,27 @@
+/* log - diagnostic messages of sii, esi and friends
+ *
+ * Without a handler the messages go to stderr. A handler is installed per
+ * thread, so every thread can collect the messages of its own work.
+ */
+
+#ifndef LOG_H
+#define LOG_H
+
+enum eLogLevel {
+	SII_LOG_ERROR = 0
+	,SII_LOG_WARNING
+};
+
+/* msg is the formatted message, usually terminated by a newline */
+typedef void (*log_handler_fn)(void *arg, enum eLogLevel level, const char *msg);
+
+/* install handler for the calling thread, fn == NULL restores stderr */
+void log_set_handler(log_handler_fn fn, void *arg);
+
+void log_message(enum eLogLevel level, const char *format, ...)
+	__attribute__((format(printf, 2, 3)));
+
+#define sii_error(...)    log_message(SII_LOG_ERROR, __VA_ARGS__)
+#define sii_warning(...)  log_message(SII_LOG_WARNING, __VA_ARGS__)
+
+#endif /* LOG_H */
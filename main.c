@@ -40,15 +40,28 @@
 #include "sii.h"
 #include "esi.h"
 #include "esifile.h"
+#include "pool.h"
+#include "siiindex.h"
 
 #include <stdio.h>
 #include <stdint.h>
 #include <string.h>
 #include <stdlib.h>
 #include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <dirent.h>
 
-#define MAX_BUFFER_SIZE    (2*1000*1000)
+#define READ_BLOCK_SIZE    (64*1024)
 #define MAX_FILENAME_SIZE  (256)
+#define DEFAULT_TEMPLATE   "%p-%r.sii"
+#define STAMP_TEMPLATE     "%p-%r-%s.sii"
+#define MAX_SERIALS        (16*1024*1024)
+#define DEFAULT_READ_SIZE  4
+#define DEFAULT_ACCESS_US  100
 
 enum eInputFileType {
 	UNDEFINED = 0
@@ -56,10 +69,76 @@ enum eInputFileType {
 	,SIIEEPROM
 };
 
-//static int g_print_offsets = 0;
-static int g_print_content = 0;
-static unsigned int g_add_pdo_mapping = 0;
-static unsigned int g_add_dc_section = 0;
+/* summary of --scan */
+enum eScanFormat {
+	SCAN_NONE = 0
+	,SCAN_CSV
+	,SCAN_JSON
+};
+
+/* values of --get */
+enum eField {
+	FIELD_VENDOR_ID = 0
+	,FIELD_PRODUCT_ID
+	,FIELD_REVISION_ID
+	,FIELD_SERIAL
+	,FIELD_ALIAS
+	,FIELD_HASH
+	,FIELD_COUNT
+};
+
+#define MAX_FIELDS  16
+
+static const char *field_name[FIELD_COUNT] = {
+	"vendor_id", "product_id", "revision_id", "serial", "alias", "hash"
+};
+
+/* fields of --get in the order given */
+struct _fields {
+	enum eField field[MAX_FIELDS];
+	int count;
+};
+
+/* input buffer, either mapped from a regular file or read from a stream */
+struct _input {
+	unsigned char *buffer;
+	size_t length;   /* number of valid bytes in buffer */
+	int mapped;
+};
+
+/* settings of one run, read only while the jobs are running */
+/* serial numbers of -S in the order given */
+struct _serials {
+	uint32_t *serial;
+	size_t count;
+	size_t capacity;
+};
+
+struct _options {
+	int print_content;
+	unsigned int add_pdo_mapping;
+	unsigned int add_dc_section;
+	int stream_input;
+	int list_devices;
+	int all_devices;
+	int batch;
+	unsigned int write_flags; /* SII_WRITE_* */
+	struct _serials serials;  /* -S, stamp one image per serial */
+	long alias;               /* -A, alias of the first stamped image, -1: keep */
+	const char *flash_dump;   /* -F, current EEPROM content for the flash plan */
+	enum eSiiCatOrder order;  /* -O, order of the categories */
+	int order_set;            /* -O was given, SII input is sorted */
+	int size_report;          /* --size-report */
+	const char *sidecar;      /* --sidecar, category directory of the output */
+	enum eScanFormat scan;    /* --scan, validate EEPROM dumps */
+	struct _fields get;       /* --get, values printed per input */
+	const char *diff_file;    /* --diff, image compared with the generated SII */
+	const char *index_out;    /* --build-index, signatures of the ESI devices */
+	const char *index_in;     /* --lookup, index the dumps are looked up in */
+	struct _sii_read_model read_model;
+	unsigned int workers; /* 0: one per processor */
+	struct _esi_device_selector device;
+};
 
 static const char *base(const char *prog)
 {
@@ -153,6 +232,7 @@ static enum eInputFileType file_type(const char *filename, unsigned char *buffer
 static void printhelp(const char *prog)
 {
 	printf("Usage: %s [-h] [-v] [-p] [-o outfile] [filename]\n", prog);
+	printf("       %s -b [-p] [-o outdir] file|directory ...\n", prog);
 	printf("  -h         print this help and exit\n");
 	printf("  -v         print version an exit\n");
 	printf("  -m         write pdo mapping to SII file\n");
@@ -160,205 +240,2164 @@ static void printhelp(const char *prog)
 	printf("  -o <name>  write output to file <name>\n");
 	printf("  -p         print content human readable\n");
 	printf("  -d <num>   select device number <num>, default <num> = 0\n");
+	printf("  -d <sel>   select device by product, rev and/or name, e.g. product=0x2303,rev=0x0a\n");
+	printf("  -l         list the devices of the ESI and exit\n");
+	printf("  -a         generate a SII for every device of the ESI, -o takes a name template\n");
+	printf("             with %%p (product code), %%r (revision) and %%n (device number),\n");
+	printf("             default: '%%p-%%r.sii'\n");
+	printf("  -b         batch mode, process all given files and the .xml, .bin and .sii\n");
+	printf("             files below the given directories, each input <name>.<suffix>\n");
+	printf("             is written to <name>.sii in the directory -o <outdir> or next\n");
+	printf("             to the input, results are reported in input order\n");
+	printf("  -j <num>   number of worker threads, default one per processor\n");
+	printf("  -f         fsync output files, outputs are always replaced atomically\n");
+	printf("  -S <list>  stamp one SII per serial number of <list>, e.g. 1000-1999,2500,\n");
+	printf("             -o takes a name template with %%p, %%r, %%n (index) and\n");
+	printf("             %%s (serial number), default: '%%p-%%r-%%s.sii'\n");
+	printf("  -A <alias> station alias of the first stamped SII, incremented per serial\n");
+	printf("  -O <order> order of the categories, 'type' (default): increasing category\n");
+	printf("             type, 'startup': General, SyncM, FMMU, DC and PDOs before the\n");
+	printf("             strings for masters which stop reading early\n");
+	printf("  -F <dump>  write the word ranges which differ from the EEPROM content <dump>\n");
+	printf("             and the estimated write time as JSON instead of the SII\n");
+	printf("  -s         stream ESI input, only the selected device is kept in memory\n");
+	printf("  --size-report\n");
+	printf("             print offset, size and estimated read time of every category\n");
+	printf("             instead of the SII, ESI input is reported as generated\n");
+	printf("  --read-size <bytes>\n");
+	printf("             bytes per EEPROM read of the master: 2, 4 or 8, default %d\n", DEFAULT_READ_SIZE);
+	printf("  --access-us <us>\n");
+	printf("             duration of one EEPROM read in us, default %d\n", DEFAULT_ACCESS_US);
+	printf("  --sidecar <file>\n");
+	printf("             write the word offset of every category and PDO of the SII to\n");
+	printf("             <file>, a C header for *.h, otherwise a binary table\n");
+	printf("  --scan <format>\n");
+	printf("             validate the preamble checksum and category chain of the .bin\n");
+	printf("             and .sii files below the given directories and print the number\n");
+	printf("             of units per vendor, product and revision as 'csv' or 'json'\n");
+	printf("  --get <fields>\n");
+	printf("             print the comma separated fields vendor_id, product_id,\n");
+	printf("             revision_id, serial, alias and hash of every input as one line\n");
+	printf("             '<file>,<value>,...', only the headers of the input are read\n");
+	printf("             unless the content hash of the SII is requested\n");
+	printf("  --diff <file>\n");
+	printf("             print the differences of the SII or ESI <file> to the input\n");
+	printf("             instead of the SII, PDOs are matched by index and strings\n");
+	printf("             compared by text, nothing is printed if the content is equal\n");
+	printf("  --build-index <file>\n");
+	printf("             write the signatures of all devices of the .xml files below\n");
+	printf("             the given directories to the index <file>\n");
+	printf("  --lookup <file>\n");
+	printf("             print the ESI file and device of the index <file> which\n");
+	printf("             matches each .bin and .sii file best as one line\n");
+	printf("             '<file>,<esi>,<device>,<match>', <match> is 'exact' or the\n");
+	printf("             matching fields\n");
 	printf("  filename   path to eeprom file, if missing read from stdin\n");
 	printf("\nRecognized file types: SII and ESI/XML.\n");
 }
 
-static unsigned char * read_input(FILE *f, unsigned char *bufptr, size_t *size)
+/* Slow path for pipes and terminals: read in large blocks. */
+static int read_input_stream(int fd, struct _input *in)
 {
-	size_t capacity = *size;
+	size_t capacity = READ_BLOCK_SIZE;
 	size_t count = 0;
-	int input;
-	unsigned char *buffer = NULL;
+	unsigned char *buffer = malloc(capacity);
 
-	if (bufptr == NULL) {
-		buffer = malloc(capacity);
+	if (buffer == NULL) {
+		fprintf(stderr, "Malloc failed! Out of memory?\n");
+		return -1;
 	}
 
-	while ((input=fgetc(f)) != EOF) {
-		buffer[count++] = (unsigned char)(input&0xff);
-
-		if (count >= (capacity - 1)) {
-			capacity += (capacity / 2);
-			buffer = realloc(buffer, capacity);
-
-			if (buffer == NULL) {
+	for (;;) {
+		if ((capacity - count) < READ_BLOCK_SIZE) {
+			unsigned char *tmp = realloc(buffer, capacity * 2);
+			if (tmp == NULL) {
 				fprintf(stderr, "Realloc failed! Out of memory?\n");
-				*size = 0;
-				return NULL;
+				free(buffer);
+				return -1;
 			}
+
+			buffer = tmp;
+			capacity *= 2;
+		}
+
+		ssize_t rd = read(fd, buffer + count, capacity - count);
+		if (rd < 0) {
+			if (errno == EINTR)
+				continue;
+
+			perror("Error reading input");
+			free(buffer);
+			return -1;
 		}
+
+		if (rd == 0)
+			break;
+
+		count += (size_t)rd;
 	}
 
-	/* Fill the last part of the buffer capacity with zero */
-	memset((buffer+count), 0, capacity-count);
-	*size = capacity;
+	in->buffer = buffer;
+	in->length = count;
+	in->mapped = 0;
 
-	return buffer;
+	return 0;
 }
 
-static int parse_xml_input(const unsigned char *buffer, size_t length, unsigned int device, const char *output)
+/* Regular files are mapped read only and handed to the parsers without a
+ * copy. The parsers are bounded by in->length, a file which fills its last
+ * page exactly has nothing mapped behind it. Everything else falls back to
+ * read_input_stream(). */
+static int read_input(int fd, struct _input *in)
 {
-	EsiData *esi = esi_init_string(buffer, length);
-	//esi_print_xml(esi);
+	struct stat st;
 
-	int include_pdo_strings = g_add_pdo_mapping || g_print_content;
-	if (esi_parse(esi, device, include_pdo_strings)) {
-		fprintf(stderr, "Error something went wrong in XML parsing\n");
-		esi_release(esi);
+	if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+		void *map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (map != MAP_FAILED) {
+			in->buffer = map;
+			in->length = (size_t)st.st_size;
+			in->mapped = 1;
+			return 0;
+		}
+	}
+
+	return read_input_stream(fd, in);
+}
+
+static int read_file(const char *filename, struct _input *input)
+{
+	int fd = open(filename, O_RDONLY);
+	if (fd < 0) {
+		fprintf(stderr, "Error open input file '%s': %s\n", filename, strerror(errno));
 		return -1;
 	}
 
-	SiiInfo *sii = esi_get_sii(esi);
-	sii_cat_sort(sii);
-	if (g_print_content) {
-		sii_print(sii);
-	} else {
-		sii_generate(sii, g_add_pdo_mapping, g_add_dc_section);
-		int ret = sii_write_bin(sii, output);
-		if (ret < 0) {
-			fprintf(stderr, "Error, couldn't write output file\n");
-			esi_release(esi);
-			return -1;
+#if DEBUG == 1
+	printf("Start reading contents of file %s\n", filename);
+#endif
+
+	int ret = read_input(fd, input);
+	close(fd);
+
+	return ret;
+}
+
+static void release_input(struct _input *in)
+{
+	if (in->buffer == NULL)
+		return;
+
+	if (in->mapped)
+		munmap(in->buffer, in->length);
+	else
+		free(in->buffer);
+
+	in->buffer = NULL;
+	in->length = 0;
+}
+
+/* expand %p, %r, %n and %s of the -a and -S output name template */
+static int expand_template(char *name, size_t size, const char *template,
+		int number, const struct _sii_stdconfig *cfg)
+{
+	size_t len = 0;
+	int n;
+
+	for (const char *t = template; *t != '\0'; t++) {
+		if (*t != '%') {
+			n = 1;
+			if (len + 1 < size)
+				name[len] = *t;
+		} else {
+			switch (*(++t)) {
+			case 'p':
+				n = snprintf(name+len, (len < size) ? size-len : 0, "%08x", cfg->product_id);
+				break;
+			case 'r':
+				n = snprintf(name+len, (len < size) ? size-len : 0, "%08x", cfg->revision_id);
+				break;
+			case 'n':
+				n = snprintf(name+len, (len < size) ? size-len : 0, "%d", number);
+				break;
+			case 's':
+				n = snprintf(name+len, (len < size) ? size-len : 0, "%u", cfg->serial);
+				break;
+			case '%':
+				n = 1;
+				if (len + 1 < size)
+					name[len] = '%';
+				break;
+			default:
+				fprintf(stderr, "Error, invalid output template '%s'\n", template);
+				return -1;
+			}
 		}
 
-		printf("= %s generated\n", output);
+		len += (size_t)n;
 	}
 
-	esi_release(esi);
+	if (len >= size) {
+		fprintf(stderr, "Error, output name too long\n");
+		return -1;
+	}
+
+	name[len] = '\0';
 
 	return 0;
 }
 
-static int parse_sii_input(const unsigned char *buffer, const char *output)
+/* generate the sii, optional content is dropped if it doesn't fit into the
+ * EEPROM */
+static size_t generate_sii(const struct _options *opt, SiiInfo *sii)
 {
-	SiiInfo *sii = sii_init_string(buffer, 1024);
-	//alternative: SiiInfo *sii = sii_init_file(filename) */
+	unsigned int add_pdo_mapping = opt->add_pdo_mapping;
 
-	if (g_print_content)
-		sii_print(sii);
-	else {
-		sii_generate(sii, g_add_pdo_mapping, g_add_dc_section);
-		int ret = sii_write_bin(sii, output);
-		if (ret < 0) {
-			fprintf(stderr, "Error, couldn't write output file\n");
-			return -1;
+	sii_optimize(sii, &add_pdo_mapping, opt->add_dc_section);
+
+	return sii_generate(sii, add_pdo_mapping, opt->add_dc_section);
+}
+
+struct _device_job {
+	SiiInfo *sii;
+	char output[MAX_FILENAME_SIZE];
+	int ret;
+};
+
+struct _all_devices {
+	const struct _options *opt;
+	EsiData *esi;
+	const char *template;
+	struct _device_job *job;
+};
+
+static void device_worker(void *arg, size_t n, unsigned int worker)
+{
+	struct _all_devices *all = (struct _all_devices *)arg;
+	struct _device_job *job = &all->job[n];
+	const struct _options *opt = all->opt;
+	int include_pdo_strings = opt->add_pdo_mapping || opt->print_content;
+
+	(void)worker;
+
+	job->sii = esi_parse_device(all->esi, (int)n, include_pdo_strings);
+	if (job->sii == NULL) {
+		job->ret = -1;
+		return;
+	}
+
+	sii_cat_sort_order(job->sii, opt->order);
+
+	if (opt->print_content) /* printing is done in device order by the caller */
+		return;
+
+	if (expand_template(job->output, sizeof(job->output), all->template, (int)n, job->sii->config) != 0) {
+		job->ret = -1;
+		return;
+	}
+
+	if (generate_sii(opt, job->sii) == 0) {
+		job->ret = -1;
+		return;
+	}
+
+	job->ret = sii_write_bin_flags(job->sii, job->output, opt->write_flags);
+}
+
+/* all devices of an already parsed document, one SII each */
+static int parse_all_devices(const struct _options *opt, EsiData *esi,
+		const char *output, FILE *out)
+{
+	struct _all_devices all;
+	int count = esi_device_count(esi);
+	int ret = 0;
+
+	all.opt = opt;
+	all.esi = esi;
+	all.template = (output != NULL) ? output : DEFAULT_TEMPLATE;
+	if (count < 0)
+		return -1;
+
+	all.job = calloc(count > 0 ? count : 1, sizeof(struct _device_job));
+	if (all.job == NULL) {
+		fprintf(stderr, "Malloc failed! Out of memory?\n");
+		return -1;
+	}
+
+	if (!opt->print_content && strchr(all.template, '%') == NULL && count > 1) {
+		fprintf(stderr, "Error, output name needs %%p, %%r or %%n to write multiple devices\n");
+		free(all.job);
+		return -1;
+	}
+
+	if (pool_run(opt->workers, (size_t)count, device_worker, &all) != 0) {
+		fprintf(stderr, "Error, couldn't run worker pool\n");
+		free(all.job);
+		return -1;
+	}
+
+	for (int i = 0; i < count; i++) {
+		struct _device_job *job = &all.job[i];
+
+		if (job->ret < 0) {
+			fprintf(stderr, "Error, couldn't generate device %d\n", i);
+			ret = -1;
+		} else if (opt->print_content) {
+			fprintf(out, "=== Device %d\n", i);
+			sii_fprint(out, job->sii);
+		} else {
+			fprintf(out, "= %s generated\n", job->output);
 		}
 
-		printf("= %s generated\n", output);
+		if (job->sii != NULL)
+			sii_release(job->sii);
 	}
 
-	sii_release(sii);
+	free(all.job);
 
-	return 0;
+	return ret;
 }
 
-int main(int argc, char *argv[])
+/* -S list: comma separated serial numbers and ranges <first>-<last> */
+static int parse_serials(const char *arg, struct _serials *serials)
 {
-	FILE *f;
-	unsigned char *eeprom = NULL;
-	size_t eeprom_length = MAX_BUFFER_SIZE;
-	char *filename = NULL;
-	char *output = NULL;
-	int ret = -1;
-	unsigned int device = 0;
+	const char *p = arg;
 
-	/* FIXME rewrite using getopt() */
-	for (int i=1; i<argc; i++) {
-		switch (argv[i][0]) {
-		case '-':
-			if (argv[i][1] == 'h') {
-				printhelp(base(argv[0]));
-				return 0;
-			} else if (argv[i][1] == 'v') {
-				printf("%s %s\n",
-					base(argv[0]),
-					VERSION);
-				return 0;
-			} else if (argv[i][1] == 'o') {
-				i++;
-				output = malloc(strlen(argv[i])+1);
-				memmove(output, argv[i], strlen(argv[i])+1);
-			} else if (argv[i][1] == 'p') {
-				g_print_content = 1;
-			} else if (argv[i][1] == 'm') {
-				g_add_pdo_mapping = 1;
-			} else if (argv[i][1] == 'c') {
-				g_add_dc_section = 1;
-			} else if (argv[i][1] == 'd') {
-				sscanf(argv[i+1], "%d", &device);
-			} else if (argv[i][1] == '\0') { /* read from stdin (default) */
-				filename = NULL;
-			} else {
-				fprintf(stderr, "Invalid argument\n");
-				printhelp(base(argv[0]));
-				return 0;
-			}
-			break;
+	while (*p != '\0') {
+		char *end;
+		unsigned long first = strtoul(p, &end, 0);
+		unsigned long last = first;
 
-		default:
-			/* asuming file name */
-			filename = argv[i];
-			break;
+		if (end == p || first > UINT32_MAX)
+			return -1;
+
+		p = end;
+		if (*p == '-') {
+			last = strtoul(++p, &end, 0);
+			if (end == p || last > UINT32_MAX || last < first)
+				return -1;
+			p = end;
 		}
+
+		if (*p == ',')
+			p++;
+		else if (*p != '\0')
+			return -1;
+
+		if (last - first >= MAX_SERIALS - serials->count)
+			return -1;
+
+		size_t count = serials->count + (size_t)(last - first) + 1;
+		if (count > serials->capacity) {
+			size_t capacity = serials->capacity ? serials->capacity : 64;
+			while (capacity < count)
+				capacity *= 2;
+
+			uint32_t *serial = realloc(serials->serial, capacity * sizeof(uint32_t));
+			if (serial == NULL)
+				return -1;
+
+			serials->serial = serial;
+			serials->capacity = capacity;
+		}
+
+		for (unsigned long s = first; s <= last; s++)
+			serials->serial[serials->count++] = (uint32_t)s;
 	}
 
-	if (filename == NULL)
-		eeprom = read_input(stdin, eeprom, &eeprom_length);
-	else {
-		f = fopen(filename, "r");
-		if (f == NULL) {
-			perror("Error open input file");
-			ret = -1;
-			goto finish;
+	return serials->count > 0 ? 0 : -1;
+}
+
+struct _stamp_units {
+	const struct _options *opt;
+	const struct _sii_stdconfig *config;
+	const char *template;
+	struct _sii_stamp stamp;
+	uint8_t *image;   /* one copy of the base image per worker */
+	size_t size;
+	int *ret;         /* per serial */
+};
+
+static void stamp_worker(void *arg, size_t n, unsigned int worker)
+{
+	struct _stamp_units *units = (struct _stamp_units *)arg;
+	const struct _options *opt = units->opt;
+	uint8_t *image = units->image + (size_t)worker * units->size;
+	struct _sii_stdconfig cfg = *units->config;
+	char output[MAX_FILENAME_SIZE];
+
+	cfg.serial = opt->serials.serial[n];
+	uint16_t alias = (opt->alias < 0) ? units->stamp.alias : (uint16_t)(opt->alias + (long)n);
+
+	if (expand_template(output, sizeof(output), units->template, (int)n, &cfg) != 0) {
+		units->ret[n] = -1;
+		return;
+	}
+
+	/* the copies differ from the base only in the stamped words */
+	sii_stamp(&units->stamp, image, cfg.serial, alias);
+	units->ret[n] = sii_write_file(output, image, units->size, opt->write_flags);
+}
+
+/* write a copy of the generated image for every serial of -S */
+static int stamp_units(const struct _options *opt, SiiInfo *sii, const char *output, FILE *out)
+{
+	struct _stamp_units units;
+	size_t count = opt->serials.count;
+	unsigned int workers = opt->workers ? opt->workers : pool_default_workers();
+	char name[MAX_FILENAME_SIZE];
+	int ret = 0;
+
+	units.opt = opt;
+	units.config = sii->config;
+	units.template = (output != NULL) ? output : STAMP_TEMPLATE;
+	units.size = sii->rawsize;
+
+	if (strstr(units.template, "%s") == NULL && strstr(units.template, "%n") == NULL && count > 1) {
+		fprintf(stderr, "Error, output name needs %%s or %%n to write multiple serial numbers\n");
+		return -1;
+	}
+
+	/* report template errors once instead of from every worker */
+	if (expand_template(name, sizeof(name), units.template, 0, sii->config) != 0)
+		return -1;
+
+	if (opt->alias >= 0 && opt->alias + (long)count - 1 > 0xffff) {
+		fprintf(stderr, "Error, alias 0x%lx exceeds 0xffff for %zu serial numbers\n", opt->alias, count);
+		return -1;
+	}
+
+	if (sii_stamp_init(&units.stamp, sii->rawbytes, sii->rawsize) != 0) {
+		fprintf(stderr, "Error, generated SII too short to stamp\n");
+		return -1;
+	}
+
+	units.image = malloc((size_t)workers * units.size);
+	units.ret = calloc(count, sizeof(int));
+	if (units.image == NULL || units.ret == NULL) {
+		fprintf(stderr, "Error, out of memory\n");
+		free(units.image);
+		free(units.ret);
+		return -1;
+	}
+
+	for (unsigned int i = 0; i < workers; i++)
+		memcpy(units.image + (size_t)i * units.size, sii->rawbytes, units.size);
+
+	if (pool_run(workers, count, stamp_worker, &units) != 0) {
+		fprintf(stderr, "Error, couldn't run worker pool\n");
+		ret = -1;
+	} else {
+		for (size_t i = 0; i < count; i++) {
+			if (units.ret[i] < 0) {
+				fprintf(stderr, "Error, couldn't write serial number %u\n", opt->serials.serial[i]);
+				ret = -1;
+			}
 		}
 
-#if DEBUG == 1
-		printf("Start reading contents of file %s\n", filename);
-#endif
+		if (ret == 0)
+			fprintf(out, "= %zu SII stamped\n", count);
+	}
 
-		eeprom = read_input(f, eeprom,  &eeprom_length);
-		fclose(f);
+	free(units.image);
+	free(units.ret);
+
+	return ret;
+}
+
+static void print_flash_plan(FILE *f, const uint8_t *image, size_t size,
+		const struct _sii_flash_range *range, size_t count)
+{
+	size_t words = 0;
+
+	for (size_t i = 0; i < count; i++)
+		words += range[i].count;
+
+	fprintf(f, "{\n");
+	fprintf(f, "  \"size\": %zu,\n", size);
+	fprintf(f, "  \"changed_words\": %zu,\n", words);
+	fprintf(f, "  \"write_time_ms\": %zu,\n", words * SII_FLASH_WORD_TIME_US / 1000);
+	fprintf(f, "  \"ranges\": [");
+
+	for (size_t i = 0; i < count; i++) {
+		fprintf(f, "%s\n    { \"word\": %zu, \"count\": %zu, \"data\": \"",
+				i > 0 ? "," : "", range[i].word, range[i].count);
+
+		for (size_t b = 2 * range[i].word; b < 2 * (range[i].word + range[i].count) && b < size; b++)
+			fprintf(f, "%02x", image[b]);
+
+		fprintf(f, "\" }");
+	}
+
+	fprintf(f, "%s]\n}\n", count > 0 ? "\n  " : "");
+}
+
+/* compare the generated sii with the EEPROM dump of -F and write the word
+ * ranges to flash as JSON to output */
+static int flash_plan(const struct _options *opt, SiiInfo *sii, const char *output, FILE *out)
+{
+	struct _input dump = { NULL, 0, 0 };
+	char *text = NULL;
+	size_t length = 0;
+	int ret = -1;
+
+	if (read_file(opt->flash_dump, &dump) != 0)
+		return -1;
+
+	/* only a dump which parses as SII is worth a plan, the words are
+	 * compared raw. A blank EEPROM starts with the end marker and passes. */
+	SiiView view;
+	SiiInfo *current = sii_init_string(dump.buffer, dump.length);
+	if (current == NULL || current->config == NULL ||
+			sii_view_init(&view, dump.buffer, dump.length) != 0 ||
+			(sii_view_validate(&view) & (SII_VIEW_BAD_CHAIN | SII_VIEW_NO_END)) != 0) {
+		fprintf(stderr, "Error, '%s' is no SII EEPROM dump\n", opt->flash_dump);
+		if (current != NULL)
+			sii_release(current);
+		release_input(&dump);
+		return -1;
 	}
+	sii_release(current);
 
-	if (eeprom == NULL) {
+	size_t max = SII_FLASH_MAX_RANGES(sii->rawsize);
+	struct _sii_flash_range *range = malloc(max * sizeof(struct _sii_flash_range));
+	FILE *f = open_memstream(&text, &length);
+	if (range == NULL || f == NULL) {
+		fprintf(stderr, "Error, out of memory\n");
 		goto finish;
 	}
 
-	/* recognize input */
-	enum eInputFileType filetype = file_type(filename, eeprom);
-	unsigned char *xml_start = eeprom;
-	switch (filetype) {
-	case ESIXML:
-#if DEBUG == 1
-		printf("Processing ESI/XML file\n");
-#endif
-		/* Start XML processing at the first '<' character to avoid strange behavior when parsing. */
-		while (*xml_start != '<')
-			xml_start++;
+	size_t count = sii_flash_plan(dump.buffer, dump.length, sii->rawbytes, sii->rawsize, range, max);
+	print_flash_plan(f, sii->rawbytes, sii->rawsize, range, count);
+	fclose(f);
+	f = NULL;
 
-		ret = parse_xml_input(xml_start, eeprom_length, device, output);
-		break;
+	if (sii_write_file(output, (const uint8_t *)text, length, opt->write_flags) != 0) {
+		fprintf(stderr, "Error, couldn't write output file\n");
+		goto finish;
+	}
 
-	case SIIEEPROM:
-#if DEBUG == 1
-		printf("Processing SII/EEPROM file\n");
-#endif
-		ret = parse_sii_input(eeprom, output);
-		break;
+	if (output != NULL)
+		fprintf(out, "= %s generated\n", output);
 
-	case UNDEFINED:
-	default:
-		ret = -1;
+	ret = 0;
+
+finish:
+	if (f != NULL)
+		fclose(f);
+	free(text);
+	free(range);
+	release_input(&dump);
+
+	return ret;
+}
+
+/* the category directory of --sidecar, a C header for *.h */
+static int write_sidecar(const struct _options *opt, SiiInfo *sii, const char *output, FILE *out)
+{
+	const char *suffix = strrchr(opt->sidecar, '.');
+	enum eSiiDirectoryFormat format = (suffix != NULL && strcmp(suffix, ".h") == 0) ?
+		SII_DIRECTORY_HEADER : SII_DIRECTORY_BIN;
+
+	if (sii_write_directory(sii, opt->sidecar, format, opt->write_flags) != 0) {
+		fprintf(stderr, "Error, couldn't write sidecar file\n");
+		return -1;
+	}
+
+	/* without output the binary goes to stdout */
+	if (output != NULL)
+		fprintf(out, "= %s generated\n", opt->sidecar);
+
+	return 0;
+}
+
+/* The image of an input: SII input as it is, ESI input as it would be
+ * generated with the options of this run. */
+static SiiInfo *load_image(const struct _options *opt, const unsigned char *buffer, size_t length,
+		enum eInputFileType type)
+{
+	if (type == SIIEEPROM)
+		return sii_init_string(buffer, length);
+
+	if (type != ESIXML)
+		return NULL;
+
+	const unsigned char *xml_start = buffer;
+	while (xml_start < buffer + length && *xml_start != '<')
+		xml_start++;
+
+	EsiData *esi = esi_init_string(xml_start, (size_t)(buffer + length - xml_start));
+	if (esi == NULL)
+		return NULL;
+
+	SiiInfo *image = NULL;
+	if (esi_parse_select(esi, &opt->device, opt->add_pdo_mapping) == 0) {
+		SiiInfo *sii = esi_get_sii(esi);
+		sii_cat_sort_order(sii, opt->order);
+
+		if (generate_sii(opt, sii) != 0)
+			image = sii_init_string(sii->rawbytes, sii->rawsize);
+	}
+
+	esi_release(esi);
+
+	return image;
+}
+
+/* print the semantic differences of image to the image of --diff, nothing
+ * if they are equal */
+static int diff_image(const struct _options *opt, SiiInfo *image, const char *output, FILE *out)
+{
+	struct _input other = { NULL, 0, 0 };
+	SiiInfo *actual = NULL;
+	char *text = NULL;
+	size_t length = 0;
+	FILE *f = NULL;
+	int ret = -1;
+
+	if (read_file(opt->diff_file, &other) != 0)
+		return -1;
+
+	actual = load_image(opt, other.buffer, other.length, file_type(opt->diff_file, other.buffer));
+	if (actual == NULL) {
+		fprintf(stderr, "Error, couldn't read '%s'\n", opt->diff_file);
 		goto finish;
 	}
 
+	f = open_memstream(&text, &length);
+	if (f == NULL) {
+		fprintf(stderr, "Error, out of memory\n");
+		goto finish;
+	}
+
+	sii_diff(f, image, actual);
+	fclose(f);
+	f = NULL;
+
+	if (sii_write_file(output, (const uint8_t *)text, length, opt->write_flags) != 0) {
+		fprintf(stderr, "Error, couldn't write output file\n");
+		goto finish;
+	}
+
+	if (output != NULL)
+		fprintf(out, "= %s generated\n", output);
+
+	ret = 0;
+
 finish:
-	if (eeprom)
-		free(eeprom);
+	if (f != NULL)
+		fclose(f);
+	free(text);
+	if (actual != NULL)
+		sii_release(actual);
+	release_input(&other);
+
+	return ret;
+}
+
+/* write the generated sii to output, stamp copies with -S, write the
+ * flash plan of -F or the differences of --diff */
+static int write_sii(const struct _options *opt, SiiInfo *sii, const char *output, FILE *out)
+{
+	if (opt->sidecar != NULL && write_sidecar(opt, sii, output, out) != 0)
+		return -1;
 
-	if (output)
-		free(output);
+	if (opt->serials.count > 0)
+		return stamp_units(opt, sii, output, out);
+
+	if (opt->flash_dump != NULL)
+		return flash_plan(opt, sii, output, out);
+
+	if (opt->diff_file != NULL) {
+		SiiInfo *image = sii_init_string(sii->rawbytes, sii->rawsize);
+		if (image == NULL)
+			return -1;
+
+		int ret = diff_image(opt, image, output, out);
+		sii_release(image);
+
+		return ret;
+	}
+
+	if (opt->size_report) {
+		sii_size_report(out, sii, &opt->read_model);
+		return 0;
+	}
+
+	int ret = sii_write_bin_flags(sii, output, opt->write_flags);
+	if (ret < 0) {
+		fprintf(stderr, "Error, couldn't write output file\n");
+		return -1;
+	}
+
+	/* without output the binary went to stdout */
+	if (output != NULL)
+		fprintf(out, "= %s generated\n", output);
+
+	return 0;
+}
+
+static int parse_xml_input(const struct _options *opt, const unsigned char *buffer,
+		size_t length, const char *output, FILE *out)
+{
+	EsiData *esi;
+	const struct _esi_device_selector *device = &opt->device;
+	struct _esi_device_selector first = { .keys = ESI_SELECT_NUMBER, .number = 0 };
+
+	if (opt->stream_input && !opt->list_devices && !opt->all_devices) {
+		esi = esi_init_stream(buffer, length, device);
+		device = &first; /* the streamed document only holds the selected device */
+	} else {
+		esi = esi_init_string(buffer, length);
+	}
+
+	if (esi == NULL)
+		return -1;
+
+	//esi_print_xml(esi);
+
+	if (opt->list_devices) {
+		esi_print_devices(out, esi);
+		esi_release(esi);
+		return 0;
+	}
+
+	if (opt->all_devices) {
+		int ret = parse_all_devices(opt, esi, output, out);
+		esi_release(esi);
+		return ret;
+	}
+
+	int include_pdo_strings = opt->add_pdo_mapping || opt->print_content;
+	if (esi_parse_select(esi, device, include_pdo_strings)) {
+		fprintf(stderr, "Error something went wrong in XML parsing\n");
+		esi_release(esi);
+		return -1;
+	}
+
+	SiiInfo *sii = esi_get_sii(esi);
+	sii_cat_sort_order(sii, opt->order);
+	if (opt->print_content) {
+		sii_fprint(out, sii);
+	} else {
+		if (generate_sii(opt, sii) == 0) {
+			fprintf(stderr, "Error, couldn't generate SII\n");
+			esi_release(esi);
+			return -1;
+		}
+
+		if (write_sii(opt, sii, output, out) != 0) {
+			esi_release(esi);
+			return -1;
+		}
+	}
+
+	esi_release(esi);
+
+	return 0;
+}
+
+static int parse_sii_input(const struct _options *opt, const unsigned char *buffer,
+		size_t length, const char *output, FILE *out)
+{
+	if (opt->list_devices) {
+		fprintf(stderr, "Error, only ESI files have a device list\n");
+		return -1;
+	}
+
+	SiiInfo *sii = sii_init_string(buffer, length);
+	if (sii == NULL)
+		return -1;
+
+	/* the input as it is, not the SII it would be generated to */
+	if (opt->size_report) {
+		sii_size_report(out, sii, &opt->read_model);
+		sii_release(sii);
+		return 0;
+	}
+
+	/* SII input isn't regenerated either, -m and -c would drop its PDOs
+	 * and DC */
+	if (opt->diff_file != NULL) {
+		int ret = diff_image(opt, sii, output, out);
+		sii_release(sii);
+		return ret;
+	}
+
+	/* without -O the order of the input is kept */
+	if (opt->order_set)
+		sii_cat_sort_order(sii, opt->order);
+
+	if (opt->print_content)
+		sii_fprint(out, sii);
+	else {
+		if (generate_sii(opt, sii) == 0) {
+			fprintf(stderr, "Error, couldn't generate SII\n");
+			sii_release(sii);
+			return -1;
+		}
+
+		if (write_sii(opt, sii, output, out) != 0) {
+			sii_release(sii);
+			return -1;
+		}
+	}
+
+	sii_release(sii);
+
+	return 0;
+}
+
+/* recognize the type of the input and hand it to the matching parser,
+ * filename may be NULL for stdin */
+static int process_input(const struct _options *opt, const char *filename,
+		const struct _input *input, const char *output, FILE *out)
+{
+	if (input->length == 0) {
+		fprintf(stderr, "Error, empty input\n");
+		return -1;
+	}
+
+	enum eInputFileType filetype = file_type(filename, input->buffer);
+	unsigned char *xml_start = input->buffer;
+	unsigned char *input_end = input->buffer + input->length;
+
+	switch (filetype) {
+	case ESIXML:
+#if DEBUG == 1
+		printf("Processing ESI/XML file\n");
+#endif
+		/* Start XML processing at the first '<' character to avoid strange behavior when parsing. */
+		while (xml_start < input_end && *xml_start != '<')
+			xml_start++;
+
+		return parse_xml_input(opt, xml_start, (size_t)(input_end - xml_start), output, out);
+
+	case SIIEEPROM:
+#if DEBUG == 1
+		printf("Processing SII/EEPROM file\n");
+#endif
+		return parse_sii_input(opt, input->buffer, input->length, output, out);
+
+	case UNDEFINED:
+	default:
+		break;
+	}
+
+	return -1;
+}
+
+/* input files of the batch mode */
+struct _file_list {
+	char **name;
+	size_t count;
+	size_t size;
+};
+
+static int file_list_add(struct _file_list *list, const char *name)
+{
+	if (list->count == list->size) {
+		size_t size = (list->size == 0) ? 64 : list->size * 2;
+		char **tmp = realloc(list->name, size * sizeof(char *));
+		if (tmp == NULL) {
+			fprintf(stderr, "Realloc failed! Out of memory?\n");
+			return -1;
+		}
+
+		list->name = tmp;
+		list->size = size;
+	}
+
+	list->name[list->count] = strdup(name);
+	if (list->name[list->count] == NULL) {
+		fprintf(stderr, "Malloc failed! Out of memory?\n");
+		return -1;
+	}
+
+	list->count++;
+
+	return 0;
+}
+
+static void file_list_release(struct _file_list *list)
+{
+	for (size_t i = 0; i < list->count; i++)
+		free(list->name[i]);
+
+	free(list->name);
+}
+
+static int compare_names(const void *a, const void *b)
+{
+	return strcmp(*(char * const *)a, *(char * const *)b);
+}
+
+static int batch_suffix(const char *filename)
+{
+	const char *suffix = strrchr(base(filename), '.');
+
+	if (suffix == NULL)
+		return 0;
+
+	return strcmp(suffix, ".xml") == 0 || strcmp(suffix, ".bin") == 0 ||
+		strcmp(suffix, ".sii") == 0;
+}
+
+/* EEPROM dumps of the scan mode */
+static int scan_suffix(const char *filename)
+{
+	const char *suffix = strrchr(base(filename), '.');
+
+	if (suffix == NULL)
+		return 0;
+
+	return strcmp(suffix, ".bin") == 0 || strcmp(suffix, ".sii") == 0;
+}
+
+/* Add path to the list, directories are searched recursively in
+ * alphabetical order for files accepted by known_suffix(). Symbolic links
+ * to directories are not followed to avoid loops. */
+static int collect_inputs(struct _file_list *list, const char *path, int explicit,
+		int (*known_suffix)(const char *))
+{
+	struct stat st;
+
+	if ((explicit ? stat(path, &st) : lstat(path, &st)) != 0) {
+		fprintf(stderr, "Error, can't access '%s': %s\n", path, strerror(errno));
+		return -1;
+	}
+
+	if (S_ISLNK(st.st_mode)) {
+		if (stat(path, &st) != 0 || !S_ISREG(st.st_mode))
+			return 0;
+	}
+
+	if (!S_ISDIR(st.st_mode)) {
+		if (explicit || (S_ISREG(st.st_mode) && known_suffix(path)))
+			return file_list_add(list, path);
+
+		return 0;
+	}
+
+	DIR *dir = opendir(path);
+	if (dir == NULL) {
+		fprintf(stderr, "Error, can't open directory '%s': %s\n", path, strerror(errno));
+		return -1;
+	}
+
+	struct _file_list entries = { NULL, 0, 0 };
+	struct dirent *de;
+	int ret = 0;
+
+	while (ret == 0 && (de = readdir(dir)) != NULL) {
+		if (de->d_name[0] == '.') /* skip ., .. and hidden files */
+			continue;
+
+		char child[MAX_FILENAME_SIZE];
+		if (snprintf(child, sizeof(child), "%s/%s", path, de->d_name) >= (int)sizeof(child)) {
+			fprintf(stderr, "Error, path too long '%s/%s'\n", path, de->d_name);
+			ret = -1;
+			break;
+		}
+
+		ret = file_list_add(&entries, child);
+	}
+
+	closedir(dir);
+
+	qsort(entries.name, entries.count, sizeof(char *), compare_names);
+
+	for (size_t i = 0; ret == 0 && i < entries.count; i++)
+		ret = collect_inputs(list, entries.name[i], 0, known_suffix);
+
+	file_list_release(&entries);
+
+	return ret;
+}
+
+struct _batch_job {
+	const char *input;
+	char output[MAX_FILENAME_SIZE];
+	char *text;   /* everything the job printed, reported in input order */
+	size_t size;
+	int ret;
+};
+
+struct _batch {
+	const struct _options *opt;
+	int generate;
+	struct _batch_job *job;
+	Arena **arena; /* one per worker, reused for every job */
+};
+
+static void batch_worker(void *arg, size_t n, unsigned int worker)
+{
+	struct _batch *batch = (struct _batch *)arg;
+	struct _batch_job *job = &batch->job[n];
+	struct _input input = { NULL, 0, 0 };
+
+	FILE *out = open_memstream(&job->text, &job->size);
+	if (out == NULL) {
+		fprintf(stderr, "Error, couldn't buffer output of '%s'\n", job->input);
+		job->ret = -1;
+		return;
+	}
+
+	/* all SII data of the previous job is released, so after the first
+	 * jobs the SII data is built without malloc() */
+	if (batch->arena[worker] == NULL)
+		batch->arena[worker] = arena_new();
+	else
+		arena_reset(batch->arena[worker]);
+	sii_use_arena(batch->arena[worker]);
+
+	job->ret = read_file(job->input, &input);
+	if (job->ret == 0)
+		job->ret = process_input(batch->opt, job->input, &input,
+				batch->generate ? job->output : NULL, out);
+
+	sii_use_arena(NULL);
+	fclose(out);
+	release_input(&input);
+}
+
+/* <outdir>/<name>.sii for the input <dir>/<name>.<suffix>, without outdir
+ * the SII is placed next to the input */
+static int batch_output_name(char *name, size_t size, const char *outdir, const char *input)
+{
+	const char *file = base(input);
+	const char *suffix = strrchr(file, '.');
+	int len = (suffix != NULL && suffix != file) ? (int)(suffix - file) : (int)strlen(file);
+	int n;
+
+	if (outdir != NULL)
+		n = snprintf(name, size, "%s/%.*s.sii", outdir, len, file);
+	else
+		n = snprintf(name, size, "%.*s%.*s.sii", (int)(file - input), input, len, file);
+
+	if (n < 0 || (size_t)n >= size) {
+		fprintf(stderr, "Error, output name for '%s' too long\n", input);
+		return -1;
+	}
+
+	return 0;
+}
+
+static int compare_outputs(const void *a, const void *b)
+{
+	const struct _batch_job *ja = *(const struct _batch_job * const *)a;
+	const struct _batch_job *jb = *(const struct _batch_job * const *)b;
+
+	return strcmp(ja->output, jb->output);
+}
+
+/* every job needs its own output file which must not be one of the inputs */
+static int batch_check_outputs(struct _batch_job *job, size_t count)
+{
+	struct _batch_job **sorted = calloc(count, sizeof(struct _batch_job *));
+	int ret = 0;
+
+	if (sorted == NULL) {
+		fprintf(stderr, "Malloc failed! Out of memory?\n");
+		return -1;
+	}
+
+	for (size_t i = 0; i < count; i++) {
+		struct stat in, out;
+
+		sorted[i] = &job[i];
+
+		if (stat(job[i].output, &out) == 0 && stat(job[i].input, &in) == 0 &&
+				in.st_dev == out.st_dev && in.st_ino == out.st_ino) {
+			fprintf(stderr, "Error, output '%s' would overwrite its input\n", job[i].output);
+			ret = -1;
+		}
+	}
+
+	qsort(sorted, count, sizeof(struct _batch_job *), compare_outputs);
+
+	for (size_t i = 1; i < count; i++) {
+		if (strcmp(sorted[i-1]->output, sorted[i]->output) != 0)
+			continue;
+
+		if (strcmp(sorted[i-1]->input, sorted[i]->input) == 0) {
+			fprintf(stderr, "Error, '%s' is given more than once\n", sorted[i]->input);
+			ret = -1;
+		} else {
+			fprintf(stderr, "Error, '%s' and '%s' both write '%s'\n",
+					sorted[i-1]->input, sorted[i]->input, sorted[i]->output);
+			ret = -1;
+		}
+	}
+
+	free(sorted);
+
+	return ret;
+}
+
+static int run_batch(const struct _options *opt, char **paths, int npaths, const char *outdir)
+{
+	struct _file_list list = { NULL, 0, 0 };
+	struct _batch batch;
+	unsigned int workers = opt->workers ? opt->workers : pool_default_workers();
+	size_t failed = 0;
+	int ret = -1;
+
+	batch.opt = opt;
+	batch.generate = !opt->print_content && !opt->list_devices && !opt->size_report;
+	batch.job = NULL;
+	batch.arena = NULL;
+
+	if (opt->all_devices) {
+		fprintf(stderr, "Error, -a is not supported in batch mode\n");
+		return -1;
+	}
+
+	if (outdir != NULL) {
+		struct stat st;
+		if (stat(outdir, &st) != 0 || !S_ISDIR(st.st_mode)) {
+			fprintf(stderr, "Error, output directory '%s' doesn't exist\n", outdir);
+			return -1;
+		}
+	}
+
+	for (int i = 0; i < npaths; i++) {
+		if (collect_inputs(&list, paths[i], 1, batch_suffix) != 0)
+			goto finish;
+	}
+
+	if (list.count == 0) {
+		fprintf(stderr, "Error, no input files found\n");
+		goto finish;
+	}
+
+	batch.job = calloc(list.count, sizeof(struct _batch_job));
+	batch.arena = calloc(workers, sizeof(Arena *));
+	if (batch.job == NULL || batch.arena == NULL) {
+		fprintf(stderr, "Malloc failed! Out of memory?\n");
+		goto finish;
+	}
+
+	for (size_t i = 0; i < list.count; i++) {
+		batch.job[i].input = list.name[i];
+		if (batch.generate &&
+				batch_output_name(batch.job[i].output, MAX_FILENAME_SIZE, outdir, list.name[i]) != 0)
+			goto finish;
+	}
+
+	if (batch.generate && batch_check_outputs(batch.job, list.count) != 0)
+		goto finish;
+
+	if (pool_run(workers, list.count, batch_worker, &batch) != 0) {
+		fprintf(stderr, "Error, couldn't run worker pool\n");
+		goto finish;
+	}
+
+	for (size_t i = 0; i < list.count; i++) {
+		struct _batch_job *job = &batch.job[i];
+
+		if (!batch.generate && job->size > 0)
+			printf("=== %s\n", job->input);
+
+		fwrite(job->text, 1, job->size, stdout);
+
+		if (job->ret != 0) {
+			fprintf(stderr, "Error, couldn't process '%s'\n", job->input);
+			failed++;
+		}
+	}
+
+	if (failed > 0)
+		fprintf(stderr, "%zu of %zu files failed\n", failed, list.count);
+	else
+		ret = 0;
+
+finish:
+	if (batch.job != NULL) {
+		for (size_t i = 0; i < list.count; i++)
+			free(batch.job[i].text);
+		free(batch.job);
+	}
+
+	if (batch.arena != NULL) {
+		for (unsigned int i = 0; i < workers; i++)
+			arena_free(batch.arena[i]);
+		free(batch.arena);
+	}
+
+	file_list_release(&list);
+
+	return ret;
+}
+
+/* one EEPROM dump of the scan mode */
+struct _scan_unit {
+	const char *input;
+	uint32_t vendor;
+	uint32_t product;
+	uint32_t revision;
+	unsigned int status; /* SII_VIEW_BAD_* */
+	int ret;
+};
+
+static void scan_worker(void *arg, size_t n, unsigned int worker)
+{
+	struct _scan_unit *unit = &((struct _scan_unit *)arg)[n];
+	struct _input input = { NULL, 0, 0 };
+	SiiView view;
+
+	(void)worker;
+
+	unit->ret = read_file(unit->input, &input);
+	if (unit->ret != 0)
+		return;
+
+	if (sii_view_init(&view, input.buffer, input.length) != 0) {
+		fprintf(stderr, "Error, '%s' is too short for a SII\n", unit->input);
+		unit->ret = -1;
+	} else {
+		unit->vendor = sii_view_vendor_id(&view);
+		unit->product = sii_view_product_id(&view);
+		unit->revision = sii_view_revision_id(&view);
+		unit->status = sii_view_validate(&view);
+	}
+
+	release_input(&input);
+}
+
+/* by vendor, product and revision, within a group in input order */
+static int compare_units(const void *a, const void *b)
+{
+	const struct _scan_unit *ua = *(const struct _scan_unit * const *)a;
+	const struct _scan_unit *ub = *(const struct _scan_unit * const *)b;
+
+	if (ua->vendor != ub->vendor)
+		return ua->vendor < ub->vendor ? -1 : 1;
+	if (ua->product != ub->product)
+		return ua->product < ub->product ? -1 : 1;
+	if (ua->revision != ub->revision)
+		return ua->revision < ub->revision ? -1 : 1;
+
+	return (ua < ub) ? -1 : (ua > ub);
+}
+
+static void print_json_string(FILE *f, const char *s)
+{
+	fputc('"', f);
+
+	for (; *s != '\0'; s++) {
+		unsigned char c = (unsigned char)*s;
+
+		if (c == '"' || c == '\\')
+			fprintf(f, "\\%c", c);
+		else if (c < 0x20)
+			fprintf(f, "\\u%04x", c);
+		else
+			fputc(c, f);
+	}
+
+	fputc('"', f);
+}
+
+struct _scan_group {
+	size_t units;
+	size_t bad_checksum;
+	size_t bad_chain;
+	size_t no_end;
+};
+
+static void scan_group_count(struct _scan_group *group, struct _scan_unit **unit, size_t count)
+{
+	memset(group, 0, sizeof(*group));
+	group->units = count;
+
+	for (size_t i = 0; i < count; i++) {
+		group->bad_checksum += (unit[i]->status & SII_VIEW_BAD_CHECKSUM) ? 1 : 0;
+		group->bad_chain += (unit[i]->status & SII_VIEW_BAD_CHAIN) ? 1 : 0;
+		group->no_end += (unit[i]->status & SII_VIEW_NO_END) ? 1 : 0;
+	}
+}
+
+/* groups of equal vendor, product and revision in sorted */
+static void print_scan(FILE *f, enum eScanFormat format, struct _scan_unit **sorted, size_t count)
+{
+	size_t groups = 0;
+
+	if (format == SCAN_CSV)
+		fprintf(f, "vendor_id,product_code,revision,units,bad_checksum,bad_chain,no_end_marker\n");
+	else
+		fprintf(f, "{\n  \"units\": %zu,\n  \"groups\": [", count);
+
+	for (size_t first = 0, last; first < count; first = last) {
+		struct _scan_unit *u = sorted[first];
+		struct _scan_group group;
+
+		for (last = first + 1; last < count && sorted[last]->vendor == u->vendor &&
+				sorted[last]->product == u->product && sorted[last]->revision == u->revision; last++)
+			;
+
+		scan_group_count(&group, &sorted[first], last - first);
+
+		if (format == SCAN_CSV) {
+			fprintf(f, "0x%08x,0x%08x,0x%08x,%zu,%zu,%zu,%zu\n",
+					u->vendor, u->product, u->revision, group.units,
+					group.bad_checksum, group.bad_chain, group.no_end);
+			continue;
+		}
+
+		fprintf(f, "%s\n    { \"vendor_id\": \"0x%08x\", \"product_code\": \"0x%08x\", \"revision\": \"0x%08x\",\n",
+				groups++ > 0 ? "," : "", u->vendor, u->product, u->revision);
+		fprintf(f, "      \"units\": %zu, \"bad_checksum\": %zu, \"bad_chain\": %zu, \"no_end_marker\": %zu,\n",
+				group.units, group.bad_checksum, group.bad_chain, group.no_end);
+		fprintf(f, "      \"invalid\": [");
+
+		size_t invalid = 0;
+		for (size_t i = first; i < last; i++) {
+			if (sorted[i]->status == 0)
+				continue;
+
+			fprintf(f, "%s", invalid++ > 0 ? ", " : "");
+			print_json_string(f, sorted[i]->input);
+		}
+
+		fprintf(f, "] }");
+	}
+
+	if (format == SCAN_JSON)
+		fprintf(f, "%s]\n}\n", groups > 0 ? "\n  " : "");
+}
+
+/* validate the EEPROM dumps below paths and print a summary per vendor,
+ * product and revision, only the headers are read through a SiiView */
+static int run_scan(const struct _options *opt, char **paths, int npaths)
+{
+	struct _file_list list = { NULL, 0, 0 };
+	struct _scan_unit *unit = NULL;
+	struct _scan_unit **sorted = NULL;
+	size_t failed = 0;
+	size_t count = 0;
+	int ret = -1;
+
+	for (int i = 0; i < npaths; i++) {
+		if (collect_inputs(&list, paths[i], 1, scan_suffix) != 0)
+			goto finish;
+	}
+
+	if (list.count == 0) {
+		fprintf(stderr, "Error, no input files found\n");
+		goto finish;
+	}
+
+	unit = calloc(list.count, sizeof(struct _scan_unit));
+	sorted = calloc(list.count, sizeof(struct _scan_unit *));
+	if (unit == NULL || sorted == NULL) {
+		fprintf(stderr, "Malloc failed! Out of memory?\n");
+		goto finish;
+	}
+
+	for (size_t i = 0; i < list.count; i++)
+		unit[i].input = list.name[i];
+
+	if (pool_run(opt->workers, list.count, scan_worker, unit) != 0) {
+		fprintf(stderr, "Error, couldn't run worker pool\n");
+		goto finish;
+	}
+
+	for (size_t i = 0; i < list.count; i++) {
+		if (unit[i].ret != 0)
+			failed++;
+		else
+			sorted[count++] = &unit[i];
+	}
+
+	qsort(sorted, count, sizeof(struct _scan_unit *), compare_units);
+	print_scan(stdout, opt->scan, sorted, count);
+
+	if (failed > 0)
+		fprintf(stderr, "%zu of %zu files failed\n", failed, list.count);
+	else
+		ret = 0;
+
+finish:
+	free(sorted);
+	free(unit);
+	file_list_release(&list);
+
+	return ret;
+}
+
+/* comma separated names of field_name[] */
+static int parse_fields(const char *arg, struct _fields *fields)
+{
+	const char *p = arg;
+
+	fields->count = 0;
+
+	while (*p != '\0') {
+		size_t len = strcspn(p, ",");
+		int f;
+
+		for (f = 0; f < FIELD_COUNT; f++) {
+			if (strlen(field_name[f]) == len && strncmp(p, field_name[f], len) == 0)
+				break;
+		}
+
+		if (f == FIELD_COUNT || fields->count == MAX_FIELDS)
+			return -1;
+
+		fields->field[fields->count++] = (enum eField)f;
+
+		p += len;
+		if (*p == ',')
+			p++;
+	}
+
+	return (fields->count > 0) ? 0 : -1;
+}
+
+struct _get_job {
+	const char *input;
+	uint32_t value[FIELD_COUNT];
+	uint64_t hash;
+	int ret;
+};
+
+struct _get {
+	const struct _options *opt;
+	unsigned int ident_flags; /* ESI_IDENT_* the fields need */
+	int hash;                 /* the content hash needs the whole image */
+	struct _get_job *job;
+};
+
+static int get_esi_values(const struct _get *get, const unsigned char *buffer, size_t length,
+		uint32_t *value)
+{
+	const unsigned char *xml_start = buffer;
+	const unsigned char *input_end = buffer + length;
+	struct _esi_ident ident;
+
+	while (xml_start < input_end && *xml_start != '<')
+		xml_start++;
+
+	if (esi_stream_ident(xml_start, (size_t)(input_end - xml_start), &get->opt->device,
+				get->ident_flags, &ident) != 0)
+		return -1;
+
+	value[FIELD_VENDOR_ID] = ident.vendor_id;
+	value[FIELD_PRODUCT_ID] = ident.product_id;
+	value[FIELD_REVISION_ID] = ident.revision_id;
+	value[FIELD_SERIAL] = 0; /* not part of the ESI */
+	value[FIELD_ALIAS] = ident.alias;
+
+	return 0;
+}
+
+/* only preamble and std config are read */
+static int get_sii_values(const unsigned char *buffer, size_t length, uint32_t *value)
+{
+	SiiView view;
+
+	if (sii_view_init(&view, buffer, length) != 0) {
+		fprintf(stderr, "Error, input is too short for a SII\n");
+		return -1;
+	}
+
+	value[FIELD_VENDOR_ID] = sii_view_vendor_id(&view);
+	value[FIELD_PRODUCT_ID] = sii_view_product_id(&view);
+	value[FIELD_REVISION_ID] = sii_view_revision_id(&view);
+	value[FIELD_SERIAL] = sii_view_serial(&view);
+	value[FIELD_ALIAS] = sii_view_alias(&view);
+
+	return 0;
+}
+
+static void get_worker(void *arg, size_t n, unsigned int worker)
+{
+	struct _get *get = (struct _get *)arg;
+	struct _get_job *job = &get->job[n];
+	struct _input input = { NULL, 0, 0 };
+
+	(void)worker;
+
+	job->ret = read_file(job->input, &input);
+	if (job->ret != 0)
+		return;
+
+	enum eInputFileType type = file_type(job->input, input.buffer);
+
+	if (get->hash) {
+		SiiInfo *image = load_image(get->opt, input.buffer, input.length, type);
+		if (image == NULL) {
+			job->ret = -1;
+			release_input(&input);
+			return;
+		}
+
+		job->hash = sii_hash(image);
+		sii_release(image);
+	}
+
+	switch (type) {
+	case ESIXML:
+		job->ret = get_esi_values(get, input.buffer, input.length, job->value);
+		break;
+	case SIIEEPROM:
+		job->ret = get_sii_values(input.buffer, input.length, job->value);
+		break;
+	default:
+		job->ret = -1;
+		break;
+	}
+
+	release_input(&input);
+}
+
+static void print_values(FILE *f, const struct _fields *fields, const struct _get_job *job)
+{
+	fprintf(f, "%s", job->input);
+
+	for (int i = 0; i < fields->count; i++) {
+		uint32_t value = job->value[fields->field[i]];
+
+		switch (fields->field[i]) {
+		case FIELD_HASH:
+			fprintf(f, ",%016llx", (unsigned long long)job->hash);
+			break;
+		case FIELD_SERIAL:
+		case FIELD_ALIAS:
+			fprintf(f, ",%u", value);
+			break;
+		default:
+			fprintf(f, ",0x%08x", value);
+			break;
+		}
+	}
+
+	fprintf(f, "\n");
+}
+
+/* print the fields of --get for every input, in input order */
+static int run_get(const struct _options *opt, char **paths, int npaths)
+{
+	struct _file_list list = { NULL, 0, 0 };
+	struct _get get;
+	size_t failed = 0;
+	int ret = -1;
+
+	get.opt = opt;
+	get.ident_flags = 0;
+	get.hash = 0;
+	get.job = NULL;
+
+	for (int i = 0; i < opt->get.count; i++) {
+		if (opt->get.field[i] == FIELD_ALIAS)
+			get.ident_flags |= ESI_IDENT_ALIAS;
+		if (opt->get.field[i] == FIELD_HASH)
+			get.hash = 1;
+	}
+
+	for (int i = 0; i < npaths; i++) {
+		if (collect_inputs(&list, paths[i], 1, batch_suffix) != 0)
+			goto finish;
+	}
+
+	get.job = calloc(list.count, sizeof(struct _get_job));
+	if (list.count > 0 && get.job == NULL) {
+		fprintf(stderr, "Malloc failed! Out of memory?\n");
+		goto finish;
+	}
+
+	for (size_t i = 0; i < list.count; i++)
+		get.job[i].input = list.name[i];
+
+	if (pool_run(opt->workers, list.count, get_worker, &get) != 0) {
+		fprintf(stderr, "Error, couldn't run worker pool\n");
+		goto finish;
+	}
+
+	for (size_t i = 0; i < list.count; i++) {
+		if (get.job[i].ret != 0) {
+			fprintf(stderr, "Error, couldn't read '%s'\n", get.job[i].input);
+			failed++;
+			continue;
+		}
+
+		print_values(stdout, &opt->get, &get.job[i]);
+	}
+
+	if (failed > 0)
+		fprintf(stderr, "%zu of %zu files failed\n", failed, list.count);
+	else
+		ret = 0;
+
+finish:
+	free(get.job);
+	file_list_release(&list);
+
+	return ret;
+}
+
+/* ESI files of --build-index */
+static int esi_suffix(const char *filename)
+{
+	const char *suffix = strrchr(base(filename), '.');
+
+	return suffix != NULL && strcmp(suffix, ".xml") == 0;
+}
+
+/* signatures of all devices of one ESI file */
+struct _index_job {
+	const char *input;
+	struct _sii_signature *sig;
+	int *valid;
+	int count;
+	int ret;
+};
+
+/* signature of the image a device generates with PDO mapping and DC */
+static int device_signature(SiiInfo *sii, struct _sii_signature *sig)
+{
+	unsigned int add_pdo_mapping = 1;
+
+	sii_optimize(sii, &add_pdo_mapping, 1);
+	if (sii_generate(sii, add_pdo_mapping, 1) == 0)
+		return -1;
+
+	SiiInfo *image = sii_init_string(sii->rawbytes, sii->rawsize);
+	if (image == NULL)
+		return -1;
+
+	sii_signature(image, sig);
+	sii_release(image);
+
+	return 0;
+}
+
+static void index_worker(void *arg, size_t n, unsigned int worker)
+{
+	struct _index_job *job = &((struct _index_job *)arg)[n];
+	struct _input input = { NULL, 0, 0 };
+
+	(void)worker;
+
+	job->ret = read_file(job->input, &input);
+	if (job->ret != 0)
+		return;
+
+	job->ret = -1;
+
+	const unsigned char *xml_start = input.buffer;
+	while (xml_start < input.buffer + input.length && *xml_start != '<')
+		xml_start++;
+
+	EsiData *esi = esi_init_string(xml_start, (size_t)(input.buffer + input.length - xml_start));
+	if (esi == NULL)
+		goto finish;
+
+	job->count = esi_device_count(esi);
+	if (job->count < 0) {
+		job->count = 0;
+		goto finish;
+	}
+
+	job->sig = calloc(job->count > 0 ? job->count : 1, sizeof(struct _sii_signature));
+	job->valid = calloc(job->count > 0 ? job->count : 1, sizeof(int));
+	if (job->sig == NULL || job->valid == NULL)
+		goto finish;
+
+	job->ret = 0;
+	for (int i = 0; i < job->count; i++) {
+		SiiInfo *sii = esi_parse_device(esi, i, 1);
+
+		if (sii != NULL && device_signature(sii, &job->sig[i]) == 0)
+			job->valid[i] = 1;
+		else
+			job->ret = -1;
+
+		if (sii != NULL)
+			sii_release(sii);
+	}
+
+finish:
+	if (esi != NULL)
+		esi_release(esi);
+	release_input(&input);
+}
+
+/* signatures of every device of the ESI files below paths */
+static int build_index(const struct _options *opt, char **paths, int npaths)
+{
+	struct _file_list list = { NULL, 0, 0 };
+	struct _index_job *job = NULL;
+	SiiIndex *index = NULL;
+	size_t failed = 0;
+	int ret = -1;
+
+	for (int i = 0; i < npaths; i++) {
+		if (collect_inputs(&list, paths[i], 1, esi_suffix) != 0)
+			goto finish;
+	}
+
+	job = calloc(list.count > 0 ? list.count : 1, sizeof(struct _index_job));
+	index = sii_index_new();
+	if (job == NULL || index == NULL) {
+		fprintf(stderr, "Malloc failed! Out of memory?\n");
+		goto finish;
+	}
+
+	for (size_t i = 0; i < list.count; i++)
+		job[i].input = list.name[i];
+
+	if (pool_run(opt->workers, list.count, index_worker, job) != 0) {
+		fprintf(stderr, "Error, couldn't run worker pool\n");
+		goto finish;
+	}
+
+	for (size_t i = 0; i < list.count; i++) {
+		if (job[i].ret != 0) {
+			fprintf(stderr, "Error, couldn't index all devices of '%s'\n", job[i].input);
+			failed++;
+		}
+
+		for (int d = 0; d < job[i].count; d++) {
+			if (job[i].valid[d] && sii_index_add(index, &job[i].sig[d], job[i].input, d) != 0) {
+				fprintf(stderr, "Malloc failed! Out of memory?\n");
+				goto finish;
+			}
+		}
+	}
+
+	if (sii_index_write(index, opt->index_out, opt->write_flags) != 0) {
+		fprintf(stderr, "Error, couldn't write index '%s'\n", opt->index_out);
+		goto finish;
+	}
+
+	printf("= %s generated, %d devices\n", opt->index_out, sii_index_count(index));
+
+	if (failed > 0)
+		fprintf(stderr, "%zu of %zu files failed\n", failed, list.count);
+	else
+		ret = 0;
+
+finish:
+	if (job != NULL) {
+		for (size_t i = 0; i < list.count; i++) {
+			free(job[i].sig);
+			free(job[i].valid);
+		}
+		free(job);
+	}
+	sii_index_free(index);
+	file_list_release(&list);
+
+	return ret;
+}
+
+struct _lookup_job {
+	const char *input;
+	const struct _sii_index_entry *entry;
+	unsigned int matched; /* SII_MATCH_* */
+	int exact;
+	int ret;
+};
+
+struct _lookup {
+	SiiIndex *index;
+	struct _lookup_job *job;
+};
+
+static void lookup_worker(void *arg, size_t n, unsigned int worker)
+{
+	struct _lookup *lookup = (struct _lookup *)arg;
+	struct _lookup_job *job = &lookup->job[n];
+	struct _input input = { NULL, 0, 0 };
+	struct _sii_signature sig;
+
+	(void)worker;
+
+	job->ret = read_file(job->input, &input);
+	if (job->ret != 0)
+		return;
+
+	SiiInfo *image = sii_init_string(input.buffer, input.length);
+	if (image == NULL) {
+		job->ret = -1;
+	} else {
+		sii_signature(image, &sig);
+		sii_release(image);
+
+		job->entry = sii_index_lookup(lookup->index, &sig, &job->matched, &job->exact);
+	}
+
+	release_input(&input);
+}
+
+static void print_lookup(FILE *f, const struct _lookup_job *job)
+{
+	if (job->entry == NULL) {
+		fprintf(f, "%s,,,none\n", job->input);
+		return;
+	}
+
+	fprintf(f, "%s,%s,%d,", job->input, job->entry->file, job->entry->device);
+
+	if (job->exact) {
+		fprintf(f, "exact\n");
+		return;
+	}
+
+	const char *sep = "";
+	for (unsigned int m = 1; m <= SII_MATCH_DC; m <<= 1) {
+		if (job->matched & m) {
+			fprintf(f, "%s%s", sep, sii_match_name(m));
+			sep = "+";
+		}
+	}
+	fprintf(f, "\n");
+}
+
+/* the ESI device of the index which matches each dump below paths best */
+static int run_lookup(const struct _options *opt, char **paths, int npaths)
+{
+	struct _file_list list = { NULL, 0, 0 };
+	struct _lookup lookup = { NULL, NULL };
+	size_t failed = 0;
+	int ret = -1;
+
+	lookup.index = sii_index_read(opt->index_in);
+	if (lookup.index == NULL)
+		return -1;
+
+	for (int i = 0; i < npaths; i++) {
+		if (collect_inputs(&list, paths[i], 1, scan_suffix) != 0)
+			goto finish;
+	}
+
+	lookup.job = calloc(list.count > 0 ? list.count : 1, sizeof(struct _lookup_job));
+	if (lookup.job == NULL) {
+		fprintf(stderr, "Malloc failed! Out of memory?\n");
+		goto finish;
+	}
+
+	for (size_t i = 0; i < list.count; i++)
+		lookup.job[i].input = list.name[i];
+
+	if (pool_run(opt->workers, list.count, lookup_worker, &lookup) != 0) {
+		fprintf(stderr, "Error, couldn't run worker pool\n");
+		goto finish;
+	}
+
+	for (size_t i = 0; i < list.count; i++) {
+		if (lookup.job[i].ret != 0) {
+			fprintf(stderr, "Error, couldn't read '%s'\n", lookup.job[i].input);
+			failed++;
+			continue;
+		}
+
+		print_lookup(stdout, &lookup.job[i]);
+	}
+
+	if (failed > 0)
+		fprintf(stderr, "%zu of %zu files failed\n", failed, list.count);
+	else
+		ret = 0;
+
+finish:
+	free(lookup.job);
+	sii_index_free(lookup.index);
+	file_list_release(&list);
+
+	return ret;
+}
+
+int main(int argc, char *argv[])
+{
+	struct _input input = { NULL, 0, 0 };
+	struct _options opt;
+	char *filename = NULL;
+	char *output = NULL;
+	int ret = -1;
+	int c;
+
+	memset(&opt, 0, sizeof(opt));
+	opt.device.keys = ESI_SELECT_NUMBER;
+	opt.device.number = 0;
+	opt.alias = -1;
+	opt.read_model.read_size = DEFAULT_READ_SIZE;
+	opt.read_model.access_us = DEFAULT_ACCESS_US;
+
+	static const struct option long_options[] = {
+		{ "size-report", no_argument, NULL, 'R' },
+		{ "read-size", required_argument, NULL, 'r' },
+		{ "access-us", required_argument, NULL, 'u' },
+		{ "sidecar", required_argument, NULL, 'D' },
+		{ "scan", required_argument, NULL, 'N' },
+		{ "get", required_argument, NULL, 'G' },
+		{ "diff", required_argument, NULL, 'I' },
+		{ "build-index", required_argument, NULL, 'X' },
+		{ "lookup", required_argument, NULL, 'L' },
+		{ NULL, 0, NULL, 0 }
+	};
+
+	while ((c = getopt_long(argc, argv, "hvo:pmcslabfj:d:S:A:F:O:", long_options, NULL)) != -1) {
+		switch (c) {
+		case 'R':
+			opt.size_report = 1;
+			break;
+		case 'D':
+			opt.sidecar = optarg;
+			break;
+		case 'I':
+			opt.diff_file = optarg;
+			break;
+		case 'X':
+			opt.index_out = optarg;
+			break;
+		case 'L':
+			opt.index_in = optarg;
+			break;
+		case 'G':
+			if (parse_fields(optarg, &opt.get) != 0) {
+				fprintf(stderr, "Invalid field list\n");
+				printhelp(base(argv[0]));
+				return -1;
+			}
+			break;
+		case 'N':
+			if (strcmp(optarg, "csv") == 0)
+				opt.scan = SCAN_CSV;
+			else if (strcmp(optarg, "json") == 0)
+				opt.scan = SCAN_JSON;
+			else {
+				fprintf(stderr, "Invalid scan format, use csv or json\n");
+				printhelp(base(argv[0]));
+				return -1;
+			}
+			break;
+		case 'r':
+			if (sscanf(optarg, "%zu", &opt.read_model.read_size) != 1 ||
+					(opt.read_model.read_size != 2 && opt.read_model.read_size != 4 &&
+					 opt.read_model.read_size != 8)) {
+				fprintf(stderr, "Invalid read size, use 2, 4 or 8\n");
+				printhelp(base(argv[0]));
+				return -1;
+			}
+			break;
+		case 'u':
+			if (sscanf(optarg, "%u", &opt.read_model.access_us) != 1) {
+				fprintf(stderr, "Invalid access time\n");
+				printhelp(base(argv[0]));
+				return -1;
+			}
+			break;
+		case 'h':
+			printhelp(base(argv[0]));
+			return 0;
+		case 'v':
+			printf("%s %s\n",
+				base(argv[0]),
+				VERSION);
+			return 0;
+		case 'o':
+			output = optarg;
+			break;
+		case 'p':
+			opt.print_content = 1;
+			break;
+		case 'm':
+			opt.add_pdo_mapping = 1;
+			break;
+		case 'c':
+			opt.add_dc_section = 1;
+			break;
+		case 's':
+			opt.stream_input = 1;
+			break;
+		case 'l':
+			opt.list_devices = 1;
+			break;
+		case 'a':
+			opt.all_devices = 1;
+			break;
+		case 'b':
+			opt.batch = 1;
+			break;
+		case 'f':
+			opt.write_flags |= SII_WRITE_SYNC;
+			break;
+		case 'j':
+			if (sscanf(optarg, "%u", &opt.workers) != 1) {
+				fprintf(stderr, "Invalid number of workers\n");
+				printhelp(base(argv[0]));
+				return -1;
+			}
+			break;
+		case 'S':
+			if (parse_serials(optarg, &opt.serials) != 0) {
+				fprintf(stderr, "Invalid serial numbers\n");
+				printhelp(base(argv[0]));
+				return -1;
+			}
+			break;
+		case 'F':
+			opt.flash_dump = optarg;
+			break;
+		case 'O':
+			if (strcmp(optarg, "type") == 0)
+				opt.order = SII_ORDER_TYPE;
+			else if (strcmp(optarg, "startup") == 0)
+				opt.order = SII_ORDER_STARTUP;
+			else {
+				fprintf(stderr, "Invalid category order\n");
+				printhelp(base(argv[0]));
+				return -1;
+			}
+			opt.order_set = 1;
+			break;
+		case 'A': {
+			char *end;
+			opt.alias = strtol(optarg, &end, 0);
+			if (end == optarg || *end != '\0' || opt.alias < 0 || opt.alias > 0xffff) {
+				fprintf(stderr, "Invalid station alias\n");
+				printhelp(base(argv[0]));
+				return -1;
+			}
+			break;
+		}
+		case 'd':
+			if (esi_selector_parse(&opt.device, optarg) != 0) {
+				fprintf(stderr, "Invalid device selection\n");
+				printhelp(base(argv[0]));
+				return -1;
+			}
+			break;
+		default:
+			fprintf(stderr, "Invalid argument\n");
+			printhelp(base(argv[0]));
+			return 0;
+		}
+	}
+
+	if (opt.alias >= 0 && opt.serials.count == 0) {
+		fprintf(stderr, "Error, -A needs serial numbers with -S\n");
+		return -1;
+	}
+
+	if (opt.serials.count > 0 && (opt.batch || opt.all_devices || opt.print_content || opt.list_devices)) {
+		fprintf(stderr, "Error, -S can't be combined with -a, -b, -l or -p\n");
+		return -1;
+	}
+
+	if (opt.flash_dump != NULL && (opt.serials.count > 0 || opt.batch || opt.all_devices ||
+				opt.print_content || opt.list_devices)) {
+		fprintf(stderr, "Error, -F can't be combined with -S, -a, -b, -l or -p\n");
+		return -1;
+	}
+
+	if (opt.size_report && (opt.serials.count > 0 || opt.flash_dump != NULL || opt.all_devices ||
+				opt.print_content || opt.list_devices)) {
+		fprintf(stderr, "Error, --size-report can't be combined with -S, -F, -a, -l or -p\n");
+		return -1;
+	}
+
+	if (opt.sidecar != NULL && (opt.size_report || opt.flash_dump != NULL || opt.batch ||
+				opt.all_devices || opt.print_content || opt.list_devices)) {
+		fprintf(stderr, "Error, --sidecar can't be combined with --size-report, -F, -a, -b, -l or -p\n");
+		return -1;
+	}
+
+	if (opt.diff_file != NULL && (opt.serials.count > 0 || opt.flash_dump != NULL || opt.size_report ||
+				opt.sidecar != NULL || opt.batch || opt.all_devices || opt.print_content ||
+				opt.list_devices)) {
+		fprintf(stderr, "Error, --diff can't be combined with -S, -F, --size-report, --sidecar, -a, -b, -l or -p\n");
+		return -1;
+	}
+
+	if (opt.index_out != NULL || opt.index_in != NULL) {
+		if ((opt.index_out != NULL && opt.index_in != NULL) || opt.get.count > 0 ||
+				opt.scan != SCAN_NONE || opt.diff_file != NULL || opt.serials.count > 0 ||
+				opt.flash_dump != NULL || opt.size_report || opt.sidecar != NULL || opt.batch ||
+				opt.all_devices || opt.print_content || opt.list_devices || output != NULL) {
+			fprintf(stderr, "Error, --build-index and --lookup can't be combined with each other or other modes\n");
+			return -1;
+		}
+
+		if (optind >= argc) {
+			fprintf(stderr, "Error, %s needs at least one file or directory\n",
+					opt.index_out != NULL ? "--build-index" : "--lookup");
+			return -1;
+		}
+
+		if (opt.index_out != NULL)
+			return build_index(&opt, &argv[optind], argc - optind);
+
+		return run_lookup(&opt, &argv[optind], argc - optind);
+	}
+
+	if (opt.get.count > 0) {
+		if (opt.scan != SCAN_NONE || opt.diff_file != NULL || opt.serials.count > 0 ||
+				opt.flash_dump != NULL || opt.size_report ||
+				opt.sidecar != NULL || opt.batch || opt.all_devices || opt.print_content ||
+				opt.list_devices || output != NULL) {
+			fprintf(stderr, "Error, --get can't be combined with --scan, --diff, -S, -F, --size-report, --sidecar, -a, -b, -l, -o or -p\n");
+			return -1;
+		}
+
+		if (optind >= argc) {
+			fprintf(stderr, "Error, --get needs at least one file or directory\n");
+			return -1;
+		}
+
+		return run_get(&opt, &argv[optind], argc - optind);
+	}
+
+	if (opt.scan != SCAN_NONE) {
+		if (opt.diff_file != NULL || opt.serials.count > 0 || opt.flash_dump != NULL || opt.size_report ||
+				opt.sidecar != NULL || opt.batch || opt.all_devices || opt.print_content ||
+				opt.list_devices || output != NULL) {
+			fprintf(stderr, "Error, --scan can't be combined with --diff, -S, -F, --size-report, --sidecar, -a, -b, -l, -o or -p\n");
+			return -1;
+		}
+
+		if (optind >= argc) {
+			fprintf(stderr, "Error, --scan needs at least one file or directory\n");
+			return -1;
+		}
+
+		return run_scan(&opt, &argv[optind], argc - optind);
+	}
+
+	if (opt.batch) {
+		if (optind >= argc) {
+			fprintf(stderr, "Error, batch mode needs at least one file or directory\n");
+			return -1;
+		}
+
+		return run_batch(&opt, &argv[optind], argc - optind, output);
+	}
+
+	if (argc - optind > 1) {
+		fprintf(stderr, "Error, more than one input file, use -b for batch processing\n");
+		return -1;
+	}
+
+	/* "-" or no file name: read from stdin (default) */
+	if (optind < argc && strcmp(argv[optind], "-") != 0)
+		filename = argv[optind];
+
+	if (filename == NULL) {
+		if (read_input(STDIN_FILENO, &input) != 0)
+			goto finish;
+	} else {
+		if (read_file(filename, &input) != 0)
+			goto finish;
+	}
+
+	ret = process_input(&opt, filename, &input, output, stdout);
+
+finish:
+	release_input(&input);
+	free(opt.serials.serial);
 
 	return ret;
 }
@@ -0,0 +1,79 @@
+#!/usr/bin/env python3
+# Generates the perfect hash table of esitag.c from the ESI vocabulary
+# below. Run after adding names and paste the output into esitag.c, the
+# enum in esitag.h must list the names in the same order.
+#
+#   $ python3 misc/esitag.py
+
+import re
+import sys
+
+VOCABULARY = [
+    # elements
+    "Vendor", "Descriptions", "Groups", "Group", "Devices", "Device",
+    "Type", "Name", "Id", "Sm", "Fmmu", "Dc", "OpMode", "Desc",
+    "AssignActivate", "CycleTimeSync0", "CycleTimeSync1",
+    "ShiftTimeSync0", "ShiftTimeSync1", "RxPdo", "TxPdo", "Entry",
+    "Index", "SubIndex", "BitLen", "DataType", "Mailbox", "CoE", "EoE",
+    "FoE", "VoE", "Eeprom", "ByteSize", "BootStrap", "ConfigData",
+    "Dictionary", "ImageData16x14",
+    # attributes
+    "ProductCode", "RevisionNo", "Physics", "SdoInfo", "PdoAssign",
+    "PdoConfig", "PdoUpload", "DefaultSize", "StartAddress",
+    "ControlByte", "Enable", "Fixed", "Mandatory", "Virtual",
+    "OverwrittenByModule",
+    # element values
+    "Inputs", "Outputs", "MBoxState", "MBoxIn", "MBoxOut",
+]
+
+SIZE = 128  # table size, power of 2
+
+
+def enum_name(word):
+    special = {"CoE": "COE", "EoE": "EOE", "FoE": "FOE", "VoE": "VOE",
+               "MBoxState": "MBOX_STATE", "MBoxIn": "MBOX_IN",
+               "MBoxOut": "MBOX_OUT", "ImageData16x14": "IMAGE_DATA_16X14"}
+    if word in special:
+        return "ESI_TAG_" + special[word]
+    return "ESI_TAG_" + re.sub(r"(?<=[a-z0-9])(?=[A-Z])", "_", word).upper()
+
+
+def tag_hash(word, a, b, c):
+    n = len(word)
+    return (n + a * ord(word[0]) + b * ord(word[n - 1]) + c * ord(word[n // 2])) & (SIZE - 1)
+
+
+def search():
+    for a in range(1, 64):
+        for b in range(1, 64):
+            for c in range(0, 64):
+                slots = set(tag_hash(w, a, b, c) for w in VOCABULARY)
+                if len(slots) == len(VOCABULARY):
+                    return a, b, c
+    sys.exit("no perfect hash found, increase SIZE")
+
+
+def main():
+    a, b, c = search()
+    table = [None] * SIZE
+    for w in VOCABULARY:
+        table[tag_hash(w, a, b, c)] = w
+
+    print("#define TAG_HASH_A  %d" % a)
+    print("#define TAG_HASH_B  %d" % b)
+    print("#define TAG_HASH_C  %d" % c)
+    print("#define TAG_HASH_SIZE  %d" % SIZE)
+    print()
+    print("static const struct _tag_entry tag_table[TAG_HASH_SIZE] = {")
+    for i, w in enumerate(table):
+        if w is not None:
+            print('\t[%d] = { "%s", %d, %s },' % (i, w, len(w), enum_name(w)))
+    print("};")
+    print()
+    print("/* enum eEsiTag */")
+    for w in VOCABULARY:
+        print("\t,%s" % enum_name(w))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,157 @@
+/* pool - run independent jobs on a set of worker threads
+ */
+
+#include "pool.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <pthread.h>
+
+/* the jobs [head, tail) not yet started by a worker */
+struct _queue {
+	pthread_mutex_t lock;
+	size_t head;  /* taken by the owner */
+	size_t tail;  /* stolen from by the other workers */
+};
+
+struct _pool {
+	struct _queue *queue;
+	unsigned int workers;
+	pool_job_fn fn;
+	void *arg;
+};
+
+struct _worker {
+	struct _pool *pool;
+	unsigned int id;
+};
+
+static int queue_pop(struct _queue *q, size_t *job)
+{
+	int found = 0;
+
+	pthread_mutex_lock(&q->lock);
+	if (q->head < q->tail) {
+		*job = q->head++;
+		found = 1;
+	}
+	pthread_mutex_unlock(&q->lock);
+
+	return found;
+}
+
+/* move the upper half of the victims jobs to the (empty) queue q */
+static int queue_steal(struct _queue *q, struct _queue *victim)
+{
+	size_t head, tail;
+
+	pthread_mutex_lock(&victim->lock);
+	tail = victim->tail;
+	head = tail - (victim->tail - victim->head + 1) / 2;
+	victim->tail = head;
+	pthread_mutex_unlock(&victim->lock);
+
+	if (head == tail)
+		return 0;
+
+	pthread_mutex_lock(&q->lock);
+	q->head = head;
+	q->tail = tail;
+	pthread_mutex_unlock(&q->lock);
+
+	return 1;
+}
+
+static void *pool_worker(void *data)
+{
+	struct _worker *w = (struct _worker *)data;
+	struct _pool *pool = w->pool;
+	struct _queue *own = &pool->queue[w->id];
+	size_t job;
+
+	for (;;) {
+		while (queue_pop(own, &job))
+			pool->fn(pool->arg, job, w->id);
+
+		/* Jobs are never added, so if no other worker has something left
+		 * all jobs are either done or in progress. */
+		unsigned int i;
+		for (i = 1; i < pool->workers; i++) {
+			if (queue_steal(own, &pool->queue[(w->id + i) % pool->workers]))
+				break;
+		}
+
+		if (i == pool->workers)
+			break;
+	}
+
+	return NULL;
+}
+
+unsigned int pool_default_workers(void)
+{
+	long n = sysconf(_SC_NPROCESSORS_ONLN);
+
+	return (n < 1) ? 1 : (unsigned int)n;
+}
+
+int pool_run(unsigned int workers, size_t jobs, pool_job_fn fn, void *arg)
+{
+	if (workers == 0)
+		workers = pool_default_workers();
+
+	if (workers > jobs)
+		workers = (unsigned int)jobs;
+
+	if (workers <= 1) {
+		for (size_t job = 0; job < jobs; job++)
+			fn(arg, job, 0);
+		return 0;
+	}
+
+	struct _pool pool = { NULL, workers, fn, arg };
+	struct _worker *worker = calloc(workers, sizeof(struct _worker));
+	pthread_t *threads = calloc(workers, sizeof(pthread_t));
+	pool.queue = calloc(workers, sizeof(struct _queue));
+
+	if (worker == NULL || threads == NULL || pool.queue == NULL) {
+		free(worker);
+		free(threads);
+		free(pool.queue);
+		return -1;
+	}
+
+	/* every worker starts with an equal contiguous share */
+	for (unsigned int i = 0; i < workers; i++) {
+		pthread_mutex_init(&pool.queue[i].lock, NULL);
+		pool.queue[i].head = jobs * i / workers;
+		pool.queue[i].tail = jobs * (i + 1) / workers;
+		worker[i].pool = &pool;
+		worker[i].id = i;
+	}
+
+	/* the calling thread is worker 0, if not all threads come up the
+	 * remaining ones steal the work of the missing */
+	unsigned int started = 1;
+	for (; started < workers; started++) {
+		if (pthread_create(&threads[started], NULL, pool_worker, &worker[started]) != 0) {
+			fprintf(stderr, "Warning, couldn't start worker thread\n");
+			break;
+		}
+	}
+
+	pool_worker(&worker[0]);
+
+	for (unsigned int i = 1; i < started; i++)
+		pthread_join(threads[i], NULL);
+
+	for (unsigned int i = 0; i < workers; i++)
+		pthread_mutex_destroy(&pool.queue[i].lock);
+
+	free(worker);
+	free(threads);
+	free(pool.queue);
+
+	return 0;
+}
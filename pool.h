@@ -0,0 +1,33 @@
+/* pool - run independent jobs on a set of worker threads
+ */
+
+#ifndef POOL_H
+#define POOL_H
+
+#include <stddef.h>
+
+/* called once for every job number 0 <= job < jobs, worker is the number
+ * 0 <= worker < workers of the calling thread and can be used to index
+ * per-thread state */
+typedef void (*pool_job_fn)(void *arg, size_t job, unsigned int worker);
+
+/* number of online processors, at least 1 */
+unsigned int pool_default_workers(void);
+
+/**
+ * \brief Run jobs in parallel
+ *
+ * Blocks until all jobs are finished. Every worker starts on its own
+ * contiguous share of the job numbers and steals half of the remaining jobs
+ * of another worker once its share is done. With workers <= 1 or a single
+ * job everything is executed in the calling thread.
+ *
+ * \param workers  number of threads, 0 selects pool_default_workers()
+ * \param jobs     number of jobs
+ * \param fn       job function, must be safe to call concurrently
+ * \param arg      passed to every call of fn
+ * \return 0 on success, -1 if out of memory
+ */
+int pool_run(unsigned int workers, size_t jobs, pool_job_fn fn, void *arg);
+
+#endif /* POOL_H */
@@ -5,12 +5,14 @@
 
 #include "sii.h"
 #include "crc8.h"
+#include "log.h"
 #include <stdio.h>
 #include <stdint.h>
 #include <string.h>
 #include <stdlib.h>
 #include <errno.h>
 #include <unistd.h>
+#include <fcntl.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 
@@ -18,24 +20,25 @@
 #define SKIP_TXPDO    0x0010
 #define SKIP_RXPDO    0x0020
 
+/* the arena used by sii_init*() of this thread, NULL for a private one */
+static __thread Arena *g_thread_arena = NULL;
+
 /* category functions */
-static struct _sii_cat *cat_new(uint16_t type, uint16_t size);
-static void cat_data_cleanup(struct _sii_cat *cat);
+static struct _sii_cat *cat_new(SiiInfo *sii, uint16_t type, uint16_t size, size_t offset);
 static int cat_add(SiiInfo *sii, struct _sii_cat *new);
-static int cat_rm(SiiInfo *sii);
 static struct _sii_cat * cat_next(SiiInfo *sii);
 static void cat_rewind(SiiInfo *sii);
 
-static void cat_print(struct _sii_cat *cats);
-static void cat_print_strings(struct _sii_cat *cat);
-static void cat_print_datatypes(struct _sii_cat *cat);
-static void cat_print_general(struct _sii_cat *cat);
-static void cat_print_fmmu(struct _sii_cat *cat);
-static void cat_print_syncm(struct _sii_cat *cat);
-static void cat_print_rxpdo(struct _sii_cat *cat);
-static void cat_print_txpdo(struct _sii_cat *cat);
-static void cat_print_pdo(struct _sii_cat *cat);
-static void cat_print_dc(struct _sii_cat *cat);
+static void cat_print(FILE *f, struct _sii_cat *cats);
+static void cat_print_strings(FILE *f, struct _sii_cat *cat);
+static void cat_print_datatypes(FILE *f, struct _sii_cat *cat);
+static void cat_print_general(FILE *f, struct _sii_cat *cat);
+static void cat_print_fmmu(FILE *f, struct _sii_cat *cat);
+static void cat_print_syncm(FILE *f, struct _sii_cat *cat);
+static void cat_print_rxpdo(FILE *f, struct _sii_cat *cat);
+static void cat_print_txpdo(FILE *f, struct _sii_cat *cat);
+static void cat_print_pdo(FILE *f, struct _sii_cat *cat);
+static void cat_print_dc(FILE *f, struct _sii_cat *cat);
 
 static uint16_t sii_cat_write_strings(struct _sii_cat *cat, unsigned char *buf);
 static uint16_t sii_cat_write_datatypes(struct _sii_cat *cat, unsigned char *buf);
@@ -49,8 +52,8 @@ static uint16_t sii_cat_write_dc(struct _sii_cat *cat, unsigned char *buf);
 #if DEBUG == 1
 static uint16_t sii_cat_write_cat(struct _sii_cat *cat, unsigned char *buf);
 #endif
-static size_t sii_cat_write(struct _sii *sii, uint16_t skip_mask);
-static void sii_write(SiiInfo *sii, unsigned int add_pdo_mapping, unsigned int add_dc_config);
+static size_t sii_cat_write(struct _sii *sii, unsigned char *image, uint16_t skip_mask);
+static size_t sii_write(SiiInfo *sii, unsigned char *buf, uint16_t skip_mask, const struct _sii_layout *layout);
 
 static int read_eeprom(FILE *f, unsigned char *buffer, size_t size)
 {
@@ -59,7 +62,7 @@ static int read_eeprom(FILE *f, unsigned char *buffer, size_t size)
 
 	while ((input=fgetc(f)) != EOF) {
 		if (count >= size) {
-			fprintf(stderr, "Error, buffer too small\n");
+			sii_error("Error, buffer too small\n");
 			return -1;
 		}
 		buffer[count++] = (unsigned char)(input&0xff);
@@ -68,73 +71,59 @@ static int read_eeprom(FILE *f, unsigned char *buffer, size_t size)
 	return count;
 }
 
-static struct _sii_preamble * parse_preamble(const unsigned char *buffer, size_t size)
+static struct _sii_preamble * parse_preamble(SiiInfo *sii, const unsigned char *buffer, size_t size)
 {
-	struct _sii_preamble *preamble = calloc(1, sizeof(struct _sii_preamble));
+	struct _sii_preamble *preamble = sii_alloc(sii, sizeof(struct _sii_preamble));
 
 	size_t count = 0;
-	uint8_t crc = 0xff; /* init value for crc */
 
 	/* pdi control */
 	preamble->pdi_ctrl = ((int)(buffer[1]&0xff)<<8) | buffer[0];
-	crc8byte(&crc, buffer[0]);
-	crc8byte(&crc, buffer[1]);
 
 	/* pdi config */
 	preamble->pdi_conf = ((int)(buffer[3]&0xff)<<8) | buffer[2];
-	crc8byte(&crc, buffer[2]);
-	crc8byte(&crc, buffer[3]);
 
 	count = 4;
 
 	/* sync impulse len (multiples of 10ns), stored as nano seconds */
 	preamble->sync_impulse = BYTES_TO_WORD(buffer[count], buffer[count+1]);
-	crc8byte(&crc, buffer[count]);
-	crc8byte(&crc, buffer[count+1]);
 	count+=2;
 
 	/* PDI config 2 */
 	preamble->pdi_conf2 = BYTES_TO_WORD(buffer[count], buffer[count+1]);
-	crc8byte(&crc, buffer[count]);
-	crc8byte(&crc, buffer[count+1]);
 	count+=2;
 
 	/* configured station alias */
 	preamble->alias = BYTES_TO_WORD(buffer[count], buffer[count+1]);
-	crc8byte(&crc, buffer[count]);
-	crc8byte(&crc, buffer[count+1]);
 	count+=2;
 
-	crc8byte(&crc, buffer[count]);
-	crc8byte(&crc, buffer[count+1]);
-	crc8byte(&crc, buffer[count+2]);
-	crc8byte(&crc, buffer[count+3]);
 	count+=4; /* next 4 bytes are reserved */
 
 	/* checksum test */
 	preamble->checksum = BYTES_TO_WORD(buffer[count], buffer[count+1]);
-	crc8byte(&crc, buffer[count]);
-	crc8byte(&crc, buffer[count+1]);
 	count += 2;
 
 	if (size != count)
-		printf("%s: Warning counter differs from size\n", __func__);
+		sii_warning("%s: Warning counter differs from size\n", __func__);
+
+	/* the crc over the data and the stored checksum is zero */
+	uint8_t crc = crc8_final(crc8_update(crc8_init(), buffer, count));
 
 	preamble->checksum_ok = 1;
 	if (crc != 0) {
 		preamble->checksum_ok = 0;
-		fprintf(stderr, "Error, checksum is not correct!\n");
+		sii_error("Error, checksum is not correct!\n");
 	}
 
 	return preamble;
 }
 
-static struct _sii_stdconfig *parse_stdconfig(const unsigned char *buffer, size_t size)
+static struct _sii_stdconfig *parse_stdconfig(SiiInfo *sii, const unsigned char *buffer, size_t size)
 {
 	size_t count =0;
 	const unsigned char *b = buffer;
 
-	struct _sii_stdconfig *stdc = calloc(1, sizeof(struct _sii_stdconfig));
+	struct _sii_stdconfig *stdc = sii_alloc(sii, sizeof(struct _sii_stdconfig));
 
 	stdc->vendor_id = BYTES_TO_DWORD(*(b+0), *(b+1), *(b+2), *(b+3));
 	b+=4;
@@ -176,73 +165,135 @@ static struct _sii_stdconfig *parse_stdconfig(const unsigned char *buffer, size_
 
 	count = b-buffer;
 	if (size != count)
-		printf("%s: Warning counter differs from size\n", __func__);
+		sii_warning("%s: Warning counter differs from size\n", __func__);
 
 	return stdc;
 }
 
-static struct _string *string_new(const char *string, size_t size)
+/* FNV-1a */
+static uint32_t string_hash(const char *string, size_t size)
 {
-	struct _string *new = calloc(1, sizeof(struct _string));
+	uint32_t hash = 2166136261u;
 
-	new->length = size;
-	new->data = malloc(size+1);
-	memmove(new->data, string, size);
-	new->data[size] = 0;
+	for (size_t i = 0; i < size; i++) {
+		hash ^= (unsigned char)string[i];
+		hash *= 16777619u;
+	}
+
+	return hash;
+}
+
+/* Make room for one more element in a growable array, returns the possibly
+ * moved array or NULL if out of memory. */
+static void *array_reserve(Arena *arena, void *array, int count, int *capacity, size_t elemsize)
+{
+	if (count < *capacity)
+		return array;
+
+	int size = *capacity ? 2 * *capacity : 8;
+	void *new = arena_realloc(arena, array, (size_t)*capacity * elemsize, (size_t)size * elemsize);
+	if (new != NULL)
+		*capacity = size;
 
 	return new;
 }
 
-static void strings_entry_add(struct _sii_strings *str, struct _string *new)
+static const char *string_data(const struct _sii_strings *str, const struct _string *s)
 {
-	if (str->head == NULL) { /* first entry */
-		str->head = new;
-		new->id = 1;
-	} else {
-		struct _string *s = str->head;
-		while (s->next)
-			s = s->next;
+	return str->text + s->offset;
+}
+
+static struct _string *strings_lookup(struct _sii_strings *str, const char *string, size_t size, uint32_t hash)
+{
+	for (int id = str->bucket[hash % STRINGS_HASH_SIZE]; id > 0; id = str->string[id-1].hash_next) {
+		struct _string *s = &str->string[id-1];
+		const char *data = string_data(str, s);
+
+		if (s->hash == hash && strlen(data) == size && memcmp(data, string, size) == 0)
+			return s;
+	}
+
+	return NULL;
+}
+
+/* Append a string, returns its id or -1 if out of memory */
+static int strings_entry_add(struct _sii_strings *str, const char *string, size_t size)
+{
+	struct _string *array = array_reserve(str->arena, str->string, str->count, &str->capacity, sizeof(struct _string));
+	if (array == NULL)
+		return -1;
+	str->string = array;
+
+	if (str->text_size + size + 1 > str->text_capacity) {
+		size_t capacity = str->text_capacity ? 2 * str->text_capacity : 512;
+		while (capacity < str->text_size + size + 1)
+			capacity *= 2;
+
+		char *text = arena_realloc(str->arena, str->text, str->text_capacity, capacity);
+		if (text == NULL)
+			return -1;
 
-		s->next = new;
-		new->prev = s;
-		new->id = s->id+1;
+		str->text = text;
+		str->text_capacity = capacity;
+	}
+
+	struct _string *new = &str->string[str->count];
+	new->length = size;
+	new->offset = str->text_size;
+	new->id = str->count + 1;
+	new->hash_next = 0;
+
+	memmove(str->text + str->text_size, string, size);
+	str->text[str->text_size + size] = '\0';
+	str->text_size += size + 1;
+
+	/* lookups see the data up to the first zero byte */
+	size_t length = strlen(str->text + new->offset);
+	new->hash = string_hash(str->text + new->offset, length);
+
+	/* SII input may contain duplicates, the index keeps the first one */
+	if (strings_lookup(str, str->text + new->offset, length, new->hash) == NULL) {
+		new->hash_next = str->bucket[new->hash % STRINGS_HASH_SIZE];
+		str->bucket[new->hash % STRINGS_HASH_SIZE] = new->id;
 	}
 
 	str->count += 1;
 	str->size += new->length;
+
+	return new->id;
 }
 
-static struct _sii_strings *parse_string_section(const unsigned char *buffer, size_t size)
+static void parse_string_section(struct _sii_strings *strings, const unsigned char *buffer, size_t size)
 {
 	const unsigned char *pos = buffer;
-	unsigned index = 0;
-	char str[1024];
+	const unsigned char *end = buffer + size;
 	size_t len = 0;
-	memset(str, '\0', 1024);
 
-	struct _sii_strings *strings = (struct _sii_strings *)calloc(1, sizeof(struct _sii_strings));
+	if (size == 0)
+		return;
 
 	int stringcount = *pos++;
-	int counter = 0;
 
-	for (index=0; counter < stringcount; index++) {
+	for (int counter = 0; counter < stringcount; counter++) {
+		if (pos >= end) {
+			sii_warning("%s: Warning strings exceed the category\n", __func__);
+			return;
+		}
+
 		len = *pos++;
-		memmove(str, pos, len);
-		pos += len;
+		if (len > (size_t)(end - pos)) {
+			sii_warning("%s: Warning strings exceed the category\n", __func__);
+			return;
+		}
 
-		strings_entry_add(strings, string_new(str, len));
-		counter++;
+		strings_entry_add(strings, (const char *)pos, len);
+		pos += len;
 	}
-
-	if ((size_t)(pos-buffer) > size)
-		printf("%s: Warning counter differs from size\n", __func__);
-
-	return strings;
 }
 
 static void parse_datatype_section(const unsigned char *buffer, size_t size)
 {
-	printf("\n+++ parsing of datatype section not yet implemented (first byte: 0x%.2x, size: %zu)\n",
+	sii_warning("\n+++ parsing of datatype section not yet implemented (first byte: 0x%.2x, size: %zu)\n",
 			*buffer, size);
 }
 
@@ -264,10 +315,9 @@ static char *physport_type(uint8_t b)
 	return NULL;
 }
 
-static struct _sii_general *parse_general_section(const unsigned char *buffer, size_t size)
+static void parse_general_section(struct _sii_general *siig, const unsigned char *buffer, size_t size)
 {
 	const unsigned char *b = buffer;
-	struct _sii_general *siig = calloc(1, sizeof(struct _sii_general));
 
 	siig->groupindex = *b;
 	b++;
@@ -318,141 +368,73 @@ static struct _sii_general *parse_general_section(const unsigned char *buffer, s
 
 	size_t count = b-buffer;
 	if (size != count)
-		printf("%s: Warning counter differs from size\n", __func__);
-
-	return siig;
-}
-
-static void fmmu_rm_entry(struct _sii_fmmu *fmmu)
-{
-	struct _fmmu_entry *fe = fmmu->list;
-	while (fe->next != NULL)
-		fe = fe->next;
-
-	if (fe->prev != NULL)
-		fe->prev->next = NULL;
-	else
-		fmmu->list = NULL;
-
-	free(fe);
+		sii_warning("%s: Warning counter differs from size\n", __func__);
 }
 
 void fmmu_add_entry(struct _sii_fmmu *fmmu, int usage)
 {
-	struct _fmmu_entry *new = calloc(1, sizeof(struct _fmmu_entry));
-	new->id = -1;
-	new->usage = usage;
-	if (usage == FMMU_UNUSED) { /* skip unused entries */
-		free(new);
+	if (usage == FMMU_UNUSED) /* skip unused entries */
 		return;
-	}
-
-	if (fmmu->list == NULL) {
-		new->id = 0;
-		fmmu->list = new;
-		fmmu->count = 1;
-	} else {
-		struct _fmmu_entry *f = fmmu->list;
-		while (f->next != NULL)
-			f = f->next;
 
-		f->next = new;
-		new->prev = f;
-		new->id = f->id+1;
-		fmmu->count += 1;
+	struct _fmmu_entry *array = array_reserve(fmmu->arena, fmmu->entry, fmmu->count, &fmmu->capacity, sizeof(struct _fmmu_entry));
+	if (array == NULL) {
+		sii_error("Error, out of memory\n");
+		return;
 	}
+	fmmu->entry = array;
+
+	struct _fmmu_entry *new = &fmmu->entry[fmmu->count];
+	new->usage = usage;
+	new->id = fmmu->count;
+	fmmu->count += 1;
 }
 
-static struct _sii_fmmu *parse_fmmu_section(const unsigned char *buffer, size_t secsize)
+static void parse_fmmu_section(struct _sii_fmmu *fmmu, const unsigned char *buffer, size_t secsize)
 {
 	const unsigned char *b = buffer;
 
-	struct _sii_fmmu *fmmu = calloc(1, sizeof(struct _sii_fmmu));
-
 	while ((unsigned int)(b-buffer)<secsize) {
 		fmmu_add_entry(fmmu, *b);
 		b++;
 	}
-
-	return fmmu;
 }
 
-static void syncm_rm_entry(struct _sii_syncm *sm)
+void syncm_entry_add(struct _sii_syncm *sm, const struct _syncm_entry *entry)
 {
-	struct _syncm_entry *entry = sm->list;
-
-	if (entry == NULL)
+	struct _syncm_entry *array = array_reserve(sm->arena, sm->entry, sm->count, &sm->capacity, sizeof(struct _syncm_entry));
+	if (array == NULL) {
+		sii_error("Error, out of memory\n");
 		return;
-
-	while (entry->next != NULL)
-		entry = entry->next;
-
-	if (entry->prev != NULL)
-		entry->prev->next = NULL;
-	else
-		sm->list = NULL;
-
-	free(entry);
-}
-
-void syncm_entry_add(struct _sii_syncm *sm, struct _syncm_entry *entry)
-{
-	if (sm->list == NULL) { /* first element */
-		entry->id = 0;
-		sm->list = entry;
-		sm->count++;
-	} else {
-		struct _syncm_entry *list = sm->list;
-		while (list->next != NULL)
-			list = list->next;
-
-		list->next = entry;
-		entry->id = list->id+1;
-		entry->prev = list;
-		entry->next = NULL;
-		sm->count++;
 	}
+	sm->entry = array;
+
+	sm->entry[sm->count] = *entry;
+	sm->entry[sm->count].id = sm->count;
+	sm->count++;
 }
 
 static void syncm_add_entry(struct _sii_syncm *sm,
 		int phys_address, int length, int control, int status, int enable, int type)
 {
-	struct _syncm_entry *entry = calloc(1, sizeof(struct _syncm_entry));
-	entry->id = -1;
-	entry->phys_address = phys_address;
-	entry->length = length;
-	entry->control = control;
-	entry->status = status;
-	entry->enable = enable;
-	entry->type = type;
-
-	// FIXME substitude with syncm_entry_add()
-	if (sm->list == NULL) { /* first element */
-		entry->id = 0;
-		sm->list = entry;
-		sm->count++;
-	} else {
-		struct _syncm_entry *list = sm->list;
-		while (list->next != NULL)
-			list = list->next;
+	struct _syncm_entry entry = {
+		.phys_address = phys_address,
+		.length = length,
+		.control = control,
+		.status = status,
+		.enable = enable,
+		.type = type,
+	};
 
-		list->next = entry;
-		entry->id = list->id+1;
-		entry->prev = list;
-		entry->next = NULL;
-		sm->count++;
-	}
+	syncm_entry_add(sm, &entry);
 }
 
-static struct _sii_syncm *parse_syncm_section(const unsigned char *buffer, size_t secsize)
+static void parse_syncm_section(struct _sii_syncm *sm, const unsigned char *buffer, size_t secsize)
 {
 	size_t count=0;
 	int smnbr = 0;
 	const unsigned char *b = buffer;
 
-	struct _sii_syncm *sm = calloc(1, sizeof(struct _sii_syncm));
-
-	while (count<secsize) {
+	while (count + 8 <= secsize) {
 		int physadr = BYTES_TO_WORD(*b, *(b+1));
 		b+=2;
 		int length =  BYTES_TO_WORD(*b, *(b+1));
@@ -471,85 +453,43 @@ static struct _sii_syncm *parse_syncm_section(const unsigned char *buffer, size_
 		count=(size_t)(b-buffer);
 		smnbr++;
 	}
-
-	return sm;
 }
 
-static void pdo_rm_entry(struct _sii_pdo *pdo)
+void pdo_entry_add(struct _sii_pdo *pdo, const struct _pdo_entry *entry)
 {
-	struct _pdo_entry *pe = pdo->list;
-
-	if (pe == NULL)
+	struct _pdo_entry *array = array_reserve(pdo->arena, pdo->entry, pdo->count, &pdo->capacity, sizeof(struct _pdo_entry));
+	if (array == NULL) {
+		sii_error("Error, out of memory\n");
 		return;
-
-	while (pe->next != NULL)
-		pe = pe->next;
-
-	if (pe->prev != NULL)
-		pe->prev->next = NULL;
-
-	if (pe->id == 0)
-		pdo->list = NULL;
-
-	free(pe);
-}
-
-void pdo_entry_add(struct _sii_pdo *pdo, struct _pdo_entry *entry)
-{
-	if (pdo->list == NULL) {
-		entry->id = 0;
-		entry->next = NULL;
-		entry->prev = NULL;
-		pdo->list = entry;
-	} else {
-		struct _pdo_entry *list = pdo->list;
-		while (list->next != NULL)
-			list = list->next;
-
-		list->next = entry;
-		entry->id = list->id+1;
-		entry->prev = list;
-		entry->next = NULL;
 	}
+	pdo->entry = array;
+
+	pdo->entry[pdo->count] = *entry;
+	pdo->entry[pdo->count].id = pdo->count;
+	pdo->count++;
 }
 
 static void pdo_add_entry(struct _sii_pdo *pdo,
 		int index, int subindex, int string_index, int data_type,
 		int bit_length, int flags)
 {
-	struct _pdo_entry *entry = calloc(1, sizeof(struct _pdo_entry));
-
-	entry->id = -1;
-	entry->index = index;
-	entry->subindex = subindex;
-	entry->string_index = string_index;
-	entry->data_type = data_type;
-	entry->bit_length = bit_length;
-	entry->flags = flags;
-
-	/* FIXME make use of pdo_entry_add() */
-	if (pdo->list == NULL) {
-		entry->id = 0;
-		pdo->list = entry;
-	} else {
-		struct _pdo_entry *list = pdo->list;
-		while (list->next != NULL)
-			list = list->next;
+	struct _pdo_entry entry = {
+		.index = index,
+		.subindex = subindex,
+		.string_index = string_index,
+		.data_type = data_type,
+		.bit_length = bit_length,
+		.flags = flags,
+	};
 
-		list->next = entry;
-		entry->id = list->id+1;
-		entry->prev = list;
-		entry->next = NULL;
-	}
+	pdo_entry_add(pdo, &entry);
 }
 
-static struct _sii_pdo *parse_pdo_section(const unsigned char *buffer, size_t secsize, enum ePdoType t)
+static void parse_pdo_section(struct _sii_pdo *pdo, const unsigned char *buffer, size_t secsize, enum ePdoType t)
 {
 	const unsigned char *b = buffer;
 	int entry = 0;
 
-	struct _sii_pdo *pdo = calloc(1, sizeof(struct _sii_pdo));
-
 	switch (t) {
 	case RxPDO:
 		pdo->type = SII_RX_PDO;
@@ -575,7 +515,7 @@ static struct _sii_pdo *parse_pdo_section(const unsigned char *buffer, size_t se
 	pdo->flags = BYTES_TO_WORD(*b, *(b+1));
 	b+=2;
 
-	while ((unsigned int)(b-buffer)<secsize) {
+	while ((size_t)(b-buffer) + 8 <= secsize) {
 		int index = BYTES_TO_WORD(*b, *(b+1));
 		b+=2;
 		int subindex =  *b;
@@ -593,28 +533,13 @@ static struct _sii_pdo *parse_pdo_section(const unsigned char *buffer, size_t se
 
 		entry++;
 	}
-
-	return pdo;
-}
-
-static enum eSection get_next_section(const unsigned char *b, size_t *secsize)
-{
-	enum eSection next = SII_CAT_NOP;
-
-	next = BYTES_TO_WORD(*b, *(b+1)) & 0xffff; /* attention, on some section bit 7 is vendor specific indicator */
-	unsigned wordsize = BYTES_TO_WORD(*(b+2), *(b+3));
-	*secsize = (wordsize<<1); /* bytesize = 2*wordsize */
-
-	return next;
 }
 
 
-static struct _sii_dclock *parse_dclock_section(const unsigned char *buffer, size_t size)
+static void parse_dclock_section(struct _sii_dclock *dc, const unsigned char *buffer, size_t size)
 {
 	const unsigned char *b = buffer;
 
-	struct _sii_dclock *dc = calloc(1, sizeof(struct _sii_dclock));
-
 	dc->cycleTime0 = BYTES_TO_DWORD(*b, *(b+1), *(b+2), *(b+3));
 	b+=4;
 	dc->shiftTime0 = BYTES_TO_DWORD(*b, *(b+1), *(b+2), *(b+3));
@@ -634,9 +559,7 @@ static struct _sii_dclock *parse_dclock_section(const unsigned char *buffer, siz
 
 	size_t count = b-buffer;
 	if (size != count)
-		printf("%s: Warning counter differs from size\n", __func__);
-
-	return dc;
+		sii_warning("%s: Warning counter differs from size\n", __func__);
 }
 
 #if 0 // FIXME this could become usefull in the future.
@@ -653,256 +576,128 @@ static void print_offsets(const unsigned char *start, const unsigned char *curre
 }
 #endif
 
-static int parse_content(struct _sii *sii, const unsigned char *eeprom, size_t maxsize)
-{
-	enum eSection section = SII_PREAMBLE;
-	const size_t max_bytes_size = 2 * maxsize;
-	size_t secsize = 0;
-	const unsigned char *buffer = eeprom;
-
-	struct _sii_cat *newcat;
-
-	while (max_bytes_size > (size_t)(buffer - eeprom)) {
-		switch (section) {
-		case SII_PREAMBLE:
-			sii->preamble = parse_preamble(buffer, 16);
-			buffer = eeprom+16;
-			section = SII_STD_CONFIG;
-			break;
-
-		case SII_STD_CONFIG:
-			sii->config = parse_stdconfig(buffer, 46+66);
-			buffer = buffer+46+66;
-			section = get_next_section(buffer, &secsize);
-			buffer += 4;
-			break;
-
-		case SII_CAT_STRINGS:
-			newcat = cat_new((uint16_t)(section&0xffff), (uint16_t)(secsize&0xffff));
-			newcat->data = (void *)parse_string_section(buffer, secsize);
-			cat_add(sii, newcat);
-#if DEBUG == 1
-			printf("DEBUG Added string section\n");
-#endif
-
-			buffer+=secsize;
-			section = get_next_section(buffer, &secsize);
-			buffer+=4;
-			break;
-
-		case SII_CAT_DATATYPES:
-			parse_datatype_section(buffer, secsize);
-			buffer+=secsize;
-			section = get_next_section(buffer, &secsize);
-			buffer+=4;
-			break;
-
-		case SII_CAT_GENERAL:
-			newcat = cat_new((uint16_t)(section&0xffff), (uint16_t)(secsize&0xffff));
-			newcat->data = (void *)parse_general_section(buffer, secsize);
-			cat_add(sii, newcat);
-#if DEBUG == 1
-			printf("DEBUG Added general section\n");
-#endif
-
-			buffer+=secsize;
-			section = get_next_section(buffer, &secsize);
-			buffer+=4;
-			break;
-
-		case SII_CAT_FMMU:
-			newcat = cat_new((uint16_t)(section&0xffff), (uint16_t)(secsize&0xffff));
-			newcat->data = (void *)parse_fmmu_section(buffer, secsize);
-			cat_add(sii, newcat);
-#if DEBUG == 1
-			printf("DEBUG Added fmmu section\n");
-#endif
-
-			buffer+=secsize;
-			section = get_next_section(buffer, &secsize);
-			buffer+=4;
-			break;
-
-		case SII_CAT_SYNCM:
-			newcat = cat_new((uint16_t)(section&0xffff), (uint16_t)(secsize&0xffff));
-			newcat->data = (void *)parse_syncm_section(buffer, secsize);
-			cat_add(sii, newcat);
-#if DEBUG == 1
-			printf("DEBUG Added syncm section\n");
-#endif
-
-			buffer+=secsize;
-			section = get_next_section(buffer, &secsize);
-			buffer+=4;
-			break;
-
-		case SII_CAT_TXPDO:
-			newcat = cat_new((uint16_t)(section&0xffff), (uint16_t)(secsize&0xffff));
-			newcat->data = (void *)parse_pdo_section(buffer, secsize, TxPDO);
-			cat_add(sii, newcat);
-#if DEBUG == 1
-			printf("DEBUG Added txpdo section\n");
-#endif
-
-			buffer+=secsize;
-			section = get_next_section(buffer, &secsize);
-			buffer+=4;
-			break;
-
-		case SII_CAT_RXPDO:
-			newcat = cat_new((uint16_t)(section&0xffff), (uint16_t)(secsize&0xffff));
-			newcat->data = (void *)parse_pdo_section(buffer, secsize, RxPDO);
-			cat_add(sii, newcat);
-#if DEBUG == 1
-			printf("DEBUG Added rxpdo section\n");
-#endif
-
-			buffer+=secsize;
-			section = get_next_section(buffer, &secsize);
-			buffer+=4;
-			break;
-
-		case SII_CAT_DCLOCK:
-			newcat = cat_new((uint16_t)(section&0xffff), (uint16_t)(secsize&0xffff));
-			newcat->data = (void *)parse_dclock_section(buffer, secsize);
-			cat_add(sii, newcat);
-#if DEBUG == 1
-			printf("DEBUG Added dclock section\n");
-#endif
-
-			buffer+=secsize;
-			section = get_next_section(buffer, &secsize);
-			buffer+=4;
-			break;
-
-		case SII_END:
-			goto finish;
-			break;
-
-		case SII_CAT_NOP:
-		default:
-			fprintf(stderr, "[WARNING] Category 0x%.4x unknown, skipping ....\n", section);
-			buffer+=secsize;
-			section = get_next_section(buffer, &secsize);
-			buffer+=4;
-			break;
-		}
-	}
-
-	fprintf(stderr, "Error, SII probably malformed. No 0xffff at the end found\n");
-	return 1;
-
-finish:
-
-	return 0;
-}
-
-/*** categroy list handling ***/
-
-static void cat_data_cleanup_fmmu(struct _sii_fmmu *fmmu)
-{
-	while (fmmu->list != NULL)
-		fmmu_rm_entry(fmmu);
-
-	free(fmmu);
-}
-
-static void cat_data_cleanup_syncm(struct _sii_syncm *syncm)
-{
-	while (syncm->list != NULL)
-		syncm_rm_entry(syncm);
-	free(syncm);
-}
+/* The general, pdo and dc parsers read their fixed part unchecked, a
+ * shorter category is decoded from a zero padded copy. */
+#define SII_VIEW_DECODE_PAD  32
 
-static void cat_data_cleanup_pdo(struct _sii_pdo *pdo)
+static size_t cat_min_size(uint16_t type)
 {
-	while (pdo->list != NULL)
-		pdo_rm_entry(pdo);
-
-	free(pdo);
+	switch (type) {
+	case SII_CAT_GENERAL:
+		return 32;
+	case SII_CAT_TXPDO:
+	case SII_CAT_RXPDO:
+		return 8;
+	case SII_CAT_DCLOCK:
+		return 24;
+	default:
+		return 0;
+	}
 }
 
-static void cat_data_cleanup_strings(struct _sii_strings *str)
+struct _sii_cat *sii_view_decode(SiiInfo *sii, const struct _sii_view_cat *vc)
 {
-	if (str == NULL)
-		return;
+	const unsigned char *buffer = vc->data;
+	unsigned char pad[SII_VIEW_DECODE_PAD];
 
-	struct _string *current = str->head;
-	struct _string *tmp;
-
-	for (struct _string *s = current; s; ) {
-		free(s->data);
-		if (s->next)
-			s->next->prev = NULL;
+	if (vc->size < cat_min_size(vc->type)) {
+		memset(pad, 0, sizeof(pad));
+		memcpy(pad, vc->data, vc->size);
+		buffer = pad;
+	}
 
-		tmp = s;
-		s = s->next;
-		free(tmp);
+	if (vc->vendor) {
+		sii_warning("[WARNING] Category 0x%.4x unknown, skipping ....\n", vc->type | 0x8000);
+		return NULL;
 	}
 
-	free(str);
-}
+	if (vc->type == SII_CAT_DATATYPES) {
+		parse_datatype_section(buffer, vc->size);
+		return NULL;
+	}
 
-static void cat_data_cleanup(struct _sii_cat *cat)
-{
-	/* clean up type specific data */
-	switch (cat->type) {
+	switch (vc->type) {
 	case SII_CAT_STRINGS:
-		cat_data_cleanup_strings((struct _sii_strings *)cat->data);
+	case SII_CAT_GENERAL:
+	case SII_CAT_FMMU:
+	case SII_CAT_SYNCM:
+	case SII_CAT_TXPDO:
+	case SII_CAT_RXPDO:
+	case SII_CAT_DCLOCK:
 		break;
+	default:
+		sii_warning("[WARNING] Category 0x%.4x unknown, skipping ....\n", vc->type);
+		return NULL;
+	}
 
-	case SII_CAT_DATATYPES:
-		fprintf(stderr, "The Datatype categroie isn't implemented.\n");
-		break;
+	struct _sii_cat *cat = cat_new(sii, vc->type, (uint16_t)vc->size, vc->offset);
 
+	switch (vc->type) {
+	case SII_CAT_STRINGS:
+		parse_string_section(cat->data, buffer, vc->size);
+		break;
 	case SII_CAT_GENERAL:
-		free(cat->data); /* section general is simple */
+		parse_general_section(cat->data, buffer, vc->size);
 		break;
-
 	case SII_CAT_FMMU:
-		cat_data_cleanup_fmmu((struct _sii_fmmu *)cat->data);
+		parse_fmmu_section(cat->data, buffer, vc->size);
 		break;
-
 	case SII_CAT_SYNCM:
-		cat_data_cleanup_syncm((struct _sii_syncm *)cat->data);
+		parse_syncm_section(cat->data, buffer, vc->size);
 		break;
-
 	case SII_CAT_TXPDO:
+		parse_pdo_section(cat->data, buffer, vc->size, TxPDO);
+		break;
 	case SII_CAT_RXPDO:
-		cat_data_cleanup_pdo((struct _sii_pdo *)cat->data);
+		parse_pdo_section(cat->data, buffer, vc->size, RxPDO);
 		break;
-
 	case SII_CAT_DCLOCK:
-		free(cat->data); /* section dc is simple */
-		break;
-
-	default:
-		printf("Warning: cleanup received unknown category\n");
+		parse_dclock_section(cat->data, buffer, vc->size);
 		break;
 	}
+
+	return cat;
 }
 
-#if 0
-static struct _sii_cat *cat_new_data(uint16_t type, uint16_t size, void *data)
+static int parse_content(struct _sii *sii, const unsigned char *eeprom, size_t size)
 {
-	struct _sii_cat *new = calloc(1, sizeof(struct _sii_cat));
+	SiiView view;
+	struct _sii_view_cat vc = { .offset = 0 };
 
-	new->type   = type&0x7fff;
-	new->vendor = (type>>16)&0x1;
-	new->size   = size;
-	new->data   = data;
+	if (sii_view_init(&view, eeprom, size) != 0) {
+		sii_error("Error, SII too short (%zu bytes)\n", size);
+		return -1;
+	}
 
-	return new;
+	sii->preamble = parse_preamble(sii, eeprom, 16);
+	sii->config = parse_stdconfig(sii, eeprom+16, 46+66);
+
+	int ret;
+	while ((ret = sii_view_next(&view, &vc)) > 0) {
+		struct _sii_cat *newcat = sii_view_decode(sii, &vc);
+		if (newcat != NULL)
+			cat_add(sii, newcat);
+	}
+
+	if (ret < 0) {
+		sii_error("Error, SII probably malformed. No 0xffff at the end found\n");
+		return 1;
+	}
+
+	return 0;
 }
-#endif
 
-static struct _sii_cat *cat_new(uint16_t type, uint16_t size)
+/*** categroy list handling ***/
+
+/* offset of the category header in the parsed image */
+static struct _sii_cat *cat_new(SiiInfo *sii, uint16_t type, uint16_t size, size_t offset)
 {
-	struct _sii_cat *new = calloc(1, sizeof(struct _sii_cat));
+	struct _sii_cat *new = sii_category_new(sii, type&0x7fff);
 
-	new->type   = type&0x7fff;
 	new->vendor = (type>>16)&0x1;
 	new->size   = size;
+	new->offset = offset;
+	new->words  = size/2;
 
 	return new;
 }
@@ -928,33 +723,6 @@ static int cat_add(SiiInfo *sii, struct _sii_cat *new)
 	return 0;
 }
 
-/* removes the last category element */
-static int cat_rm(SiiInfo *sii)
-{
-	struct _sii_cat *curr = sii->cat_head;
-
-	if (curr == NULL)
-		return 1;
-
-	while (curr->next != NULL)
-		curr = curr->next;
-
-	if (curr->prev != NULL) {
-		curr->prev->next = NULL;
-		curr->prev = NULL;
-	}
-
-	cat_data_cleanup(curr);
-	curr->data = NULL;
-	curr->type = 0;
-	if (curr == sii->cat_head)
-		sii->cat_head = NULL;
-
-	free(curr);
-
-	return 0;
-}
-
 static struct _sii_cat * cat_next(SiiInfo *sii)
 {
 	sii->cat_current = sii->cat_current->next;
@@ -1013,59 +781,61 @@ static const char *cat_name(enum eSection type)
 	return cat_string[string_index];
 }
 
-static void cat_print(struct _sii_cat *cat)
+static void cat_print(FILE *f, struct _sii_cat *cat)
 {
 	/* preamble and std config should printed here */
-	printf("Print Categorie: %s (0x%x)\n", cat_name(cat->type), cat->type);
+	fprintf(f, "Print Categorie: %s (0x%x)\n", cat_name(cat->type), cat->type);
 	switch (cat->type) {
 	case SII_CAT_STRINGS:
-		cat_print_strings(cat);
+		cat_print_strings(f, cat);
 		break;
 	case SII_CAT_DATATYPES:
-		cat_print_datatypes(cat);
+		cat_print_datatypes(f, cat);
 		break;
 	case SII_CAT_GENERAL:
-		cat_print_general(cat);
+		cat_print_general(f, cat);
 		break;
 	case SII_CAT_FMMU:
-		cat_print_fmmu(cat);
+		cat_print_fmmu(f, cat);
 		break;
 	case SII_CAT_SYNCM:
-		cat_print_syncm(cat);
+		cat_print_syncm(f, cat);
 		break;
 	case SII_CAT_TXPDO:
-		cat_print_txpdo(cat);
+		cat_print_txpdo(f, cat);
 		break;
 	case SII_CAT_RXPDO:
-		cat_print_rxpdo(cat);
+		cat_print_rxpdo(f, cat);
 		break;
 	case SII_CAT_DCLOCK:
-		cat_print_dc(cat);
+		cat_print_dc(f, cat);
 		break;
 	default:
-		printf("Warning no valid categorie\n");
+		fprintf(f, "Warning no valid categorie\n");
 		break;
 	}
 }
 
-static void cat_print_strings(struct _sii_cat *cat)
+static void cat_print_strings(FILE *f, struct _sii_cat *cat)
 {
 	struct _sii_strings *str = (struct _sii_strings *)cat->data;
 	if (str == NULL)
 		return;
 
-	printf("  Size: %d Bytes with %d strings\n", cat->size, str->count);
+	fprintf(f, "  Size: %d Bytes with %d strings\n", cat->size, str->count);
 
-	printf("  ID   Size (Bytes)    String\n");
-	for (struct _string *s = str->head; s; s = s->next)
-		printf("  %3d: (%3d) ......... '%s'\n", s->id, s->length, s->data);
-	printf("\n");
+	fprintf(f, "  ID   Size (Bytes)    String\n");
+	for (int i = 0; i < str->count; i++) {
+		const struct _string *s = &str->string[i];
+		fprintf(f, "  %3d: (%3d) ......... '%s'\n", s->id, s->length, string_data(str, s));
+	}
+	fprintf(f, "\n");
 }
 
-static void cat_print_datatypes(struct _sii_cat *cat)
+static void cat_print_datatypes(FILE *f, struct _sii_cat *cat)
 {
-	printf("Size: %d Bytes\n", cat->size);
-	printf(".... tba\n");
+	fprintf(f, "Size: %d Bytes\n", cat->size);
+	fprintf(f, ".... tba\n");
 }
 
 static struct _sii_cat *sii_category_find_neighbor(struct _sii_cat *cat, enum eSection sec)
@@ -1077,7 +847,7 @@ static struct _sii_cat *sii_category_find_neighbor(struct _sii_cat *cat, enum eS
 		sc = sc->prev;
 
 	/* search */
-	while (sc->next != NULL) {
+	while (sc != NULL) {
 		if (sc->type == sec)
 			return sc;
 
@@ -1087,169 +857,171 @@ static struct _sii_cat *sii_category_find_neighbor(struct _sii_cat *cat, enum eS
 	return NULL;
 }
 
-static void cat_print_general(struct _sii_cat *cat)
+/* strings of the image of cat, NULL if a damaged image has none */
+static struct _sii_strings *cat_strings(struct _sii_cat *cat)
+{
+	struct _sii_cat *sc = sii_category_find_neighbor(cat, SII_CAT_STRINGS);
+
+	return (sc != NULL) ? (struct _sii_strings *)sc->data : NULL;
+}
+
+static void cat_print_general(FILE *f, struct _sii_cat *cat)
 {
-	printf("  Size: %d Bytes\n", cat->size);
+	fprintf(f, "  Size: %d Bytes\n", cat->size);
 	struct _sii_general *gen = (struct _sii_general *)cat->data;
 
-	//printf("General:\n");
-	struct _sii_cat *sc = sii_category_find_neighbor(cat, SII_CAT_STRINGS);
+	//fprintf(f, "General:\n");
+	struct _sii_strings *strings = cat_strings(cat);
 	const char *tmpstr = NULL;
 
-	printf("  Vendor Specific (Index of String)\n");
+	fprintf(f, "  Vendor Specific (Index of String)\n");
 
-	tmpstr = string_search_id((struct _sii_strings *)(sc->data), gen->nameindex);
+	tmpstr = string_search_id(strings, gen->nameindex);
 	if (NULL == tmpstr)
 		tmpstr = "not set";
-	printf("    Name  Index: %d: ............. %s\n", gen->nameindex,  tmpstr);
+	fprintf(f, "    Name  Index: %d: ............. %s\n", gen->nameindex,  tmpstr);
 
-	tmpstr = string_search_id((struct _sii_strings *)(sc->data), gen->groupindex);
+	tmpstr = string_search_id(strings, gen->groupindex);
 	if (NULL == tmpstr)
 		tmpstr = "not set";
-	printf("    Group Index: %d: ............. %s\n", gen->groupindex, tmpstr);
+	fprintf(f, "    Group Index: %d: ............. %s\n", gen->groupindex, tmpstr);
 
-	tmpstr = string_search_id((struct _sii_strings *)(sc->data), gen->imageindex);
+	tmpstr = string_search_id(strings, gen->imageindex);
 	if (NULL == tmpstr)
 		tmpstr = "not set";
-	printf("    Image Index: %d: ............. %s\n", gen->imageindex, tmpstr);
+	fprintf(f, "    Image Index: %d: ............. %s\n", gen->imageindex, tmpstr);
 
-	tmpstr = string_search_id((struct _sii_strings *)(sc->data), gen->orderindex);
+	tmpstr = string_search_id(strings, gen->orderindex);
 	if (NULL == tmpstr)
 		tmpstr = "not set";
-	printf("    Order Index: %d: ............. %s\n", gen->orderindex, tmpstr);
+	fprintf(f, "    Order Index: %d: ............. %s\n", gen->orderindex, tmpstr);
 	tmpstr = NULL;
-	printf("\n");
+	fprintf(f, "\n");
 
-	printf("  CoE Details:\n");
-	printf("    Enable SDO: .................. %s\n", gen->coe_enable_sdo == 0          ? "no" : "yes");
-	printf("    Enable SDO Info: ............. %s\n", gen->coe_enable_sdo_info == 0     ? "no" : "yes");
-	printf("    Enable PDO Assign: ........... %s\n", gen->coe_enable_pdo_assign == 0   ? "no" : "yes");
-	printf("    Enable PDO Configuration: .... %s\n", gen->coe_enable_pdo_conf == 0     ? "no" : "yes");
-	printf("    Enable Upload at Startup: .... %s\n", gen->coe_enable_upload_start == 0 ? "no" : "yes");
-	printf("    Enable SDO complete access: .. %s\n", gen->coe_enable_sdo_complete == 0 ? "no" : "yes");
+	fprintf(f, "  CoE Details:\n");
+	fprintf(f, "    Enable SDO: .................. %s\n", gen->coe_enable_sdo == 0          ? "no" : "yes");
+	fprintf(f, "    Enable SDO Info: ............. %s\n", gen->coe_enable_sdo_info == 0     ? "no" : "yes");
+	fprintf(f, "    Enable PDO Assign: ........... %s\n", gen->coe_enable_pdo_assign == 0   ? "no" : "yes");
+	fprintf(f, "    Enable PDO Configuration: .... %s\n", gen->coe_enable_pdo_conf == 0     ? "no" : "yes");
+	fprintf(f, "    Enable Upload at Startup: .... %s\n", gen->coe_enable_upload_start == 0 ? "no" : "yes");
+	fprintf(f, "    Enable SDO complete access: .. %s\n", gen->coe_enable_sdo_complete == 0 ? "no" : "yes");
 
-	printf("  FoE Details: ................... %s\n", gen->foe_enabled == 0 ? "not enabled" : "enabled");
-	printf("  EoE Details: ................... %s\n", gen->eoe_enabled == 0 ? "not enabled" : "enabled");
+	fprintf(f, "  FoE Details: ................... %s\n", gen->foe_enabled == 0 ? "not enabled" : "enabled");
+	fprintf(f, "  EoE Details: ................... %s\n", gen->eoe_enabled == 0 ? "not enabled" : "enabled");
 
-	printf("\n");
-	printf("  Flag SafeOp: ................... %s\n", gen->flag_safe_op == 0 ? "not enabled" : "enabled");
-	printf("  Flag notLRW: ................... %s\n", gen->flag_notLRW == 0 ? "not enabled" : "enabled");
-	printf("  Flag MBox Data Link Layer ...... %s\n", gen->flag_MBoxDataLinkLayer == 0 ? "not enabled" : "enabled");
-	printf("  Flag Ident AL Status ........... %s\n", gen->flag_IdentALSts == 0 ? "not enabled" : "enabled");
-	printf("  Flag Ident Physical Memory ..... %s\n", gen->flag_IdentPhyM == 0  ? "not enabled" : "enabled");
-	printf("\n");
+	fprintf(f, "\n");
+	fprintf(f, "  Flag SafeOp: ................... %s\n", gen->flag_safe_op == 0 ? "not enabled" : "enabled");
+	fprintf(f, "  Flag notLRW: ................... %s\n", gen->flag_notLRW == 0 ? "not enabled" : "enabled");
+	fprintf(f, "  Flag MBox Data Link Layer ...... %s\n", gen->flag_MBoxDataLinkLayer == 0 ? "not enabled" : "enabled");
+	fprintf(f, "  Flag Ident AL Status ........... %s\n", gen->flag_IdentALSts == 0 ? "not enabled" : "enabled");
+	fprintf(f, "  Flag Ident Physical Memory ..... %s\n", gen->flag_IdentPhyM == 0  ? "not enabled" : "enabled");
+	fprintf(f, "\n");
 
-	printf("  CurrentOnEBus: ................. %d mA\n", gen->current_ebus);
+	fprintf(f, "  CurrentOnEBus: ................. %d mA\n", gen->current_ebus);
 
-	printf("  Physical Ports:\n");
-	printf("     Port 0: ..................... %s\n", physport_type(gen->phys_port_0));
-	printf("     Port 1: ..................... %s\n", physport_type(gen->phys_port_1));
-	printf("     Port 2: ..................... %s\n", physport_type(gen->phys_port_2));
-	printf("     Port 3: ..................... %s\n", physport_type(gen->phys_port_3));
-	printf("\n");
-	printf("  Physical Memory Address ........ 0x%.4x\n", gen->physical_address);
-	printf("\n");
+	fprintf(f, "  Physical Ports:\n");
+	fprintf(f, "     Port 0: ..................... %s\n", physport_type(gen->phys_port_0));
+	fprintf(f, "     Port 1: ..................... %s\n", physport_type(gen->phys_port_1));
+	fprintf(f, "     Port 2: ..................... %s\n", physport_type(gen->phys_port_2));
+	fprintf(f, "     Port 3: ..................... %s\n", physport_type(gen->phys_port_3));
+	fprintf(f, "\n");
+	fprintf(f, "  Physical Memory Address ........ 0x%.4x\n", gen->physical_address);
+	fprintf(f, "\n");
 }
 
-static void cat_print_fmmu(struct _sii_cat *cat)
+static void cat_print_fmmu(FILE *f, struct _sii_cat *cat)
 {
-	printf("  Size: %d Bytes\n", cat->size);
+	fprintf(f, "  Size: %d Bytes\n", cat->size);
 
 	struct _sii_fmmu *fmmus = cat->data;
-	printf("  Number of FMMUs: %d\n", fmmus->count);
+	fprintf(f, "  Number of FMMUs: %d\n", fmmus->count);
 
-	struct _fmmu_entry *fmmu = fmmus->list;
+	for (int i = 0; i < fmmus->count; i++) {
+		const struct _fmmu_entry *fmmu = &fmmus->entry[i];
 
-	while (fmmu != NULL) {
-		printf("    FMMU%d: ", fmmu->id);
+		fprintf(f, "    FMMU%d: ", fmmu->id);
 		switch (fmmu->usage) {
 		case 0x00:
 		case 0xff:
-			printf("not used\n");
+			fprintf(f, "not used\n");
 			break;
 		case FMMU_OUTPUTS:
-			printf("used for Outputs\n");
+			fprintf(f, "used for Outputs\n");
 			break;
 		case FMMU_INPUTS:
-			printf("used for Inputs\n");
+			fprintf(f, "used for Inputs\n");
 			break;
 		case FMMU_SYNCMSTAT:
-			printf("used for SyncM mailbox status (MBoxStat)\n");
+			fprintf(f, "used for SyncM mailbox status (MBoxStat)\n");
 			break;
 		default:
-			printf("WARNING: undefined behavior\n");
+			fprintf(f, "WARNING: undefined behavior\n");
 			break;
 		}
-
-		fmmu = fmmu->next;
 	}
 
-	printf("\n");
+	fprintf(f, "\n");
 }
 
-static void cat_print_syncm_entries(struct _syncm_entry *sme)
+static void cat_print_syncm_entries(FILE *f, const struct _syncm_entry *sme, int count)
 {
-	struct _syncm_entry *e = sme;
-	int smnbr = 0;
+	for (int smnbr = 0; smnbr < count; smnbr++) {
+		const struct _syncm_entry *e = &sme[smnbr];
 
-	while (e != NULL) {
-		printf("  SyncManager SM%d\n", smnbr);
-		printf("    Physical Startaddress: ... 0x%04x\n", e->phys_address);
-		printf("    Length: .................. %d\n", e->length);
-		printf("    Control Register: ........ 0x%02x\n", e->control);
-		printf("    Status Register: ......... 0x%02x\n", e->status);
-		printf("    Enable byte: ............. 0x%02x\n", e->enable);
-		printf("    SM Type: ................. ");
+		fprintf(f, "  SyncManager SM%d\n", smnbr);
+		fprintf(f, "    Physical Startaddress: ... 0x%04x\n", e->phys_address);
+		fprintf(f, "    Length: .................. %d\n", e->length);
+		fprintf(f, "    Control Register: ........ 0x%02x\n", e->control);
+		fprintf(f, "    Status Register: ......... 0x%02x\n", e->status);
+		fprintf(f, "    Enable byte: ............. 0x%02x\n", e->enable);
+		fprintf(f, "    SM Type: ................. ");
 		switch (e->type) {
 		case SMT_UNUSED:
-			printf("not used or unknown\n");
+			fprintf(f, "not used or unknown\n");
 			break;
 		case SMT_MBOXOUT:
-			printf("Mailbox Out\n");
+			fprintf(f, "Mailbox Out\n");
 			break;
 		case SMT_MBOXIN:
-			printf("Mailbox In\n");
+			fprintf(f, "Mailbox In\n");
 			break;
 		case SMT_OUTPUTS:
-			printf("Process Data Out\n");
+			fprintf(f, "Process Data Out\n");
 			break;
 		case SMT_INPUTS:
-			printf("Process Data In\n");
+			fprintf(f, "Process Data In\n");
 			break;
 		default:
-			printf("undefined\n");
+			fprintf(f, "undefined\n");
 			break;
 		}
-
-		smnbr++;
-		e = e->next;
 	}
 }
 
-static void cat_print_syncm(struct _sii_cat *cat)
+static void cat_print_syncm(FILE *f, struct _sii_cat *cat)
 {
 	struct _sii_syncm *sm = (struct _sii_syncm *)cat->data;
 
-	printf("  Size: %d Bytes\n", cat->size);
-	printf("  Number of SyncManager: %d\n", sm->count);
+	fprintf(f, "  Size: %d Bytes\n", cat->size);
+	fprintf(f, "  Number of SyncManager: %d\n", sm->count);
 
-	cat_print_syncm_entries(sm->list);
-	printf("\n");
+	cat_print_syncm_entries(f, sm->entry, sm->count);
+	fprintf(f, "\n");
 }
 
-static void cat_print_rxpdo(struct _sii_cat *cat)
+static void cat_print_rxpdo(FILE *f, struct _sii_cat *cat)
 {
-	cat_print_pdo(cat);
+	cat_print_pdo(f, cat);
 }
 
-static void cat_print_txpdo(struct _sii_cat *cat)
+static void cat_print_txpdo(FILE *f, struct _sii_cat *cat)
 {
-	cat_print_pdo(cat);
+	cat_print_pdo(f, cat);
 }
 
-static void cat_print_pdo(struct _sii_cat *cat)
+static void cat_print_pdo(FILE *f, struct _sii_cat *cat)
 {
-	printf("  Size: %d Bytes\n", cat->size);
+	fprintf(f, "  Size: %d Bytes\n", cat->size);
 
 	struct _sii_pdo *pdo = (struct _sii_pdo *)cat->data;
 
@@ -1284,61 +1056,60 @@ static void cat_print_pdo(struct _sii_cat *cat)
 		pdostr = "undefined";
 		break;
 	}
-	printf("  %s:\n", pdostr);
-	printf("    PDO Index: .................. 0x%04x\n", pdo->index);
-	printf("    Entries: .................... %d\n", pdo->entries);
-	printf("    SyncM: ...................... %d\n", pdo->syncmanager);
-	printf("    Synchronization: ............ 0x%02x\n", pdo->dcsync);
-	printf("    Name Index: ................. %d\n", pdo->name_index);
-	printf("    Flags ....................... 0x%04x\n", pdo->flags);
+	fprintf(f, "  %s:\n", pdostr);
+	fprintf(f, "    PDO Index: .................. 0x%04x\n", pdo->index);
+	fprintf(f, "    Entries: .................... %d\n", pdo->entries);
+	fprintf(f, "    SyncM: ...................... %d\n", pdo->syncmanager);
+	fprintf(f, "    Synchronization: ............ 0x%02x\n", pdo->dcsync);
+	fprintf(f, "    Name Index: ................. %d\n", pdo->name_index);
+	fprintf(f, "    Flags ....................... 0x%04x\n", pdo->flags);
 	for (int i=0; i<16; i++) {
 		if (pdo->flags&(1<<i))
-			printf("                                  %s\n", pdo_flags_description[i]);
+			fprintf(f, "                                  %s\n", pdo_flags_description[i]);
 	}
 
-	struct _pdo_entry *list = pdo->list;
-	struct _sii_cat *sc = sii_category_find_neighbor(cat, SII_CAT_STRINGS);
+	struct _sii_strings *strings = cat_strings(cat);
 	const char *tmpstr = NULL;
 
-	while (list != NULL) {
-		tmpstr = string_search_id((struct _sii_strings *)(sc->data), list->string_index);
+	for (int i = 0; i < pdo->count; i++) {
+		const struct _pdo_entry *list = &pdo->entry[i];
+
+		tmpstr = string_search_id(strings, list->string_index);
 		if (NULL == tmpstr)
 			tmpstr = "not set";
 
-		printf("\n");
-		printf("      Entry %d:\n", list->id);
-		printf("      Entry Index: .............. 0x%04x\n", list->index);
-		printf("      Subindex: ................. 0x%02x\n", list->subindex);
-		printf("      String Index: ............. %d (%s)\n", list->string_index, tmpstr);
-		printf("      Data Type: ................ 0x%02x (Index in CoE Object Dictionary)\n", list->data_type);
-		printf("      Bitlength: ................ %d\n", list->bit_length);
-
-		list = list->next;
+		fprintf(f, "\n");
+		fprintf(f, "      Entry %d:\n", list->id);
+		fprintf(f, "      Entry Index: .............. 0x%04x\n", list->index);
+		fprintf(f, "      Subindex: ................. 0x%02x\n", list->subindex);
+		fprintf(f, "      String Index: ............. %d (%s)\n", list->string_index, tmpstr);
+		fprintf(f, "      Data Type: ................ 0x%02x (Index in CoE Object Dictionary)\n", list->data_type);
+		fprintf(f, "      Bitlength: ................ %d\n", list->bit_length);
 	}
 
-	printf("\n");
+	fprintf(f, "\n");
 }
 
 
-static void cat_print_dc(struct _sii_cat *cat)
+static void cat_print_dc(FILE *f, struct _sii_cat *cat)
 {
-	printf("Size: %d Bytes\n", cat->size);
+	fprintf(f, "Size: %d Bytes\n", cat->size);
 
 	struct _sii_dclock *dc = (struct _sii_dclock *)cat->data;
-	struct _sii_cat *sc = sii_category_find_neighbor(cat, SII_CAT_STRINGS);
-	const char *name = string_search_id((struct _sii_strings *)sc->data, dc->nameIdx);
-	const char *desc = string_search_id((struct _sii_strings *)sc->data, dc->descIdx);
+	struct _sii_strings *strings = cat_strings(cat);
+	const char *name = string_search_id(strings, dc->nameIdx);
+	const char *desc = string_search_id(strings, dc->descIdx);
 
-	printf("  Cycle Time 0 .................. %d\n", dc->cycleTime0);
-	printf("  Shift Time 0 .................. %d\n", dc->shiftTime0);
-	printf("  Shift Time 1 .................. %d\n", dc->shiftTime1);
-	printf("  Sync1 Cycle Factor ............ %d\n", dc->sync1CycleFactor);
-	printf("  Assign Activate ............... %d\n", dc->assignActivate);
-	printf("  Sync0 Cylce Factor ............ %d\n", dc->sync0CycleFactor);
-	printf("  Name Index .................... %d (%s)\n", dc->nameIdx, name);
-	printf("  Description Index ............. %d (%s)\n", dc->descIdx, desc);
+	fprintf(f, "  Cycle Time 0 .................. %d\n", dc->cycleTime0);
+	fprintf(f, "  Shift Time 0 .................. %d\n", dc->shiftTime0);
+	fprintf(f, "  Shift Time 1 .................. %d\n", dc->shiftTime1);
+	fprintf(f, "  Sync1 Cycle Factor ............ %d\n", dc->sync1CycleFactor);
+	fprintf(f, "  Assign Activate ............... %d\n", dc->assignActivate);
+	fprintf(f, "  Sync0 Cylce Factor ............ %d\n", dc->sync0CycleFactor);
+	fprintf(f, "  Name Index .................... %d (%s)\n", dc->nameIdx, name);
+	fprintf(f, "  Description Index ............. %d (%s)\n", dc->descIdx, desc);
 
-	printf("\n");
+	fprintf(f, "\n");
 }
 
 /* write sii binary data */
@@ -1352,12 +1123,13 @@ static uint16_t sii_cat_write_strings(struct _sii_cat *cat, unsigned char *buf)
 	if (strings == NULL)
 		return 0;
 
-	for (struct _string *s = strings->head; s; s = s->next) {
-		char *str = s->data;
-		*b = s->length;
+	for (int i = 0; i < strings->count; i++) {
+		const char *str = string_data(strings, &strings->string[i]);
+		size_t len = strlen(str);
+		*b = strings->string[i].length;
 		b++;
-		memmove(b, str, strlen(str));
-		b+= strlen(str);
+		memcpy(b, str, len);
+		b+= len;
 	}
 	*strc = strings->count;
 
@@ -1367,7 +1139,7 @@ static uint16_t sii_cat_write_strings(struct _sii_cat *cat, unsigned char *buf)
 static uint16_t sii_cat_write_datatypes(struct _sii_cat *cat, unsigned char *buf)
 {
 	unsigned char *b = buf;
-	printf("TODO: binary write of datatypes section (0x%x)\n", cat->type);
+	sii_warning("TODO: binary write of datatypes section (0x%x)\n", cat->type);
 	return (uint16_t)(b-buf);
 }
 
@@ -1426,12 +1198,8 @@ static uint16_t sii_cat_write_fmmu(struct _sii_cat *cat, unsigned char *buf)
 {
 	unsigned char *b = buf;
 	struct _sii_fmmu *data = cat->data;
-	struct _fmmu_entry *entry = data->list;
-
-	while (entry != NULL) {
-		*b++ = entry->usage;
-		entry = entry->next;
-	}
+	for (int i = 0; i < data->count; i++)
+		*b++ = data->entry[i].usage;
 
     /* add padding if odd number of FMMU is defined */
     if (data->count % 2 != 0) {
@@ -1445,9 +1213,9 @@ static uint16_t sii_cat_write_syncm(struct _sii_cat *cat, unsigned char *buf)
 {
 	unsigned char *b = buf;
 	struct _sii_syncm *sm = cat->data;
-	struct _syncm_entry *entry = sm->list;
+	for (int i = 0; i < sm->count; i++) {
+		const struct _syncm_entry *entry = &sm->entry[i];
 
-	while (entry != NULL) {
 		*b++ = entry->phys_address&0xff;
 		*b++ = (entry->phys_address>>8)&0xff;
 		*b++ = entry->length&0xff;
@@ -1456,8 +1224,6 @@ static uint16_t sii_cat_write_syncm(struct _sii_cat *cat, unsigned char *buf)
 		*b++ = entry->status;
 		*b++ = entry->enable;
 		*b++ = entry->type;
-
-		entry = entry->next;
 	}
 
 	return (uint16_t)(b-buf);
@@ -1477,9 +1243,9 @@ static uint16_t sii_cat_write_pdo(struct _sii_cat *cat, unsigned char *buf)
 	*b++ = pdo->flags&0xff;
 	*b++ = (pdo->flags>>8)&0xff;
 
-	struct _pdo_entry *entry = pdo->list;
+	for (int i = 0; i < pdo->count; i++) {
+		const struct _pdo_entry *entry = &pdo->entry[i];
 
-	while (entry != NULL) {
 		*b++ = entry->index&0xff;
 		*b++ = (entry->index>>8)&0xff;
 		*b++ = entry->subindex;
@@ -1488,8 +1254,6 @@ static uint16_t sii_cat_write_pdo(struct _sii_cat *cat, unsigned char *buf)
 		*b++ = entry->bit_length;
 		*b++ = entry->flags&0xff;
 		*b++ = (entry->flags>>8)&0xff;
-
-		entry = entry->next;
 	}
 
 	return (uint16_t)(b-buf);
@@ -1552,12 +1316,12 @@ static size_t cat_size(struct _sii_cat *cat)
 	switch (cat->type) {
 	case SII_CAT_STRINGS:
 		//number of strings bytes for each string...
-		fprintf(stderr, "Error, category 0x%.x not implemented\n", cat->type);
+		sii_error("Error, category 0x%.x not implemented\n", cat->type);
 		break;
 
 	case SII_CAT_DATATYPES:
 		// unimplemented
-		fprintf(stderr, "Error, category 0x%.x not implemented\n", cat->type);
+		sii_error("Error, category 0x%.x not implemented\n", cat->type);
 		break;
 
 	case SII_CAT_GENERAL:
@@ -1582,7 +1346,7 @@ static size_t cat_size(struct _sii_cat *cat)
 		break;
 
 	default:
-		fprintf(stderr, "Error, unknown category 0x%.x\n", cat->type);
+		sii_error("Error, unknown category 0x%.x\n", cat->type);
 		return 0;
 	}
 
@@ -1610,36 +1374,158 @@ static uint16_t sii_cat_write_cat(struct _sii_cat *cat, unsigned char *buf)
 }
 #endif
 
-static size_t sii_cat_write(struct _sii *sii, uint16_t skipmask)
+/* number of bytes the sii_cat_write_*() function of cat writes */
+static size_t sii_cat_data_size(const struct _sii_cat *cat)
+{
+	size_t size = 0;
+
+	switch (cat->type) {
+	case SII_CAT_STRINGS: {
+		const struct _sii_strings *strings = cat->data;
+		if (strings == NULL)
+			return 0;
+
+		size = 1;
+		for (int i = 0; i < strings->count; i++)
+			size += 1 + strlen(string_data(strings, &strings->string[i]));
+		break;
+	}
+
+	case SII_CAT_GENERAL:
+		size = 32;
+		break;
+
+	case SII_CAT_FMMU:
+		size = ((const struct _sii_fmmu *)cat->data)->count;
+		size += size % 2;
+		break;
+
+	case SII_CAT_SYNCM:
+		size = 8 * ((const struct _sii_syncm *)cat->data)->count;
+		break;
+
+	case SII_CAT_TXPDO:
+	case SII_CAT_RXPDO:
+		size = 8 + 8 * ((const struct _sii_pdo *)cat->data)->count;
+		break;
+
+	case SII_CAT_DCLOCK:
+		size = 24;
+		break;
+
+	case SII_CAT_DATATYPES: /* not implemented */
+	default:
+		break;
+	}
+
+	return size;
+}
+
+static int sii_cat_skipped(const struct _sii_cat *cat, uint16_t skipmask)
+{
+	if (cat->type == SII_CAT_TXPDO || cat->type == SII_CAT_RXPDO)
+		return (skipmask & (SKIP_TXPDO | SKIP_RXPDO)) != 0;
+
+	if (cat->type == SII_CAT_DCLOCK)
+		return (skipmask & SKIP_DC) != 0;
+
+	return 0;
+}
+
+/* layout pass: assign each category which is written its offset and word
+ * size in the image, nothing is written */
+static int sii_layout_categories(SiiInfo *sii, uint16_t skipmask, struct _sii_layout *layout)
+{
+	size_t offset = SII_CAT_OFFSET;
+
+	memset(layout, 0, sizeof(struct _sii_layout));
+
+	for (struct _sii_cat *cat = sii->cat_head; cat; cat = cat->next) {
+		cat->offset = 0;
+		cat->words = 0;
+
+		if (sii_cat_skipped(cat, skipmask))
+			continue;
+
+		size_t catsize = sii_cat_data_size(cat);
+		if (catsize == 0) /* skipped */
+			continue;
+
+		catsize += catsize % 2; /* pad to be word alligned */
+		if (catsize / 2 > 0xffff) {
+			if (layout->oversized == 0)
+				layout->oversized = cat->type;
+			catsize = 0x1fffe; /* counted with the maximum size */
+		}
+
+		cat->offset = offset;
+		cat->words = (uint16_t)(catsize / 2);
+		offset += 4 + catsize;
+		layout->categories++;
+	}
+
+	layout->size = offset + 2; /* end marker */
+	layout->eeprom_size = EE_TO_BYTES((size_t)sii->config->eeprom_size);
+
+	if (layout->oversized != 0 || layout->size > layout->eeprom_size)
+		return -1;
+
+	return 0;
+}
+
+/* serialize pass: write the categories into the slots of the layout pass,
+ * returns the number of bytes written */
+static size_t sii_cat_write(struct _sii *sii, unsigned char *image, uint16_t skipmask)
 {
-	unsigned char *buf = sii->rawbytes+sii->rawsize;
-	//size_t *bufsize = &sii->rawsize;
-	struct _sii_cat *cat = sii->cat_head;
 	size_t written = 0;
-	uint16_t catsize = 0;
 
 	// for each category:
 	// buf[0], buf[1] <- type
 	// buf[2], buf[3] <- size
 	// buf[N>3] category data
 
-	while (cat != NULL) {
-		unsigned char *ct = buf;
-		unsigned char *cs = buf+2;
-		buf += 4;
+	for (struct _sii_cat *cat = sii->cat_head; cat; cat = cat->next) {
+		if (sii_cat_skipped(cat, skipmask))
+			continue;
+
+		if (cat->words == 0) {
+			switch (cat->type) {
+			case SII_CAT_STRINGS:
+			case SII_CAT_GENERAL:
+			case SII_CAT_FMMU:
+			case SII_CAT_SYNCM:
+			case SII_CAT_TXPDO:
+			case SII_CAT_RXPDO:
+			case SII_CAT_DCLOCK:
+				break;
+			case SII_CAT_DATATYPES:
+				sii_cat_write_datatypes(cat, image);
+				break;
+			default:
+				sii_warning("Warning Unknown category - skipping!\n");
+				continue;
+			}
+
+			sii_warning("Warning, existing category %s (0x%.x) unexpected empty\n",
+					cat2string(cat->type), cat->type);
+			continue;
+		}
 
-		*ct = cat->type&0xff;
-		*(ct+1) = (cat->type>>8)&0xff;
+		unsigned char *buf = image + cat->offset;
+		size_t slot = (size_t)cat->words * 2;
+		size_t catsize = 0;
+
+		buf[0] = cat->type&0xff;
+		buf[1] = (cat->type>>8)&0xff;
+		buf[2] = cat->words&0xff;
+		buf[3] = (cat->words>>8)&0xff;
+		buf += 4;
 
 		switch (cat->type) {
 		case SII_CAT_STRINGS:
 			catsize = sii_cat_write_strings(cat, buf);
 			break;
 
-		case SII_CAT_DATATYPES:
-			catsize = sii_cat_write_datatypes(cat, buf);
-			break;
-
 		case SII_CAT_GENERAL:
 			catsize = sii_cat_write_general(cat, buf);
 			break;
@@ -1654,74 +1540,63 @@ static size_t sii_cat_write(struct _sii *sii, uint16_t skipmask)
 
 		case SII_CAT_TXPDO:
 		case SII_CAT_RXPDO:
-			if (skipmask & (SKIP_TXPDO | SKIP_RXPDO)) {
-				buf -= 4;
-				cat = (cat->next != NULL) ? cat->next : NULL;
-				continue;
-			} else {
-				catsize = sii_cat_write_pdo(cat, buf);
-			}
+			catsize = sii_cat_write_pdo(cat, buf);
 			break;
 
 		case SII_CAT_DCLOCK:
-			if (skipmask & SKIP_DC) {
-				buf -= 4;
-				cat = (cat->next != NULL) ? cat->next : NULL;
-				continue;
-			} else {
-				catsize = sii_cat_write_dc(cat, buf);
-			}
+			catsize = sii_cat_write_dc(cat, buf);
 			break;
+		}
 
-		default:
-			fprintf(stderr, "Warning Unknown category - skipping!\n");
-			buf -= 4;
-			goto nextcat;
-			break;
+		if (catsize + (catsize % 2) != slot) {
+			sii_error("Error, category %s (0x%.x) doesn't match its layout\n",
+					cat2string(cat->type), cat->type);
+			return 0;
 		}
 
 		// pad to be word alligned
-		if (catsize & 1) {
+		if (catsize & 1)
 			buf[catsize] = 0;
-			catsize++;
-		}
 
 #if DEBUG == 1
-		printf("[DEBUG %s] section type 0x%.4x size: 0x%.4x\n", __func__, cat->type, catsize/2);
+		printf("[DEBUG %s] section type 0x%.4x size: 0x%.4x\n", __func__, cat->type, cat->words);
 #endif
 
-		if (catsize == 0) {
-			fprintf(stderr, "Warning, existing category %s (0x%.x) unexpected empty\n",
-					cat2string(cat->type), cat->type);
-			buf -= 4; /* rewind */
-			goto nextcat;
-		}
-
-		/* hot patch for uneven string category sizes */
-		if ((SII_CAT_STRINGS == cat->type) && (catsize % 2 != 0)) {
-			catsize += 1;
-		}
+		written += slot + 4;
+	}
 
-		written += catsize+4;
-		buf += catsize;
-		catsize = catsize/2; /* byte -> word count */
-		*cs = catsize&0xff;
-		*(cs+1) = (catsize>>8)&0xff;
+	return written;
+}
 
-nextcat:
-		cat = cat->next;
+/* position of the category type in the order, lower comes first */
+static unsigned int sii_cat_rank(const struct _sii_cat *cat, enum eSiiCatOrder order)
+{
+	if (order == SII_ORDER_STARTUP) {
+		/* what the master needs for INIT -> PREOP first, the strings
+		 * are only needed for display */
+		switch (cat->type) {
+		case SII_CAT_GENERAL:  return 1;
+		case SII_CAT_SYNCM:    return 2;
+		case SII_CAT_FMMU:     return 3;
+		case SII_CAT_DCLOCK:   return 4;
+		case SII_CAT_TXPDO:    return 5;
+		case SII_CAT_RXPDO:    return 6;
+		case SII_CAT_STRINGS:  return 7;
+		default:
+			return 8 + cat->type;
+		}
 	}
 
-	return written;
+	return cat->type;
 }
 
-static struct _sii_cat *sii_cat_get_min(struct _sii_cat *head)
+static struct _sii_cat *sii_cat_get_min(struct _sii_cat *head, enum eSiiCatOrder order)
 {
 	struct _sii_cat *h = head;
 	struct _sii_cat *min = head;
 
 	while (h != NULL) {
-		if (min->type > h->type)
+		if (sii_cat_rank(min, order) > sii_cat_rank(h, order))
 			min = h;
 
 		h = h->next;
@@ -1730,10 +1605,8 @@ static struct _sii_cat *sii_cat_get_min(struct _sii_cat *head)
 	return min;
 }
 
-static void sii_write(SiiInfo *sii, unsigned int add_pdo_mapping, unsigned int add_dc_config)
+static uint16_t sii_skip_mask(unsigned int add_pdo_mapping, unsigned int add_dc_config)
 {
-	unsigned char *outbuf = sii->rawbytes;
-	uint8_t crc = 0xff;
 	uint16_t skip_mask = SKIP_DC | SKIP_TXPDO | SKIP_RXPDO;
 	if (add_pdo_mapping) {
 		skip_mask &= ~(SKIP_TXPDO | SKIP_RXPDO);
@@ -1742,64 +1615,58 @@ static void sii_write(SiiInfo *sii, unsigned int add_pdo_mapping, unsigned int a
 		skip_mask &= ~SKIP_DC;
 	}
 
+	return skip_mask;
+}
+
+/* write the image to buf which holds at least layout->size bytes,
+ * returns the number of bytes written, 0 on error */
+static size_t sii_write(SiiInfo *sii, unsigned char *buf, uint16_t skip_mask, const struct _sii_layout *layout)
+{
+	unsigned char *outbuf = buf;
+
 	// - write preamble
 	struct _sii_preamble *pre = sii->preamble;
 	*outbuf = pre->pdi_ctrl&0xff;
-	crc8byte(&crc, *outbuf);
 	outbuf++;
 	*outbuf = (pre->pdi_ctrl>>8)&0xff;
-	crc8byte(&crc, *outbuf);
 	outbuf++;
 	*outbuf = pre->pdi_conf&0xff;
-	crc8byte(&crc, *outbuf);
 	outbuf++;
 	*outbuf = (pre->pdi_conf>>8)&0xff;
-	crc8byte(&crc, *outbuf);
 	outbuf++;
 	*outbuf = pre->sync_impulse&0xff;
-	crc8byte(&crc, *outbuf);
 	outbuf++;
 	*outbuf = (pre->sync_impulse>>8)&0xff;
-	crc8byte(&crc, *outbuf);
 	outbuf++;
 	*outbuf = pre->pdi_conf2&0xff;
-	crc8byte(&crc, *outbuf);
 	outbuf++;
 	*outbuf = (pre->pdi_conf2>>8)&0xff;
-	crc8byte(&crc, *outbuf);
 	outbuf++;
 	*outbuf = pre->alias&0xff;
-	crc8byte(&crc, *outbuf);
 	outbuf++;
 	*outbuf = (pre->alias>>8)&0xff;
-	crc8byte(&crc, *outbuf);
 	outbuf++;
 
 	// reserved[4]; /* shall be zero */
 	*outbuf = 0;
-	crc8byte(&crc, *outbuf);
 	outbuf++;
 	*outbuf = 0;
-	crc8byte(&crc, *outbuf);
 	outbuf++;
 	*outbuf = 0;
-	crc8byte(&crc, *outbuf);
 	outbuf++;
 	*outbuf = 0;
-	crc8byte(&crc, *outbuf);
 	outbuf++;
 
 	*outbuf = pre->checksum&0xff;
-	crc8byte(&crc, *outbuf);
 	outbuf++;
 	*outbuf = (pre->checksum>>8)&0xff;
-	crc8byte(&crc, *outbuf);
 	outbuf++;
 
 	/* checksum should be 0 now */
+	uint8_t crc = crc8_final(crc8_update(crc8_init(), buf, (size_t)(outbuf - buf)));
 	if (crc != 0) {
-		fprintf(stderr, "Error checksum mismatch - abort write operation.\n");
-		return;
+		sii_error("Error checksum mismatch - abort write operation.\n");
+		return 0;
 	}
 
 	// - write standard config
@@ -1899,23 +1766,24 @@ static void sii_write(SiiInfo *sii, unsigned int add_pdo_mapping, unsigned int a
 	*outbuf = (scfg->version>>8)&0xff;
 	outbuf++;
 
-	sii->rawsize = (size_t)(outbuf-sii->rawbytes);
-
 #if DEBUG == 1
-	printf("DEBUG sii_write() wrote %lu bytes for preamble and std config\n", sii->rawsize);
+	printf("DEBUG sii_write() wrote %lu bytes for preamble and std config\n", (size_t)(outbuf-buf));
 #endif
 
 	// - iterate through categories
 
-	size_t sz = sii_cat_write(sii, skip_mask);
-	outbuf += sz;
-	sii->rawsize += sz;
+	size_t written = sii_cat_write(sii, buf, skip_mask);
+	if (written + SII_CAT_OFFSET + 2 != layout->size)
+		return 0;
 
 	/* add end indicator */
+	outbuf = buf + layout->size - 2;
 	*outbuf = 0xff;
 	outbuf++;
 	*outbuf = 0xff;
-	sii->rawsize += 2;
+	outbuf++;
+
+	return (size_t)(outbuf-buf);
 }
 
 
@@ -1923,22 +1791,63 @@ static void sii_write(SiiInfo *sii, unsigned int add_pdo_mapping, unsigned int a
 /* API functions */
 /*****************/
 
+void sii_use_arena(Arena *arena)
+{
+	g_thread_arena = arena;
+}
+
+void *sii_alloc(SiiInfo *sii, size_t size)
+{
+	void *ptr = arena_alloc(sii->arena, size);
+	if (ptr == NULL) {
+		sii_error("Error, out of memory\n");
+		abort();
+	}
+
+	return ptr;
+}
+
 SiiInfo *sii_init(void)
 {
-	SiiInfo *sii = calloc(1, sizeof(SiiInfo));
+	Arena *arena = g_thread_arena;
+	int owned = 0;
+
+	if (arena == NULL) {
+		arena = arena_new();
+		if (arena == NULL)
+			return NULL;
+		owned = 1;
+	}
+
+	SiiInfo *sii = arena_alloc(arena, sizeof(SiiInfo));
+	if (sii == NULL) {
+		if (owned)
+			arena_free(arena);
+		return NULL;
+	}
+
+	sii->arena = arena;
+	sii->arena_owned = owned;
+
 	return sii;
 }
 
 SiiInfo *sii_init_string(const unsigned char *eeprom, size_t size)
 {
 	if (eeprom == NULL) {
-		fprintf(stderr, "No eeprom provided\n");
+		sii_error("No eeprom provided\n");
 		return NULL;
 	}
 
-	SiiInfo *sii = calloc(1, sizeof(SiiInfo));
+	SiiInfo *sii = sii_init();
+	if (sii == NULL)
+		return NULL;
 
-	parse_content(sii, eeprom, size);
+	/* a missing end marker still leaves the categories up to it */
+	if (parse_content(sii, eeprom, size) < 0) {
+		sii_release(sii);
+		return NULL;
+	}
 
 	return sii;
 }
@@ -1946,236 +1855,1291 @@ SiiInfo *sii_init_string(const unsigned char *eeprom, size_t size)
 SiiInfo *sii_init_file(const char *filename)
 {
 	if (filename == NULL) {
-		fprintf(stderr, "Error no filename provided\n");
+		sii_error("Error no filename provided\n");
 		return NULL;
 	}
 
-	SiiInfo *sii = calloc(1, sizeof(SiiInfo));
-	unsigned char eeprom[1024];
-
-	read_eeprom(stdin, eeprom, 1024);
-	parse_content(sii, eeprom, 1024);
+	FILE *f = fopen(filename, "rb");
+	if (f == NULL) {
+		sii_error("Error open '%s': %s\n", filename, strerror(errno));
+		return NULL;
+	}
 
-	return sii;
-}
+	struct stat st;
+	size_t capacity = SII_CAT_OFFSET;
+	if (fstat(fileno(f), &st) == 0 && (size_t)st.st_size > capacity)
+		capacity = (size_t)st.st_size;
 
+	unsigned char *eeprom = malloc(capacity);
+	if (eeprom == NULL) {
+		fclose(f);
+		return NULL;
+	}
 
-void sii_release(SiiInfo *sii)
-{
-	while (cat_rm(sii) != 1)
-		;
+	int size = read_eeprom(f, eeprom, capacity);
+	fclose(f);
 
-	if (sii->rawbytes != NULL)
-		free(sii->rawbytes);
+	SiiInfo *sii = NULL;
+	if (size >= 0)
+		sii = sii_init_string(eeprom, (size_t)size);
 
-	if (sii->outfile != NULL)
-		free(sii->outfile);
+	free(eeprom);
 
-	if (sii->preamble != NULL)
-		free(sii->preamble);
+	return sii;
+}
 
-	if (sii->config != NULL)
-		free(sii->config);
 
-	free(sii);
+void sii_release(SiiInfo *sii)
+{
+	/* a shared arena is reset by its owner */
+	if (sii != NULL && sii->arena_owned)
+		arena_free(sii->arena);
 }
 
 size_t sii_generate(SiiInfo *sii, unsigned int add_pdo_mapping, unsigned int add_dc_config)
 {
-	size_t maxsize = EE_TO_BYTES(sii->config->eeprom_size);
-	sii->rawbytes = (uint8_t*) calloc(1, maxsize);
-	sii->rawsize = 0;
+	size_t maxsize = EE_TO_BYTES((size_t)sii->config->eeprom_size);
 
-	sii_write(sii, add_pdo_mapping, add_dc_config);
+	if (sii->rawcapacity < maxsize) {
+		sii->rawbytes = sii_alloc(sii, maxsize);
+		sii->rawcapacity = maxsize;
+	} else {
+		memset(sii->rawbytes, 0, sii->rawcapacity); /* generated before */
+	}
+
+	sii->rawsize = sii_generate_into(sii, add_pdo_mapping, add_dc_config, sii->rawbytes, sii->rawcapacity);
 	sii->rawvalid = 1; /* FIXME valid should be set in sii_write */
 
 	return sii->rawsize;
 }
 
-void sii_print(SiiInfo *sii)
+size_t sii_generate_into(SiiInfo *sii, unsigned int add_pdo_mapping, unsigned int add_dc_config,
+		uint8_t *buf, size_t size)
 {
-	printf("First print preamble and config\n");
-	struct _sii_preamble *preamble = sii->preamble;
+	uint16_t skip_mask = sii_skip_mask(add_pdo_mapping, add_dc_config);
+	struct _sii_layout layout;
 
-	if (preamble != NULL) {
-		/* preamble */
-		printf("Preamble:\n");
-		printf("PDI Control: ................ 0x%.4x\n", preamble->pdi_ctrl);
-		printf("PDI Config: ................. 0x%.4x\n", preamble->pdi_conf);
-		printf("Sync Impulse Length: ........ %d ns (raw: 0x%.4x)\n", preamble->sync_impulse*10, preamble->sync_impulse);
-		printf("PDI Config 2: ............... 0x%.4x\n", preamble->pdi_conf2);
-		printf("Configured Station Alias: ... 0x%.4x\n", preamble->alias);
-		printf("Checksum of Preamble: ....... 0x%.4x (%s)\n", preamble->checksum, (preamble->checksum_ok ? "ok" : "wrong"));
+	if (sii_layout_categories(sii, skip_mask, &layout) != 0) {
+		if (layout.oversized != 0)
+			sii_error("Error, category %s exceeds 0xffff words\n", cat2string(layout.oversized));
+		else
+			sii_error("Error, SII image of %zu bytes exceeds the EEPROM size of %zu bytes\n",
+					layout.size, layout.eeprom_size);
+		return 0;
 	}
 
-	struct _sii_stdconfig *stdc = sii->config;
+	if (buf == NULL || size < layout.size)
+		return layout.size;
 
-	if (stdc != NULL) {
-		/* general information */
-		printf("Identity:\n");
-		printf("  Vendor ID: ................ 0x%08x\n", stdc->vendor_id);
-		printf("  Product ID: ............... 0x%08x\n", stdc->product_id);
-		printf("  Revision ID: .............. 0x%08x\n", stdc->revision_id);
-		printf("  Serial Number: ............ 0x%08x\n", stdc->serial);
+	return sii_write(sii, buf, skip_mask, &layout);
+}
 
-		/* mailbox settings */
-		printf("\nDefault mailbox settings:\n");
-		printf("  Bootstrap Mailbox:\n");
-		printf("  Received Mailbox Offset: .. 0x%04x\n", stdc->bs_rec_mbox_offset);
-		printf("  Received Mailbox Size: .... %d\n", stdc->bs_rec_mbox_size);
-		printf("  Send Mailbox Offset: ...... 0x%04x\n", stdc->bs_snd_mbox_offset);
-		printf("  Send Mailbox Size: ........ %d\n", stdc->bs_snd_mbox_size);
-
-		printf("  Mailbox Settings:\n");
-		printf("  Received Mailbox Offset: .. 0x%04x\n", stdc->std_rec_mbox_offset);
-		printf("  Received Mailbox Size: .... %d\n", stdc->std_rec_mbox_size);
-		printf("  Send Mailbox Offset: ...... 0x%04x\n", stdc->std_snd_mbox_offset);
-		printf("  Send Mailbox Size: ........ %d\n", stdc->std_snd_mbox_size);
-
-		printf("\nSupported Mailboxes:\n");
-		printf("  CoE ....................... %s\n", (stdc->mailbox_protocol.word&MBOX_COE) ? "True" : "False");
-		printf("  EoE ....................... %s\n", (stdc->mailbox_protocol.word&MBOX_EOE) ? "True" : "False");
-		printf("  FoE ....................... %s\n", (stdc->mailbox_protocol.word&MBOX_FOE) ? "True" : "False");
-		printf("  SoE ....................... %s\n", (stdc->mailbox_protocol.word&MBOX_SOE) ? "True" : "False");
-		printf("  VoE ....................... %s\n", (stdc->mailbox_protocol.word&MBOX_VOE) ? "True" : "False");
-		printf("\n");
+int sii_layout(SiiInfo *sii, unsigned int add_pdo_mapping, unsigned int add_dc_config,
+		struct _sii_layout *layout)
+{
+	return sii_layout_categories(sii, sii_skip_mask(add_pdo_mapping, add_dc_config), layout);
+}
 
-		printf("EEPROM size: ................ %d bytes\n", EE_TO_BYTES(stdc->eeprom_size));
-		printf("Version: .................... %d\n", stdc->version);
-		printf("\n");
-	}
+/* string index references of the categories, mark collects the strings
+ * referenced by written categories, otherwise the indexes are remapped */
+struct _string_remap {
+	int count;
+	int *map;   /* new index per old index, 0: dropped */
+	int mark;
+	uint16_t skipmask;
+};
 
-	/* now print the categories */
-	cat_rewind(sii);
-	struct _sii_cat *cats = sii->cat_current;
+static void string_ref(struct _string_remap *r, uint8_t *index, int written)
+{
+	if (*index == 0 || *index > r->count)
+		return;
 
-	while (cats != NULL) {
-		cat_print(cats);
-		cats = cat_next(sii);
+	if (r->mark) {
+		if (written)
+			r->map[*index] = 1;
+	} else {
+		*index = (uint8_t)r->map[*index];
 	}
 }
 
-int sii_check(SiiInfo *sii)
+static void strings_visit(SiiInfo *sii, struct _string_remap *r)
 {
-	fprintf(stderr, "Not yet implemented\n");
-	return sii->rawvalid;
-}
+	for (struct _sii_cat *cat = sii->cat_head; cat; cat = cat->next) {
+		int written = !sii_cat_skipped(cat, r->skipmask);
 
-int sii_write_bin(SiiInfo *sii, const char *outfile)
-{
-	if (!sii->rawvalid) {
-		fprintf(stderr, "Error, raw string is invalid\n");
-		return -1;
-	}
+		switch (cat->type) {
+		case SII_CAT_GENERAL: {
+			struct _sii_general *general = cat->data;
+			string_ref(r, &general->groupindex, written);
+			string_ref(r, &general->imageindex, written);
+			string_ref(r, &general->orderindex, written);
+			string_ref(r, &general->nameindex, written);
+			break;
+		}
 
-	FILE *fh;
+		case SII_CAT_TXPDO:
+		case SII_CAT_RXPDO: {
+			struct _sii_pdo *pdo = cat->data;
+			string_ref(r, &pdo->name_index, written);
+			for (int i = 0; i < pdo->count; i++)
+				string_ref(r, &pdo->entry[i].string_index, written);
+			break;
+		}
 
-	if (outfile == NULL)
-		fh = stdout;
-	else {
-		// FIXME Currently existing files are silently overwritten, should ask to perform the action!
-		struct stat fs;
-		if (!stat(outfile, &fs)) {
-			fprintf(stderr, "Warning, existing file %s is overwritten\n", outfile);
+		case SII_CAT_DCLOCK: {
+			struct _sii_dclock *dc = cat->data;
+			string_ref(r, &dc->nameIdx, written);
+			string_ref(r, &dc->descIdx, written);
+			break;
 		}
 
-		fh = fopen(outfile, "w");
-		if (fh == NULL) {
-			fprintf(stderr, "Error open file '%s' for writing\n", outfile);
-			return -2;
+		default:
+			break;
 		}
 	}
+}
 
-	for (size_t i=0; i<sii->rawsize; i++)
-		fputc(sii->rawbytes[i], fh);
+/* remove the strings which no written category references */
+static void strings_compact(SiiInfo *sii, uint16_t skipmask)
+{
+	struct _sii_cat *cat = sii->cat_head;
+	while (cat != NULL && cat->type != SII_CAT_STRINGS)
+		cat = cat->next;
 
-	fclose(fh);
+	if (cat == NULL || cat->data == NULL)
+		return;
 
-	return 0;
-}
+	struct _sii_strings *old = cat->data;
+	struct _string_remap r = {
+		.count = old->count,
+		.map = sii_alloc(sii, (size_t)(old->count + 1) * sizeof(int)),
+		.mark = 1,
+		.skipmask = skipmask,
+	};
 
+	strings_visit(sii, &r);
 
-int sii_add_info(SiiInfo *sii, struct _sii_preamble *pre, struct _sii_stdconfig *cfg)
-{
-	if (sii->preamble != NULL) {
-		fprintf(stderr, "Warning, sii->preamble not empty.\n");
-		return -1;
-	}
+	struct _sii_strings *new = sii_alloc(sii, sizeof(struct _sii_strings));
+	new->arena = old->arena;
 
-	if (sii->config != NULL) {
-		fprintf(stderr, "Warning, sii->config not empty.\n");
-		return -1;
+	for (int i = 1; i <= old->count; i++) {
+		if (r.map[i] == 0)
+			continue;
+
+		const struct _string *s = &old->string[i-1];
+		int id = strings_entry_add(new, string_data(old, s), s->length);
+		r.map[i] = (id > 0) ? id : 0;
 	}
 
-	sii->preamble = pre;
-	sii->config = cfg;
+	r.mark = 0;
+	strings_visit(sii, &r);
 
-	return 0;
+	cat->data = new;
 }
 
-int sii_category_add(SiiInfo *sii, struct _sii_cat *cat)
+static int drop_pdo_entry_names(SiiInfo *sii)
 {
-	return cat_add(sii, cat);
+	int dropped = 0;
+
+	for (struct _sii_cat *cat = sii->cat_head; cat; cat = cat->next) {
+		if (cat->type != SII_CAT_TXPDO && cat->type != SII_CAT_RXPDO)
+			continue;
+
+		struct _sii_pdo *pdo = cat->data;
+		for (int i = 0; i < pdo->count; i++) {
+			dropped |= pdo->entry[i].string_index != 0;
+			pdo->entry[i].string_index = 0;
+		}
+	}
+
+	return dropped;
 }
 
-struct _sii_cat *sii_category_find(SiiInfo *sii, enum eSection category)
+static int drop_dc_names(SiiInfo *sii)
 {
-	for (struct _sii_cat *c = sii->cat_head; c; c = c->next) {
-		if (c->type == category)
-			return c;
+	int dropped = 0;
+
+	for (struct _sii_cat *cat = sii->cat_head; cat; cat = cat->next) {
+		if (cat->type != SII_CAT_DCLOCK)
+			continue;
+
+		struct _sii_dclock *dc = cat->data;
+		dropped |= dc->nameIdx != 0 || dc->descIdx != 0;
+		dc->nameIdx = 0;
+		dc->descIdx = 0;
 	}
 
-	return NULL;
+	return dropped;
 }
 
-int sii_strings_add(SiiInfo *sii, const char *entry)
+/* layout after removing the strings which are no longer referenced */
+static int compact_layout(SiiInfo *sii, unsigned int add_pdo_mapping, unsigned int add_dc_config,
+		struct _sii_layout *layout)
 {
-	struct _sii_cat *strings = sii_category_find(sii, SII_CAT_STRINGS);
+	strings_compact(sii, sii_skip_mask(add_pdo_mapping, add_dc_config));
 
-	if (strings == NULL)
-		return -1;
+	return sii_layout(sii, add_pdo_mapping, add_dc_config, layout);
+}
 
-	if (strings->data == NULL)
+int sii_optimize(SiiInfo *sii, unsigned int *add_pdo_mapping, unsigned int add_dc_config)
+{
+	struct _sii_layout layout;
+	int dropped = 0;
+	int fits;
+
+	if (sii_layout(sii, *add_pdo_mapping, add_dc_config, &layout) == 0)
+		return 0;
+
+	size_t size = layout.size;
+	fits = 0;
+
+	/* least useful content first, stop as soon as the image fits */
+	if (*add_pdo_mapping && drop_pdo_entry_names(sii)) {
+		dropped |= SII_DROP_PDO_ENTRY_NAMES;
+		fits = compact_layout(sii, *add_pdo_mapping, add_dc_config, &layout) == 0;
+	}
+
+	if (!fits && add_dc_config && drop_dc_names(sii)) {
+		dropped |= SII_DROP_DC_NAMES;
+		fits = compact_layout(sii, *add_pdo_mapping, add_dc_config, &layout) == 0;
+	}
+
+	if (!fits && *add_pdo_mapping) {
+		*add_pdo_mapping = 0;
+		dropped |= SII_DROP_PDO_MAPPING;
+		fits = compact_layout(sii, *add_pdo_mapping, add_dc_config, &layout) == 0;
+	}
+
+	if (!fits)
 		return -1;
 
-	return strings_add((struct _sii_strings *)strings->data, entry);
+	sii_warning("Warning, SII of %zu bytes exceeds the EEPROM size of %zu bytes, dropped%s%s%s to %zu bytes\n",
+			size, layout.eeprom_size,
+			(dropped & SII_DROP_PDO_ENTRY_NAMES) ? " PDO entry names" : "",
+			(dropped & SII_DROP_DC_NAMES) ? " DC names" : "",
+			(dropped & SII_DROP_PDO_MAPPING) ? " PDO mapping" : "",
+			layout.size);
+
+	return dropped;
 }
 
-int strings_add(struct _sii_strings *strings, const char *entry)
+int sii_directory(SiiInfo *sii, struct _sii_directory_entry *entry, int max)
 {
-	strings_entry_add(strings, string_new(entry, strlen(entry)));
+	int count = 0;
+
+	for (struct _sii_cat *cat = sii->cat_head; cat; cat = cat->next) {
+		if (cat->offset == 0) /* not written */
+			continue;
+
+		if (count < max) {
+			entry[count].type = cat->type;
+			entry[count].offset = (uint16_t)(cat->offset / 2);
+			entry[count].words = cat->words;
+			entry[count].pdo_index = (cat->type == SII_CAT_TXPDO || cat->type == SII_CAT_RXPDO) ?
+				((struct _sii_pdo *)cat->data)->index : 0;
+		}
+		count++;
+	}
 
-	return strings->count;
+	return count;
 }
 
-const char *string_search_id(struct _sii_strings *strings, int id)
+static void directory_bin(FILE *f, const struct _sii_stdconfig *cfg,
+		const struct _sii_directory_entry *entry, int count)
 {
-	for (struct _string *s = strings->head; s; s = s->next) {
-		if (s->id == id)
-			return s->data;
+	uint8_t head[20] = { 'S', 'I', 'I', 'D', 1, 0 };
+
+	head[6] = count&0xff;
+	head[7] = (count>>8)&0xff;
+	for (int i = 0; i < 4; i++) {
+		head[8+i] = (cfg->vendor_id>>(8*i))&0xff;
+		head[12+i] = (cfg->product_id>>(8*i))&0xff;
+		head[16+i] = (cfg->revision_id>>(8*i))&0xff;
 	}
+	fwrite(head, 1, sizeof(head), f);
 
-	return NULL;
+	for (int i = 0; i < count; i++) {
+		const uint16_t word[4] = { entry[i].type, entry[i].offset, entry[i].words, entry[i].pdo_index };
+		for (int w = 0; w < 4; w++) {
+			fputc(word[w]&0xff, f);
+			fputc((word[w]>>8)&0xff, f);
+		}
+	}
 }
 
-int string_search_string(struct _sii_strings *strings, const char *str)
+static void directory_header(FILE *f, const struct _sii_stdconfig *cfg,
+		const struct _sii_directory_entry *entry, int count)
 {
-	for (struct _string *s = strings->head; s; s = s->next) {
-		if (strncmp(s->data, str, strlen(str)) == 0)
-			return s->id;
-	}
+	char name[64];
 
-	return -1;
+	snprintf(name, sizeof(name), "sii_%08x_%08x", cfg->product_id, cfg->revision_id);
+
+	fprintf(f, "/* SII category directory of vendor 0x%08x, product 0x%08x, revision 0x%08x\n",
+			cfg->vendor_id, cfg->product_id, cfg->revision_id);
+	fprintf(f, " * generated by siitool, offsets and sizes in words, offset is the\n");
+	fprintf(f, " * category header */\n\n");
+	fprintf(f, "#ifndef SII_%08X_%08X_H\n", cfg->product_id, cfg->revision_id);
+	fprintf(f, "#define SII_%08X_%08X_H\n\n", cfg->product_id, cfg->revision_id);
+	fprintf(f, "#include <stdint.h>\n\n");
+	fprintf(f, "static const struct {\n");
+	fprintf(f, "\tuint16_t type;\n\tuint16_t offset;\n\tuint16_t words;\n\tuint16_t pdo_index;\n");
+	fprintf(f, "} %s_directory[%d] = {\n", name, count);
+
+	for (int i = 0; i < count; i++)
+		fprintf(f, "\t{ 0x%04x, 0x%04x, %5u, 0x%04x }, /* %s */\n",
+				entry[i].type, entry[i].offset, entry[i].words, entry[i].pdo_index,
+				cat2string(entry[i].type));
+
+	fprintf(f, "};\n\n#endif\n");
 }
 
-char *cat2string(enum eSection cat)
+int sii_write_directory(SiiInfo *sii, const char *outfile, enum eSiiDirectoryFormat format,
+		unsigned int flags)
 {
-	switch (cat) {
-	case SII_PREAMBLE:
-		return "SII_PREAMBLE";
-	case SII_STD_CONFIG:
-		return "SII_STD_CONFIG";
-	case SII_CAT_STRINGS:
+	char *text = NULL;
+	size_t size = 0;
+
+	int count = sii_directory(sii, NULL, 0);
+	struct _sii_directory_entry *entry = sii_alloc(sii, (size_t)(count + 1) * sizeof(struct _sii_directory_entry));
+	sii_directory(sii, entry, count);
+
+	FILE *f = open_memstream(&text, &size);
+	if (f == NULL) {
+		sii_error("Error, out of memory\n");
+		return -1;
+	}
+
+	if (format == SII_DIRECTORY_HEADER)
+		directory_header(f, sii->config, entry, count);
+	else
+		directory_bin(f, sii->config, entry, count);
+
+	fclose(f);
+
+	int ret = sii_write_file(outfile, (const uint8_t *)text, size, flags);
+	free(text);
+
+	return ret;
+}
+
+/* one line of the size report, returns the reads up to the end of the part */
+static size_t report_part(FILE *f, const struct _sii_read_model *model, enum eSection type,
+		size_t offset, size_t size, size_t reads)
+{
+	size_t end = (offset + size + model->read_size - 1) / model->read_size;
+
+	fprintf(f, "%8zu %6zu %6zu %6zu %9lu  %s\n", offset, size, size/2, end - reads,
+			(unsigned long)end * model->access_us, cat2string(type));
+
+	return end;
+}
+
+void sii_size_report(FILE *f, SiiInfo *sii, const struct _sii_read_model *model)
+{
+	size_t end = SII_CAT_OFFSET;
+	size_t reads = 0;
+
+	fprintf(f, "#  offset  bytes  words  reads    end_us  category\n");
+	reads = report_part(f, model, SII_PREAMBLE, 0, 16, reads);
+	reads = report_part(f, model, SII_STD_CONFIG, 16, SII_CAT_OFFSET - 16, reads);
+
+	for (struct _sii_cat *cat = sii->cat_head; cat; cat = cat->next) {
+		if (cat->offset == 0) /* not written */
+			continue;
+
+		size_t size = 4 + 2 * (size_t)cat->words;
+		reads = report_part(f, model, cat->type, cat->offset, size, reads);
+
+		if (cat->offset + size > end)
+			end = cat->offset + size;
+	}
+
+	reads = report_part(f, model, SII_END, end, 2, reads);
+
+	fprintf(f, "# total bytes=%zu words=%zu reads=%zu time_us=%lu read_size=%zu access_us=%u\n",
+			end + 2, (end + 2) / 2, reads, (unsigned long)reads * model->access_us,
+			model->read_size, model->access_us);
+}
+
+size_t sii_flash_plan(const uint8_t *current, size_t current_size,
+		const uint8_t *image, size_t size,
+		struct _sii_flash_range *range, size_t max)
+{
+	size_t words = (size + 1) / 2;
+	size_t count = 0;
+	size_t start = 0;
+	int changed = 0;
+
+	for (size_t w = 0; w <= words; w++) {
+		int differ = 0;
+
+		if (w < words) {
+			size_t b = 2 * w;
+			/* words behind the end of current are always written */
+			if (b + 1 >= current_size || b + 1 >= size)
+				differ = b + 1 >= current_size || current[b] != image[b];
+			else
+				differ = current[b] != image[b] || current[b+1] != image[b+1];
+		}
+
+		if (differ && !changed) {
+			start = w;
+		} else if (!differ && changed) {
+			if (count < max) {
+				range[count].word = start;
+				range[count].count = w - start;
+			}
+			count++;
+		}
+
+		changed = differ;
+	}
+
+	return count;
+}
+
+int sii_stamp_init(struct _sii_stamp *stamp, const uint8_t *image, size_t size)
+{
+	if (size < SII_CAT_OFFSET)
+		return -1;
+
+	/* the checksum covers the words before it, only alias and the
+	 * reserved words behind it have to be added per image */
+	stamp->crc = crc8_update(crc8_init(), image, SII_ALIAS_OFFSET);
+	stamp->alias = BYTES_TO_WORD(image[SII_ALIAS_OFFSET], image[SII_ALIAS_OFFSET+1]);
+	memcpy(stamp->reserved, image + SII_ALIAS_OFFSET + 2, sizeof(stamp->reserved));
+
+	return 0;
+}
+
+void sii_stamp(const struct _sii_stamp *stamp, uint8_t *image, uint32_t serial, uint16_t alias)
+{
+	uint8_t *s = image + SII_SERIAL_OFFSET;
+	s[0] = serial&0xff;
+	s[1] = (serial>>8)&0xff;
+	s[2] = (serial>>16)&0xff;
+	s[3] = (serial>>24)&0xff;
+
+	image[SII_ALIAS_OFFSET] = alias&0xff;
+	image[SII_ALIAS_OFFSET+1] = (alias>>8)&0xff;
+
+	uint8_t crc = crc8_update(stamp->crc, image + SII_ALIAS_OFFSET, 2);
+	image[SII_CHECKSUM_OFFSET] = crc8_final(crc8_update(crc, stamp->reserved, sizeof(stamp->reserved)));
+}
+
+/* semantic compare, string indexes are resolved to their text so a
+ * reordered string table doesn't count as a difference */
+
+#define SII_MAX_FIELDS  24
+
+struct _sii_field {
+	const char *name;
+	uint32_t value;
+	int is_string; /* value is a string index, compared by text */
+	const char *text;
+};
+
+#define FIELD(n, v)  fields[count++] = (struct _sii_field){ n, (uint32_t)(v), 0, NULL }
+#define STRING_FIELD(n, v)  fields[count++] = (struct _sii_field){ n, (uint32_t)(v), 1, \
+		string_search_id(strings, v) }
+
+static int preamble_fields(const struct _sii_preamble *pa, struct _sii_field *fields)
+{
+	int count = 0;
+
+	FIELD("pdi_ctrl", pa->pdi_ctrl);
+	FIELD("pdi_conf", pa->pdi_conf);
+	FIELD("sync_impulse", pa->sync_impulse);
+	FIELD("pdi_conf2", pa->pdi_conf2);
+	FIELD("alias", pa->alias);
+
+	return count;
+}
+
+static int config_fields(const struct _sii_stdconfig *sc, struct _sii_field *fields)
+{
+	int count = 0;
+
+	FIELD("vendor_id", sc->vendor_id);
+	FIELD("product_id", sc->product_id);
+	FIELD("revision_id", sc->revision_id);
+	FIELD("serial", sc->serial);
+	FIELD("bs_rec_mbox_offset", sc->bs_rec_mbox_offset);
+	FIELD("bs_rec_mbox_size", sc->bs_rec_mbox_size);
+	FIELD("bs_snd_mbox_offset", sc->bs_snd_mbox_offset);
+	FIELD("bs_snd_mbox_size", sc->bs_snd_mbox_size);
+	FIELD("std_rec_mbox_offset", sc->std_rec_mbox_offset);
+	FIELD("std_rec_mbox_size", sc->std_rec_mbox_size);
+	FIELD("std_snd_mbox_offset", sc->std_snd_mbox_offset);
+	FIELD("std_snd_mbox_size", sc->std_snd_mbox_size);
+	FIELD("mailbox_protocol", sc->mailbox_protocol.word);
+	FIELD("eeprom_size", sc->eeprom_size);
+	FIELD("version", sc->version);
+
+	return count;
+}
+
+static int general_fields(const struct _sii_general *gen, struct _sii_strings *strings,
+		struct _sii_field *fields)
+{
+	int count = 0;
+
+	STRING_FIELD("group", gen->groupindex);
+	STRING_FIELD("image", gen->imageindex);
+	STRING_FIELD("order", gen->orderindex);
+	STRING_FIELD("name", gen->nameindex);
+	FIELD("coe_details", gen->coe_enable_sdo | (gen->coe_enable_sdo_info << 1) |
+			(gen->coe_enable_pdo_assign << 2) | (gen->coe_enable_pdo_conf << 3) |
+			(gen->coe_enable_upload_start << 4) | (gen->coe_enable_sdo_complete << 5));
+	FIELD("foe_details", gen->foe_enabled);
+	FIELD("eoe_details", gen->eoe_enabled);
+	FIELD("flags", gen->flag_safe_op | (gen->flag_notLRW << 1) |
+			(gen->flag_MBoxDataLinkLayer << 2) | (gen->flag_IdentALSts << 3) |
+			(gen->flag_IdentPhyM << 4));
+	FIELD("current_ebus", (uint16_t)gen->current_ebus);
+	FIELD("physical_ports", gen->phys_port_0 | (gen->phys_port_1 << 4) |
+			(gen->phys_port_2 << 8) | (gen->phys_port_3 << 12));
+	FIELD("physical_address", gen->physical_address);
+
+	return count;
+}
+
+static int syncm_fields(const struct _syncm_entry *sm, struct _sii_field *fields)
+{
+	int count = 0;
+
+	FIELD("phys_address", sm->phys_address);
+	FIELD("length", sm->length);
+	FIELD("control", sm->control);
+	FIELD("status", sm->status);
+	FIELD("enable", sm->enable);
+	FIELD("type", sm->type);
+
+	return count;
+}
+
+static int pdo_fields(const struct _sii_pdo *pdo, struct _sii_strings *strings,
+		struct _sii_field *fields)
+{
+	int count = 0;
+
+	FIELD("entries", pdo->count);
+	FIELD("syncmanager", pdo->syncmanager);
+	FIELD("dcsync", pdo->dcsync);
+	STRING_FIELD("name", pdo->name_index);
+	FIELD("flags", pdo->flags);
+
+	return count;
+}
+
+static int pdo_entry_fields(const struct _pdo_entry *entry, struct _sii_strings *strings,
+		struct _sii_field *fields)
+{
+	int count = 0;
+
+	FIELD("index", entry->index);
+	FIELD("subindex", entry->subindex);
+	STRING_FIELD("name", entry->string_index);
+	FIELD("data_type", entry->data_type);
+	FIELD("bit_length", entry->bit_length);
+	FIELD("flags", entry->flags);
+
+	return count;
+}
+
+static int dc_fields(const struct _sii_dclock *dc, struct _sii_strings *strings,
+		struct _sii_field *fields)
+{
+	int count = 0;
+
+	FIELD("cycle_time_0", dc->cycleTime0);
+	FIELD("shift_time_0", dc->shiftTime0);
+	FIELD("shift_time_1", dc->shiftTime1);
+	FIELD("sync1_cycle_factor", (uint16_t)dc->sync1CycleFactor);
+	FIELD("assign_activate", dc->assignActivate);
+	FIELD("sync0_cycle_factor", (uint16_t)dc->sync0CycleFactor);
+	STRING_FIELD("name", dc->nameIdx);
+	STRING_FIELD("description", dc->descIdx);
+
+	return count;
+}
+
+#undef FIELD
+#undef STRING_FIELD
+
+/* FNV-1a, 64 bit */
+#define HASH_INIT   0xcbf29ce484222325ULL
+#define HASH_PRIME  0x100000001b3ULL
+
+static uint64_t hash_bytes(uint64_t h, const void *data, size_t size)
+{
+	const unsigned char *b = data;
+
+	for (size_t i = 0; i < size; i++)
+		h = (h ^ b[i]) * HASH_PRIME;
+
+	return h;
+}
+
+static uint64_t hash_fields(uint64_t h, const struct _sii_field *fields, int count)
+{
+	for (int i = 0; i < count; i++) {
+		if (fields[i].is_string) {
+			const char *text = (fields[i].text != NULL) ? fields[i].text : "";
+			h = hash_bytes(h, text, strlen(text) + 1);
+		} else {
+			uint8_t v[4] = {
+				fields[i].value & 0xff, (fields[i].value >> 8) & 0xff,
+				(fields[i].value >> 16) & 0xff, (fields[i].value >> 24) & 0xff
+			};
+			h = hash_bytes(h, v, sizeof(v));
+		}
+	}
+
+	return h;
+}
+
+/* spread the bits before the category hashes are summed up */
+static uint64_t hash_mix(uint64_t h)
+{
+	h ^= h >> 33;
+	h *= 0xff51afd7ed558ccdULL;
+	h ^= h >> 33;
+	h *= 0xc4ceb9fe1a85ec53ULL;
+	h ^= h >> 33;
+
+	return h;
+}
+
+uint64_t sii_cat_hash(struct _sii_cat *cat)
+{
+	struct _sii_field fields[SII_MAX_FIELDS];
+	struct _sii_strings *strings = cat_strings(cat);
+	uint64_t h = HASH_INIT;
+	uint16_t type = cat->type;
+
+	h = hash_bytes(h, &type, sizeof(type));
+
+	switch (cat->type) {
+	case SII_CAT_GENERAL:
+		h = hash_fields(h, fields, general_fields(cat->data, strings, fields));
+		break;
+
+	case SII_CAT_FMMU: {
+		struct _sii_fmmu *fmmu = cat->data;
+		for (int i = 0; i < fmmu->count; i++)
+			h = hash_bytes(h, &fmmu->entry[i].usage, 1);
+		break;
+	}
+
+	case SII_CAT_SYNCM: {
+		struct _sii_syncm *sm = cat->data;
+		for (int i = 0; i < sm->count; i++)
+			h = hash_fields(h, fields, syncm_fields(&sm->entry[i], fields));
+		break;
+	}
+
+	case SII_CAT_TXPDO:
+	case SII_CAT_RXPDO: {
+		struct _sii_pdo *pdo = cat->data;
+		h = hash_bytes(h, &pdo->index, sizeof(pdo->index));
+		h = hash_fields(h, fields, pdo_fields(pdo, strings, fields));
+		for (int i = 0; i < pdo->count; i++)
+			h = hash_fields(h, fields, pdo_entry_fields(&pdo->entry[i], strings, fields));
+		break;
+	}
+
+	case SII_CAT_DCLOCK:
+		h = hash_fields(h, fields, dc_fields(cat->data, strings, fields));
+		break;
+
+	default:
+		/* the strings count through the references into them */
+		break;
+	}
+
+	return h;
+}
+
+uint64_t sii_hash(SiiInfo *sii)
+{
+	struct _sii_field fields[SII_MAX_FIELDS];
+	uint64_t h = HASH_INIT;
+	uint64_t sum = 0;
+
+	if (sii->preamble != NULL)
+		h = hash_fields(h, fields, preamble_fields(sii->preamble, fields));
+	if (sii->config != NULL)
+		h = hash_fields(h, fields, config_fields(sii->config, fields));
+
+	/* independent of the category order */
+	for (struct _sii_cat *cat = sii->cat_head; cat != NULL; cat = cat->next)
+		sum += hash_mix(sii_cat_hash(cat));
+
+	return h ^ hash_mix(sum);
+}
+
+void sii_signature(SiiInfo *sii, struct _sii_signature *sig)
+{
+	memset(sig, 0, sizeof(*sig));
+
+	if (sii->config != NULL) {
+		sig->vendor_id = sii->config->vendor_id;
+		sig->product_id = sii->config->product_id;
+		sig->revision_id = sii->config->revision_id;
+	}
+
+	for (struct _sii_cat *cat = sii->cat_head; cat != NULL; cat = cat->next) {
+		switch (cat->type) {
+		case SII_CAT_GENERAL:
+			sig->general = sii_cat_hash(cat);
+			break;
+		case SII_CAT_FMMU:
+			sig->fmmu = sii_cat_hash(cat);
+			break;
+		case SII_CAT_SYNCM:
+			sig->syncm = sii_cat_hash(cat);
+			break;
+		case SII_CAT_TXPDO:
+		case SII_CAT_RXPDO:
+			sig->pdo += hash_mix(sii_cat_hash(cat));
+			break;
+		case SII_CAT_DCLOCK:
+			sig->dc = sii_cat_hash(cat);
+			break;
+		default:
+			break;
+		}
+	}
+}
+
+static int diff_fields(FILE *f, const char *label, const struct _sii_field *a,
+		const struct _sii_field *b, int count)
+{
+	int diffs = 0;
+
+	for (int i = 0; i < count; i++) {
+		if (a[i].is_string) {
+			const char *ta = (a[i].text != NULL) ? a[i].text : "";
+			const char *tb = (b[i].text != NULL) ? b[i].text : "";
+
+			if (strcmp(ta, tb) == 0)
+				continue;
+
+			fprintf(f, "%s: %s \"%s\" -> \"%s\"\n", label, a[i].name, ta, tb);
+		} else {
+			if (a[i].value == b[i].value)
+				continue;
+
+			fprintf(f, "%s: %s 0x%x -> 0x%x\n", label, a[i].name, a[i].value, b[i].value);
+		}
+
+		diffs++;
+	}
+
+	return diffs;
+}
+
+static int diff_count(FILE *f, const char *label, const char *name, int a, int b)
+{
+	if (a == b)
+		return 0;
+
+	fprintf(f, "%s: %s %d -> %d\n", label, name, a, b);
+	return 1;
+}
+
+static void cat_label(char *label, size_t size, const struct _sii_cat *cat)
+{
+	if (cat->type == SII_CAT_TXPDO || cat->type == SII_CAT_RXPDO)
+		snprintf(label, size, "%s 0x%04x", cat_name(cat->type), ((struct _sii_pdo *)cat->data)->index);
+	else
+		snprintf(label, size, "%s", cat_name(cat->type));
+}
+
+/* the category of other which corresponds to cat: PDOs by type and index,
+ * others by their position among the categories of their type */
+static struct _sii_cat *cat_partner(struct _sii_cat *cat, SiiInfo *other)
+{
+	int nth = 0;
+
+	if (cat->type == SII_CAT_TXPDO || cat->type == SII_CAT_RXPDO) {
+		uint16_t index = ((struct _sii_pdo *)cat->data)->index;
+
+		for (struct _sii_cat *c = other->cat_head; c != NULL; c = c->next) {
+			if (c->type == cat->type && ((struct _sii_pdo *)c->data)->index == index)
+				return c;
+		}
+
+		return NULL;
+	}
+
+	for (struct _sii_cat *c = cat->prev; c != NULL; c = c->prev) {
+		if (c->type == cat->type)
+			nth++;
+	}
+
+	for (struct _sii_cat *c = other->cat_head; c != NULL; c = c->next) {
+		if (c->type == cat->type && nth-- == 0)
+			return c;
+	}
+
+	return NULL;
+}
+
+static int diff_cat(FILE *f, struct _sii_cat *a, struct _sii_cat *b)
+{
+	struct _sii_field fa[SII_MAX_FIELDS], fb[SII_MAX_FIELDS];
+	struct _sii_strings *sa = cat_strings(a);
+	struct _sii_strings *sb = cat_strings(b);
+	char label[64];
+	char entry_label[96];
+	int diffs = 0;
+
+	if (sii_cat_hash(a) == sii_cat_hash(b))
+		return 0;
+
+	cat_label(label, sizeof(label), a);
+
+	switch (a->type) {
+	case SII_CAT_GENERAL:
+		general_fields(b->data, sb, fb);
+		diffs += diff_fields(f, label, fa, fb, general_fields(a->data, sa, fa));
+		break;
+
+	case SII_CAT_FMMU: {
+		struct _sii_fmmu *fmmu_a = a->data, *fmmu_b = b->data;
+		int count = (fmmu_a->count < fmmu_b->count) ? fmmu_a->count : fmmu_b->count;
+
+		diffs += diff_count(f, label, "entries", fmmu_a->count, fmmu_b->count);
+		for (int i = 0; i < count; i++) {
+			if (fmmu_a->entry[i].usage == fmmu_b->entry[i].usage)
+				continue;
+			fprintf(f, "%s %d: usage 0x%x -> 0x%x\n", label, i,
+					fmmu_a->entry[i].usage, fmmu_b->entry[i].usage);
+			diffs++;
+		}
+		break;
+	}
+
+	case SII_CAT_SYNCM: {
+		struct _sii_syncm *sm_a = a->data, *sm_b = b->data;
+		int count = (sm_a->count < sm_b->count) ? sm_a->count : sm_b->count;
+
+		diffs += diff_count(f, label, "entries", sm_a->count, sm_b->count);
+		for (int i = 0; i < count; i++) {
+			snprintf(entry_label, sizeof(entry_label), "%s %d", label, i);
+			syncm_fields(&sm_b->entry[i], fb);
+			diffs += diff_fields(f, entry_label, fa, fb, syncm_fields(&sm_a->entry[i], fa));
+		}
+		break;
+	}
+
+	case SII_CAT_TXPDO:
+	case SII_CAT_RXPDO: {
+		struct _sii_pdo *pdo_a = a->data, *pdo_b = b->data;
+		int count = (pdo_a->count < pdo_b->count) ? pdo_a->count : pdo_b->count;
+
+		pdo_fields(pdo_b, sb, fb);
+		diffs += diff_fields(f, label, fa, fb, pdo_fields(pdo_a, sa, fa));
+		for (int i = 0; i < count; i++) {
+			snprintf(entry_label, sizeof(entry_label), "%s entry %d", label, i);
+			pdo_entry_fields(&pdo_b->entry[i], sb, fb);
+			diffs += diff_fields(f, entry_label, fa, fb, pdo_entry_fields(&pdo_a->entry[i], sa, fa));
+		}
+		break;
+	}
+
+	case SII_CAT_DCLOCK:
+		dc_fields(b->data, sb, fb);
+		diffs += diff_fields(f, label, fa, fb, dc_fields(a->data, sa, fa));
+		break;
+
+	default:
+		break;
+	}
+
+	return diffs;
+}
+
+int sii_diff(FILE *f, SiiInfo *a, SiiInfo *b)
+{
+	struct _sii_field fa[SII_MAX_FIELDS], fb[SII_MAX_FIELDS];
+	char label[64];
+	int diffs = 0;
+
+	if (sii_hash(a) == sii_hash(b))
+		return 0;
+
+	if (a->preamble != NULL && b->preamble != NULL) {
+		preamble_fields(b->preamble, fb);
+		diffs += diff_fields(f, "Preamble", fa, fb, preamble_fields(a->preamble, fa));
+	}
+
+	if (a->config != NULL && b->config != NULL) {
+		config_fields(b->config, fb);
+		diffs += diff_fields(f, "Standard Config", fa, fb, config_fields(a->config, fa));
+	}
+
+	for (struct _sii_cat *cat = a->cat_head; cat != NULL; cat = cat->next) {
+		if (cat->type == SII_CAT_STRINGS)
+			continue;
+
+		struct _sii_cat *partner = cat_partner(cat, b);
+		if (partner != NULL) {
+			diffs += diff_cat(f, cat, partner);
+		} else {
+			cat_label(label, sizeof(label), cat);
+			fprintf(f, "%s: removed\n", label);
+			diffs++;
+		}
+	}
+
+	for (struct _sii_cat *cat = b->cat_head; cat != NULL; cat = cat->next) {
+		if (cat->type == SII_CAT_STRINGS || cat_partner(cat, a) != NULL)
+			continue;
+
+		cat_label(label, sizeof(label), cat);
+		fprintf(f, "%s: added\n", label);
+		diffs++;
+	}
+
+	return diffs;
+}
+
+void sii_print(SiiInfo *sii)
+{
+	sii_fprint(stdout, sii);
+}
+
+void sii_fprint(FILE *f, SiiInfo *sii)
+{
+	fprintf(f, "First print preamble and config\n");
+	struct _sii_preamble *preamble = sii->preamble;
+
+	if (preamble != NULL) {
+		/* preamble */
+		fprintf(f, "Preamble:\n");
+		fprintf(f, "PDI Control: ................ 0x%.4x\n", preamble->pdi_ctrl);
+		fprintf(f, "PDI Config: ................. 0x%.4x\n", preamble->pdi_conf);
+		fprintf(f, "Sync Impulse Length: ........ %d ns (raw: 0x%.4x)\n", preamble->sync_impulse*10, preamble->sync_impulse);
+		fprintf(f, "PDI Config 2: ............... 0x%.4x\n", preamble->pdi_conf2);
+		fprintf(f, "Configured Station Alias: ... 0x%.4x\n", preamble->alias);
+		fprintf(f, "Checksum of Preamble: ....... 0x%.4x (%s)\n", preamble->checksum, (preamble->checksum_ok ? "ok" : "wrong"));
+	}
+
+	struct _sii_stdconfig *stdc = sii->config;
+
+	if (stdc != NULL) {
+		/* general information */
+		fprintf(f, "Identity:\n");
+		fprintf(f, "  Vendor ID: ................ 0x%08x\n", stdc->vendor_id);
+		fprintf(f, "  Product ID: ............... 0x%08x\n", stdc->product_id);
+		fprintf(f, "  Revision ID: .............. 0x%08x\n", stdc->revision_id);
+		fprintf(f, "  Serial Number: ............ 0x%08x\n", stdc->serial);
+
+		/* mailbox settings */
+		fprintf(f, "\nDefault mailbox settings:\n");
+		fprintf(f, "  Bootstrap Mailbox:\n");
+		fprintf(f, "  Received Mailbox Offset: .. 0x%04x\n", stdc->bs_rec_mbox_offset);
+		fprintf(f, "  Received Mailbox Size: .... %d\n", stdc->bs_rec_mbox_size);
+		fprintf(f, "  Send Mailbox Offset: ...... 0x%04x\n", stdc->bs_snd_mbox_offset);
+		fprintf(f, "  Send Mailbox Size: ........ %d\n", stdc->bs_snd_mbox_size);
+
+		fprintf(f, "  Mailbox Settings:\n");
+		fprintf(f, "  Received Mailbox Offset: .. 0x%04x\n", stdc->std_rec_mbox_offset);
+		fprintf(f, "  Received Mailbox Size: .... %d\n", stdc->std_rec_mbox_size);
+		fprintf(f, "  Send Mailbox Offset: ...... 0x%04x\n", stdc->std_snd_mbox_offset);
+		fprintf(f, "  Send Mailbox Size: ........ %d\n", stdc->std_snd_mbox_size);
+
+		fprintf(f, "\nSupported Mailboxes:\n");
+		fprintf(f, "  CoE ....................... %s\n", (stdc->mailbox_protocol.word&MBOX_COE) ? "True" : "False");
+		fprintf(f, "  EoE ....................... %s\n", (stdc->mailbox_protocol.word&MBOX_EOE) ? "True" : "False");
+		fprintf(f, "  FoE ....................... %s\n", (stdc->mailbox_protocol.word&MBOX_FOE) ? "True" : "False");
+		fprintf(f, "  SoE ....................... %s\n", (stdc->mailbox_protocol.word&MBOX_SOE) ? "True" : "False");
+		fprintf(f, "  VoE ....................... %s\n", (stdc->mailbox_protocol.word&MBOX_VOE) ? "True" : "False");
+		fprintf(f, "\n");
+
+		fprintf(f, "EEPROM size: ................ %d bytes\n", EE_TO_BYTES(stdc->eeprom_size));
+		fprintf(f, "Version: .................... %d\n", stdc->version);
+		fprintf(f, "\n");
+	}
+
+	/* now print the categories */
+	cat_rewind(sii);
+	struct _sii_cat *cats = sii->cat_current;
+
+	while (cats != NULL) {
+		cat_print(f, cats);
+		cats = cat_next(sii);
+	}
+}
+
+int sii_check(SiiInfo *sii)
+{
+	sii_error("Not yet implemented\n");
+	return sii->rawvalid;
+}
+
+static int write_all(int fd, const uint8_t *data, size_t size)
+{
+	while (size > 0) {
+		ssize_t n = write(fd, data, size);
+		if (n < 0) {
+			if (errno == EINTR)
+				continue;
+			return -1;
+		}
+
+		data += n;
+		size -= (size_t)n;
+	}
+
+	return 0;
+}
+
+/* make the rename of a file in the directory of path durable */
+static int sync_dir(const char *path)
+{
+	const char *slash = strrchr(path, '/');
+	char *dir = NULL;
+
+	if (slash == NULL)
+		dir = strdup(".");
+	else if (slash == path)
+		dir = strdup("/");
+	else
+		dir = strndup(path, (size_t)(slash - path));
+
+	if (dir == NULL)
+		return -1;
+
+	int fd = open(dir, O_RDONLY | O_DIRECTORY);
+	free(dir);
+	if (fd < 0)
+		return -1;
+
+	int ret = fsync(fd);
+	close(fd);
+
+	return ret;
+}
+
+/* the temporary file is created next to outfile so the rename can't cross
+ * file systems, O_EXCL keeps concurrent writers apart */
+static int open_temp(const char *outfile, char *tmpname, size_t size)
+{
+	static __thread unsigned int counter;
+
+	for (int retry = 0; retry < 100; retry++) {
+		snprintf(tmpname, size, "%s.%ld.%u.tmp", outfile, (long)getpid(), counter++);
+
+		int fd = open(tmpname, O_WRONLY | O_CREAT | O_EXCL, 0666);
+		if (fd >= 0 || errno != EEXIST)
+			return fd;
+	}
+
+	return -1;
+}
+
+int sii_write_bin(SiiInfo *sii, const char *outfile)
+{
+	return sii_write_bin_flags(sii, outfile, 0);
+}
+
+int sii_write_bin_flags(SiiInfo *sii, const char *outfile, unsigned int flags)
+{
+	if (!sii->rawvalid) {
+		sii_error("Error, raw string is invalid\n");
+		return -1;
+	}
+
+	return sii_write_file(outfile, sii->rawbytes, sii->rawsize, flags);
+}
+
+int sii_write_file(const char *outfile, const uint8_t *image, size_t size, unsigned int flags)
+{
+	if (outfile == NULL) {
+		fflush(stdout);
+		if (write_all(STDOUT_FILENO, image, size) != 0) {
+			sii_error("Error writing 'stdout': %s\n", strerror(errno));
+			return -2;
+		}
+
+		return 0;
+	}
+
+	// FIXME Currently existing files are silently overwritten, should ask to perform the action!
+	struct stat fs;
+	if (!stat(outfile, &fs)) {
+		sii_warning("Warning, existing file %s is overwritten\n", outfile);
+	}
+
+	size_t namesize = strlen(outfile) + 64;
+	char *tmpname = malloc(namesize);
+	if (tmpname == NULL) {
+		sii_error("Error, out of memory\n");
+		return -2;
+	}
+
+	int fd = open_temp(outfile, tmpname, namesize);
+	if (fd < 0) {
+		sii_error("Error open file '%s' for writing: %s\n", outfile, strerror(errno));
+		free(tmpname);
+		return -2;
+	}
+
+	int err = write_all(fd, image, size);
+	if (err == 0 && (flags & SII_WRITE_SYNC))
+		err = fsync(fd);
+
+	if (close(fd) != 0)
+		err = -1;
+
+	if (err == 0)
+		err = rename(tmpname, outfile);
+
+	if (err != 0) {
+		sii_error("Error writing '%s': %s\n", outfile, strerror(errno));
+		unlink(tmpname);
+		free(tmpname);
+		return -2;
+	}
+
+	free(tmpname);
+
+	if ((flags & SII_WRITE_SYNC) && sync_dir(outfile) != 0) {
+		sii_error("Error syncing directory of '%s': %s\n", outfile, strerror(errno));
+		return -2;
+	}
+
+	return 0;
+}
+
+
+int sii_add_info(SiiInfo *sii, struct _sii_preamble *pre, struct _sii_stdconfig *cfg)
+{
+	if (sii->preamble != NULL) {
+		sii_warning("Warning, sii->preamble not empty.\n");
+		return -1;
+	}
+
+	if (sii->config != NULL) {
+		sii_warning("Warning, sii->config not empty.\n");
+		return -1;
+	}
+
+	sii->preamble = pre;
+	sii->config = cfg;
+
+	return 0;
+}
+
+struct _sii_cat *sii_category_new(SiiInfo *sii, enum eSection type)
+{
+	struct _sii_cat *cat = sii_alloc(sii, sizeof(struct _sii_cat));
+	cat->type = type;
+
+	switch (type) {
+	case SII_CAT_STRINGS:
+		cat->data = sii_alloc(sii, sizeof(struct _sii_strings));
+		((struct _sii_strings *)cat->data)->arena = sii->arena;
+		break;
+
+	case SII_CAT_GENERAL:
+		cat->data = sii_alloc(sii, sizeof(struct _sii_general));
+		break;
+
+	case SII_CAT_FMMU:
+		cat->data = sii_alloc(sii, sizeof(struct _sii_fmmu));
+		((struct _sii_fmmu *)cat->data)->arena = sii->arena;
+		break;
+
+	case SII_CAT_SYNCM:
+		cat->data = sii_alloc(sii, sizeof(struct _sii_syncm));
+		((struct _sii_syncm *)cat->data)->arena = sii->arena;
+		break;
+
+	case SII_CAT_TXPDO:
+	case SII_CAT_RXPDO:
+		cat->data = sii_alloc(sii, sizeof(struct _sii_pdo));
+		((struct _sii_pdo *)cat->data)->arena = sii->arena;
+		break;
+
+	case SII_CAT_DCLOCK:
+		cat->data = sii_alloc(sii, sizeof(struct _sii_dclock));
+		break;
+
+	default: /* unknown or unimplemented content */
+		break;
+	}
+
+	return cat;
+}
+
+int sii_category_add(SiiInfo *sii, struct _sii_cat *cat)
+{
+	return cat_add(sii, cat);
+}
+
+struct _sii_cat *sii_category_find(SiiInfo *sii, enum eSection category)
+{
+	for (struct _sii_cat *c = sii->cat_head; c; c = c->next) {
+		if (c->type == category)
+			return c;
+	}
+
+	return NULL;
+}
+
+int sii_strings_add(SiiInfo *sii, const char *entry)
+{
+	struct _sii_cat *strings = sii_category_find(sii, SII_CAT_STRINGS);
+
+	if (strings == NULL)
+		return -1;
+
+	if (strings->data == NULL)
+		return -1;
+
+	return strings_add((struct _sii_strings *)strings->data, entry);
+}
+
+int strings_add(struct _sii_strings *strings, const char *entry)
+{
+	size_t size = strlen(entry);
+	struct _string *s = strings_lookup(strings, entry, size, string_hash(entry, size));
+
+	if (s != NULL)
+		return s->id;
+
+	return strings_entry_add(strings, entry, size);
+}
+
+const char *string_search_id(struct _sii_strings *strings, int id)
+{
+	if (strings == NULL || id < 1 || id > strings->count)
+		return NULL;
+
+	return string_data(strings, &strings->string[id-1]);
+}
+
+int string_search_string(struct _sii_strings *strings, const char *str)
+{
+	size_t size = strlen(str);
+	struct _string *s = strings_lookup(strings, str, size, string_hash(str, size));
+
+	return s != NULL ? s->id : -1;
+}
+
+char *cat2string(enum eSection cat)
+{
+	switch (cat) {
+	case SII_PREAMBLE:
+		return "SII_PREAMBLE";
+	case SII_STD_CONFIG:
+		return "SII_STD_CONFIG";
+	case SII_CAT_STRINGS:
 		return "SII_CAT_STRINGS";
 	case SII_CAT_DATATYPES:
 		return "SII_CAT_DATATYPES";
@@ -2191,6 +3155,8 @@ char *cat2string(enum eSection cat)
 		return "SII_CAT_RXPDO";
 	case SII_CAT_DCLOCK:
 		return "SII_CAT_DCLOCK";
+	case SII_END:
+		return "SII_END";
 	case SII_CAT_NOP:
 	default:
 		return "undefined";
@@ -2198,13 +3164,18 @@ char *cat2string(enum eSection cat)
 }
 
 void sii_cat_sort(SiiInfo *sii)
+{
+	sii_cat_sort_order(sii, SII_ORDER_TYPE);
+}
+
+void sii_cat_sort_order(SiiInfo *sii, enum eSiiCatOrder order)
 {
 	struct _sii_cat *head = sii->cat_head;
 	struct _sii_cat *min = NULL;
 	struct _sii_cat *new = NULL;
 	struct _sii_cat *current = NULL;
 
-	while ( (min = sii_cat_get_min(head)) != NULL ) {
+	while ( (min = sii_cat_get_min(head, order)) != NULL ) {
 		if (min == head)
 			head = head->next;
 
@@ -8,6 +8,10 @@
 
 #include <unistd.h>
 #include <stdint.h>
+#include <stdio.h>
+
+#include "arena.h"
+#include "siiview.h"
 
 #define SII_VERSION_MAJOR  0
 #define SII_VERSION_MINOR  0
@@ -27,6 +31,14 @@
 #define EE_TO_BYTES(x) ((x << 7) + 0x80)
 #define BYTES_TO_EE(x) ((x - 0x80) >> 7)
 
+/* byte offsets in the binary sii */
+#define SII_ALIAS_OFFSET     8   /* configured station alias */
+#define SII_CHECKSUM_OFFSET  14  /* crc8 of the preamble words before */
+#define SII_SERIAL_OFFSET    28  /* serial number of the std config */
+
+/* the categories start after preamble and std config */
+#define SII_CAT_OFFSET 128
+
 enum eSection {
 	SII_PREAMBLE = -1
 	,SII_STD_CONFIG = -2
@@ -89,18 +101,26 @@ struct _sii_stdconfig {
 
 struct _string {
 	uint8_t length;
-	char *data;
+	size_t offset; /* of the zero terminated data in _sii_strings.text */
 	/* misc information */
 	int id;
-	struct _string *next;
-	struct _string *prev;
+	uint32_t hash;
+	int hash_next; /* id of the next string in the same hash bucket, 0 for none */
 };
 
+#define STRINGS_HASH_SIZE  256
+
+/* strings are stored in string[id-1] */
 struct _sii_strings {
-	uint8_t count;
+	Arena *arena;
+	int count;
+	int capacity;
 	size_t size;
-	struct _string *head;
-	struct _string *current;
+	struct _string *string;
+	char *text;
+	size_t text_size;
+	size_t text_capacity;
+	int bucket[STRINGS_HASH_SIZE]; /* id of the first string of every content */
 };
 
 struct _sii_general {
@@ -155,13 +175,13 @@ struct _fmmu_entry {
 	uint8_t usage;
 	/* no content of sii entry */
 	int id;
-	struct _fmmu_entry *next;
-	struct _fmmu_entry *prev;
 };
 
 struct _sii_fmmu {
+	Arena *arena;
 	int count;
-	struct _fmmu_entry *list;
+	int capacity;
+	struct _fmmu_entry *entry; /* array of count entries */
 };
 
 enum eSyncmType {
@@ -181,13 +201,13 @@ struct _syncm_entry {
 	uint8_t type;
 	/* no content of sii entry */
 	int id;
-	struct _syncm_entry *next;
-	struct _syncm_entry *prev;
 };
 
 struct _sii_syncm {
+	Arena *arena;
 	int count;
-	struct _syncm_entry *list;
+	int capacity;
+	struct _syncm_entry *entry; /* array of count entries */
 };
 
 
@@ -209,8 +229,6 @@ struct _pdo_entry {
 	uint16_t flags; /* for future use - set to 0 */
 	/* no content of sii entry */
 	int id;
-	struct _pdo_entry *next;
-	struct _pdo_entry *prev;
 };
 
 struct _sii_pdo {
@@ -222,7 +240,10 @@ struct _sii_pdo {
 	uint16_t flags; /* for future use - set to 0 */
 	/* no content of sii entry */
 	int type; /* rx or tx pdo */
-	struct _pdo_entry *list;
+	Arena *arena;
+	int count;
+	int capacity;
+	struct _pdo_entry *entry; /* array of count entries */
 };
 
 /* FIXME Question asked to ETG aobut hte missing 'cycleTime1' parameter in the
@@ -248,6 +269,9 @@ struct _sii_cat {
 	void *data;
 	struct _sii_cat *next;
 	struct _sii_cat *prev;
+	/* position in the generated image, set by sii_layout() */
+	size_t offset; /* of the category header, 0 if not written */
+	uint16_t words; /* data size in words */
 };
 
 struct _sii {
@@ -260,6 +284,10 @@ struct _sii {
 	uint8_t *rawbytes;
 	int rawvalid;
 	size_t rawsize;
+	size_t rawcapacity;
+	/* everything above is allocated from the arena */
+	Arena *arena;
+	int arena_owned;
 };
 
 typedef struct _sii SiiInfo;
@@ -271,8 +299,29 @@ typedef struct _sii SiiInfo;
  */
 SiiInfo *sii_init(void);
 
+/**
+ * Allocate the SiiInfo objects created by the calling thread from arena,
+ * NULL restores one private arena per object. The caller owns arena and
+ * may only reset it after these objects are released.
+ */
+void sii_use_arena(Arena *arena);
+
+/* zero initialized memory which lives as long as sii */
+void *sii_alloc(SiiInfo *sii, size_t size);
+
+/* parse the SII image of size bytes, the image ends at the EEPROM size of
+ * its std config if that is smaller */
 SiiInfo *sii_init_string(const unsigned char *eeprom, size_t size);
 SiiInfo *sii_init_file(const char *filename);
+
+/**
+ * \brief Decode a single category of a SiiView into a category of sii
+ *
+ * The category is not added to sii, see sii_category_add().
+ *
+ * \return the category, NULL for unknown, vendor specific and datatype categories
+ */
+struct _sii_cat *sii_view_decode(SiiInfo *sii, const struct _sii_view_cat *cat);
 void sii_release(SiiInfo *sii);
 
 /**
@@ -285,13 +334,200 @@ void sii_release(SiiInfo *sii);
  */
 size_t sii_generate(SiiInfo *sii, unsigned int add_pdo_mapping, unsigned int add_dc_config);
 
+/**
+ * \brief Generate binary sii into a caller provided buffer
+ *
+ * Nothing is allocated. If buf is NULL or smaller than the image nothing is
+ * written, so a first call with buf == NULL returns the required size.
+ *
+ * \param buf   buffer for the image
+ * \param size  size of buf in bytes
+ * \return size of the image in bytes, 0 on error
+ */
+size_t sii_generate_into(SiiInfo *sii, unsigned int add_pdo_mapping, unsigned int add_dc_config,
+		uint8_t *buf, size_t size);
+
+struct _sii_layout {
+	size_t size;         /* bytes of the image including the end marker */
+	size_t eeprom_size;  /* bytes of the EEPROM from the std config */
+	int categories;      /* number of categories written */
+	uint16_t oversized;  /* first category with more than 0xffff words, 0 if none */
+};
+
+/**
+ * \brief Compute the layout of the binary sii without generating it
+ *
+ * Sets offset and words of every category, sii_generate() and
+ * sii_generate_into() fail if the layout doesn't fit.
+ *
+ * \return 0 if the image fits into the EEPROM, -1 otherwise
+ */
+int sii_layout(SiiInfo *sii, unsigned int add_pdo_mapping, unsigned int add_dc_config,
+		struct _sii_layout *layout);
+
+/* optional content dropped by sii_optimize() */
+#define SII_DROP_PDO_ENTRY_NAMES  0x01
+#define SII_DROP_DC_NAMES         0x02  /* name and description of the DC OpMode */
+#define SII_DROP_PDO_MAPPING      0x04  /* the TxPDO and RxPDO categories */
+
+/**
+ * \brief Drop optional content until the binary sii fits into the EEPROM
+ *
+ * The optional content is dropped in the order of the SII_DROP_* values,
+ * strings no longer referenced are removed. Modifies sii and clears
+ * add_pdo_mapping if the PDO mapping is dropped, the choice is reported
+ * as warning.
+ *
+ * \return mask of SII_DROP_* values, 0 if the binary fits as is, -1 if it
+ *         doesn't fit even without the optional content
+ */
+int sii_optimize(SiiInfo *sii, unsigned int *add_pdo_mapping, unsigned int add_dc_config);
+
+/* where a master finds a category without walking the category chain */
+struct _sii_directory_entry {
+	uint16_t type;
+	uint16_t offset;     /* word offset of the category header */
+	uint16_t words;      /* data size in words */
+	uint16_t pdo_index;  /* index of the PDO of PDO categories, otherwise 0 */
+};
+
+/* fills up to max entries from the offsets of the last generation or the
+ * parsed binary, returns the number of written categories */
+int sii_directory(SiiInfo *sii, struct _sii_directory_entry *entry, int max);
+
+enum eSiiDirectoryFormat {
+	SII_DIRECTORY_BIN = 0  /* "SIID", u16 version, u16 count, u32 vendor, product,
+	                        * revision, count entries of 4 u16, little endian */
+	,SII_DIRECTORY_HEADER  /* C header with a table of the entries */
+};
+
+/* write the category directory like sii_write_file() */
+int sii_write_directory(SiiInfo *sii, const char *outfile, enum eSiiDirectoryFormat format,
+		unsigned int flags);
+
+/* EEPROM access of the master for the read time estimate */
+struct _sii_read_model {
+	size_t read_size;        /* bytes per read access, 2 (word-wise), 4 or 8 */
+	unsigned int access_us;  /* duration of one read access */
+};
+
+/**
+ * \brief Offset, size and estimated read time of every category
+ *
+ * Uses the offsets of the parsed binary or of the last sii_layout() or
+ * generation. One line per part in image order, the end_us column is the
+ * time until the master has read the part completely.
+ */
+void sii_size_report(FILE *f, SiiInfo *sii, const struct _sii_read_model *model);
+
+/* estimated time to write one EEPROM word through the ESC */
+#define SII_FLASH_WORD_TIME_US  5000
+
+/* words of an image which differ from the EEPROM content */
+struct _sii_flash_range {
+	size_t word;   /* first word */
+	size_t count;  /* number of words */
+};
+
+/* upper bound of the ranges of an image of size bytes */
+#define SII_FLASH_MAX_RANGES(size)  (((size) + 3) / 4)
+
+/**
+ * \brief Minimal list of word ranges to turn current into image
+ *
+ * Only the size bytes of image are compared, the EEPROM content behind
+ * the end marker of image is left alone. Words behind the end of current
+ * are always written.
+ *
+ * \param range  filled with up to max ranges in ascending order
+ * \return number of ranges, may be larger than max
+ */
+size_t sii_flash_plan(const uint8_t *current, size_t current_size,
+		const uint8_t *image, size_t size,
+		struct _sii_flash_range *range, size_t max);
+
+/* precomputed part of the preamble checksum of a base image */
+struct _sii_stamp {
+	uint8_t crc;          /* crc8 state of the words before the alias */
+	uint16_t alias;       /* alias of the base image */
+	uint8_t reserved[4];  /* words between alias and checksum */
+};
+
+/* prepare stamping copies of the generated image, -1 if it is too short */
+int sii_stamp_init(struct _sii_stamp *stamp, const uint8_t *image, size_t size);
+
+/**
+ * \brief Set serial number and station alias of a copy of the base image
+ *
+ * Only the serial, the alias and the preamble checksum are written, the
+ * checksum is completed from the state in stamp.
+ */
+void sii_stamp(const struct _sii_stamp *stamp, uint8_t *image, uint32_t serial, uint16_t alias);
+
+/**
+ * \brief Content hash of a category or a whole image
+ *
+ * String indexes are hashed by the text behind them, so the order of the
+ * string table doesn't change the hash. The image hash doesn't depend on
+ * the order of the categories, equal hashes mean equal content.
+ */
+uint64_t sii_cat_hash(struct _sii_cat *cat);
+uint64_t sii_hash(SiiInfo *sii);
+
+/* identity and category hashes of an image, a hash is 0 if the image
+ * doesn't have the category, pdo covers all TxPDO and RxPDO categories */
+struct _sii_signature {
+	uint32_t vendor_id;
+	uint32_t product_id;
+	uint32_t revision_id;
+	uint64_t general;
+	uint64_t fmmu;
+	uint64_t syncm;
+	uint64_t pdo;
+	uint64_t dc;
+};
+
+void sii_signature(SiiInfo *sii, struct _sii_signature *sig);
+
+/**
+ * \brief Print the semantic differences from a to b to f
+ *
+ * One line per differing field, e.g. "SyncManager 2: length 0x100 -> 0x200".
+ * PDOs are matched by their index, the other categories by their position
+ * among the categories of the same type. Categories with equal hashes are
+ * not compared further.
+ *
+ * \return number of differences, 0 if the content is equal
+ */
+int sii_diff(FILE *f, SiiInfo *a, SiiInfo *b);
+
 void sii_print(SiiInfo *sii);
 
+/* like sii_print() but writes to the stream f */
+void sii_fprint(FILE *f, SiiInfo *sii);
+
 //void sii_print_bin(SiiInfo *sii); - ???
 
 /* wirte binary to file */
 int sii_write_bin(SiiInfo *sii, const char *outfile);
 
+/* flags for sii_write_bin_flags() */
+#define SII_WRITE_SYNC  0x01  /* fsync the file and its directory */
+
+/**
+ * \brief Write binary to file
+ *
+ * The binary is written to a temporary file next to outfile which is then
+ * renamed to outfile, readers see either the old or the complete new
+ * file. Without outfile the binary is written to stdout.
+ *
+ * \return 0 on success, negative value on error
+ */
+int sii_write_bin_flags(SiiInfo *sii, const char *outfile, unsigned int flags);
+
+/* like sii_write_bin_flags() for an image which isn't held by a SiiInfo */
+int sii_write_file(const char *outfile, const uint8_t *image, size_t size, unsigned int flags);
+
 /**
  * \brief Sanity check of current config
  */
@@ -301,6 +537,9 @@ int sii_check(SiiInfo *sii);
 int sii_add_info(SiiInfo *sii, struct _sii_preamble *pre, struct _sii_stdconfig *cfg);
 
 /* functions to handle categories */
+
+/* new category including the empty data of the type, not yet added */
+struct _sii_cat *sii_category_new(SiiInfo *sii, enum eSection type);
 int sii_category_add(SiiInfo *sii, struct _sii_cat *cat);
 struct _sii_cat *sii_category_find(SiiInfo *sii, enum eSection category);
 
@@ -308,18 +547,24 @@ struct _sii_cat *sii_category_find(SiiInfo *sii, enum eSection category);
 int sii_strings_add(SiiInfo *sii, const char *entry);
 
 /* functions for specific substructures */
+/* The *_add functions copy the entry into the array of the category */
 void fmmu_add_entry(struct _sii_fmmu *fmmu, int usage);
-void syncm_entry_add(struct _sii_syncm *sm, struct _syncm_entry *entry);
-void pdo_entry_add(struct _sii_pdo *pdo, struct _pdo_entry *entry);
+void syncm_entry_add(struct _sii_syncm *sm, const struct _syncm_entry *entry);
+void pdo_entry_add(struct _sii_pdo *pdo, const struct _pdo_entry *entry);
 
 /**
- * Add new string if category string is available.
+ * Add new string if category string is available, identical strings are
+ * stored only once.
  *
- * @return the index of the newly added string
+ * @return the index of the new or already existing string
  */
 int strings_add(struct _sii_strings *strings, const char *entry);
 
 const char *string_search_id(struct _sii_strings *strings, int id);
+
+/**
+ * @return the index of the first string equal to str, -1 if not found
+ */
 int string_search_string(struct _sii_strings *strings, const char *str);
 
 /* misc functions */
@@ -328,4 +573,12 @@ char *cat2string(enum eSection cat);
 /* sort the categories in increasing order of cathegories type */
 void sii_cat_sort(SiiInfo *sii);
 
+enum eSiiCatOrder {
+	SII_ORDER_TYPE = 0   /* increasing category type, strings first */
+	,SII_ORDER_STARTUP   /* General, SyncM, FMMU, DC and PDOs before the strings */
+};
+
+/* sort the categories by order, categories of equal rank keep their order */
+void sii_cat_sort_order(SiiInfo *sii, enum eSiiCatOrder order);
+
 #endif /* SII_H */
@@ -0,0 +1,337 @@
+/* siiindex - catalog of the SII signatures of ESI devices
+ */
+
+#include "siiindex.h"
+#include "log.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define INDEX_HEADER  "# siitool index 1\n"
+
+struct _sii_index {
+	struct _sii_index_entry *entry;
+	int count;
+	int capacity;
+	int sorted;
+};
+
+static const struct {
+	unsigned int match;
+	unsigned int weight;
+	const char *name;
+} match_field[] = {
+	{ SII_MATCH_VENDOR,   1,  "vendor_id" },
+	{ SII_MATCH_PRODUCT,  64, "product_id" },
+	{ SII_MATCH_REVISION, 32, "revision_id" },
+	{ SII_MATCH_GENERAL,  8,  "general" },
+	{ SII_MATCH_FMMU,     2,  "fmmu" },
+	{ SII_MATCH_SYNCM,    4,  "syncm" },
+	{ SII_MATCH_PDO,      4,  "pdo" },
+	{ SII_MATCH_DC,       2,  "dc" },
+};
+
+#define MATCH_FIELDS  (sizeof(match_field) / sizeof(match_field[0]))
+
+SiiIndex *sii_index_new(void)
+{
+	return calloc(1, sizeof(SiiIndex));
+}
+
+void sii_index_free(SiiIndex *index)
+{
+	if (index == NULL)
+		return;
+
+	for (int i = 0; i < index->count; i++)
+		free(index->entry[i].file);
+
+	free(index->entry);
+	free(index);
+}
+
+int sii_index_add(SiiIndex *index, const struct _sii_signature *sig, const char *file, int device)
+{
+	if (index->count == index->capacity) {
+		int capacity = index->capacity ? 2 * index->capacity : 64;
+		struct _sii_index_entry *entry = realloc(index->entry, capacity * sizeof(struct _sii_index_entry));
+		if (entry == NULL)
+			return -1;
+
+		index->entry = entry;
+		index->capacity = capacity;
+	}
+
+	struct _sii_index_entry *new = &index->entry[index->count];
+	new->file = strdup(file);
+	if (new->file == NULL)
+		return -1;
+
+	new->sig = *sig;
+	new->device = device;
+	index->count++;
+	index->sorted = 0;
+
+	return 0;
+}
+
+int sii_index_count(const SiiIndex *index)
+{
+	return index->count;
+}
+
+static int compare_identity(const struct _sii_signature *a, const struct _sii_signature *b)
+{
+	if (a->vendor_id != b->vendor_id)
+		return a->vendor_id < b->vendor_id ? -1 : 1;
+	if (a->product_id != b->product_id)
+		return a->product_id < b->product_id ? -1 : 1;
+	if (a->revision_id != b->revision_id)
+		return a->revision_id < b->revision_id ? -1 : 1;
+
+	return 0;
+}
+
+static int compare_entries(const void *a, const void *b)
+{
+	const struct _sii_index_entry *ea = a;
+	const struct _sii_index_entry *eb = b;
+
+	int ret = compare_identity(&ea->sig, &eb->sig);
+	if (ret != 0)
+		return ret;
+
+	ret = strcmp(ea->file, eb->file);
+	if (ret != 0)
+		return ret;
+
+	return ea->device - eb->device;
+}
+
+static void index_sort(SiiIndex *index)
+{
+	if (index->sorted)
+		return;
+
+	qsort(index->entry, index->count, sizeof(struct _sii_index_entry), compare_entries);
+	index->sorted = 1;
+}
+
+int sii_index_write(SiiIndex *index, const char *outfile, unsigned int flags)
+{
+	char *text = NULL;
+	size_t length = 0;
+
+	index_sort(index);
+
+	FILE *f = open_memstream(&text, &length);
+	if (f == NULL)
+		return -1;
+
+	fprintf(f, INDEX_HEADER);
+	for (int i = 0; i < index->count; i++) {
+		const struct _sii_index_entry *e = &index->entry[i];
+
+		fprintf(f, "0x%08x,0x%08x,0x%08x,%016llx,%016llx,%016llx,%016llx,%016llx,%d,%s\n",
+				e->sig.vendor_id, e->sig.product_id, e->sig.revision_id,
+				(unsigned long long)e->sig.general, (unsigned long long)e->sig.fmmu,
+				(unsigned long long)e->sig.syncm, (unsigned long long)e->sig.pdo,
+				(unsigned long long)e->sig.dc, e->device, e->file);
+	}
+	fclose(f);
+
+	int ret = sii_write_file(outfile, (const uint8_t *)text, length, flags);
+	free(text);
+
+	return ret;
+}
+
+SiiIndex *sii_index_read(const char *file)
+{
+	FILE *f = fopen(file, "r");
+	if (f == NULL) {
+		sii_error("Error, can't open index '%s'\n", file);
+		return NULL;
+	}
+
+	SiiIndex *index = sii_index_new();
+	char *line = NULL;
+	size_t size = 0;
+	ssize_t len;
+	int lineno = 0;
+
+	while (index != NULL && (len = getline(&line, &size, f)) > 0) {
+		struct _sii_signature sig;
+		unsigned long long general, fmmu, syncm, pdo, dc;
+		int device, pos = 0;
+
+		if (lineno++ == 0) {
+			if (strcmp(line, INDEX_HEADER) != 0) {
+				sii_error("Error, '%s' is no siitool index\n", file);
+				sii_index_free(index);
+				index = NULL;
+			}
+			continue;
+		}
+
+		if (line[len-1] == '\n')
+			line[--len] = '\0';
+
+		memset(&sig, 0, sizeof(sig));
+		if (sscanf(line, "%x,%x,%x,%llx,%llx,%llx,%llx,%llx,%d,%n",
+					&sig.vendor_id, &sig.product_id, &sig.revision_id,
+					&general, &fmmu, &syncm, &pdo, &dc, &device, &pos) < 9 || pos == 0) {
+			sii_error("Error, malformed line %d of index '%s'\n", lineno, file);
+			sii_index_free(index);
+			index = NULL;
+			break;
+		}
+
+		sig.general = general;
+		sig.fmmu = fmmu;
+		sig.syncm = syncm;
+		sig.pdo = pdo;
+		sig.dc = dc;
+
+		if (sii_index_add(index, &sig, line + pos, device) != 0) {
+			sii_index_free(index);
+			index = NULL;
+		}
+	}
+
+	free(line);
+	fclose(f);
+
+	/* sorted once, lookups don't modify the index anymore */
+	if (index != NULL)
+		index_sort(index);
+
+	return index;
+}
+
+const char *sii_match_name(unsigned int match)
+{
+	for (size_t i = 0; i < MATCH_FIELDS; i++) {
+		if (match_field[i].match == match)
+			return match_field[i].name;
+	}
+
+	return NULL;
+}
+
+/* fields of sig which take part in the comparison */
+static unsigned int match_present(const struct _sii_signature *sig)
+{
+	unsigned int present = SII_MATCH_VENDOR | SII_MATCH_PRODUCT | SII_MATCH_REVISION;
+
+	present |= (sig->general != 0) ? SII_MATCH_GENERAL : 0;
+	present |= (sig->fmmu != 0) ? SII_MATCH_FMMU : 0;
+	present |= (sig->syncm != 0) ? SII_MATCH_SYNCM : 0;
+	present |= (sig->pdo != 0) ? SII_MATCH_PDO : 0;
+	present |= (sig->dc != 0) ? SII_MATCH_DC : 0;
+
+	return present;
+}
+
+static unsigned int match_fields(const struct _sii_signature *a, const struct _sii_signature *b)
+{
+	unsigned int match = 0;
+
+	match |= (a->vendor_id == b->vendor_id) ? SII_MATCH_VENDOR : 0;
+	match |= (a->product_id == b->product_id) ? SII_MATCH_PRODUCT : 0;
+	match |= (a->revision_id == b->revision_id) ? SII_MATCH_REVISION : 0;
+	match |= (a->general == b->general) ? SII_MATCH_GENERAL : 0;
+	match |= (a->fmmu == b->fmmu) ? SII_MATCH_FMMU : 0;
+	match |= (a->syncm == b->syncm) ? SII_MATCH_SYNCM : 0;
+	match |= (a->pdo == b->pdo) ? SII_MATCH_PDO : 0;
+	match |= (a->dc == b->dc) ? SII_MATCH_DC : 0;
+
+	return match;
+}
+
+static unsigned int match_score(unsigned int match)
+{
+	unsigned int score = 0;
+
+	for (size_t i = 0; i < MATCH_FIELDS; i++) {
+		if (match & match_field[i].match)
+			score += match_field[i].weight;
+	}
+
+	return score;
+}
+
+/* best of the entries first <= i < last, *best_score is updated */
+static int best_entry(SiiIndex *index, int first, int last, const struct _sii_signature *sig,
+		unsigned int present, unsigned int *best_score)
+{
+	int best = -1;
+
+	for (int i = first; i < last; i++) {
+		unsigned int match = match_fields(&index->entry[i].sig, sig) & present;
+		if (!(match & SII_MATCH_VENDOR))
+			continue;
+
+		unsigned int score = match_score(match);
+		if (best < 0 || score > *best_score) {
+			best = i;
+			*best_score = score;
+		}
+	}
+
+	return best;
+}
+
+const struct _sii_index_entry *sii_index_lookup(SiiIndex *index, const struct _sii_signature *sig,
+		unsigned int *matched, int *exact)
+{
+	unsigned int present = match_present(sig);
+	unsigned int score = 0;
+	int low = 0, high = index->count;
+
+	index_sort(index);
+
+	/* first entry with the identity of sig */
+	while (low < high) {
+		int mid = low + (high - low) / 2;
+		if (compare_identity(&index->entry[mid].sig, sig) < 0)
+			low = mid + 1;
+		else
+			high = mid;
+	}
+
+	int last = low;
+	while (last < index->count && compare_identity(&index->entry[last].sig, sig) == 0)
+		last++;
+
+	int best = best_entry(index, low, last, sig, present, &score);
+	if (best < 0 || score != match_score(present)) {
+		/* all entries of the vendor, the others can't be a candidate */
+		int first = 0;
+		high = low;
+		while (first < high) {
+			int mid = first + (high - first) / 2;
+			if (index->entry[mid].sig.vendor_id < sig->vendor_id)
+				first = mid + 1;
+			else
+				high = mid;
+		}
+
+		while (last < index->count && index->entry[last].sig.vendor_id == sig->vendor_id)
+			last++;
+
+		best = best_entry(index, first, last, sig, present, &score);
+	}
+
+	if (best < 0) {
+		*matched = 0;
+		*exact = 0;
+		return NULL;
+	}
+
+	*matched = match_fields(&index->entry[best].sig, sig) & present;
+	*exact = (*matched == present);
+
+	return &index->entry[best];
+}
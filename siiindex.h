@@ -0,0 +1,65 @@
+/* siiindex - catalog of the SII signatures of ESI devices
+ *
+ * The index maps the signature of a SII image back to the ESI file and
+ * device it was generated from. It is built once from the ESI catalog and
+ * stored as text, a lookup is a binary search by vendor, product and
+ * revision and only falls back to scoring the entries of the vendor if
+ * there is no exact match.
+ */
+
+#ifndef SIIINDEX_H
+#define SIIINDEX_H
+
+#include "sii.h"
+
+typedef struct _sii_index SiiIndex;
+
+struct _sii_index_entry {
+	struct _sii_signature sig;
+	int device;  /* position within <Devices> */
+	char *file;
+};
+
+/* fields of a signature which match, see sii_index_lookup() */
+#define SII_MATCH_VENDOR    0x01
+#define SII_MATCH_PRODUCT   0x02
+#define SII_MATCH_REVISION  0x04
+#define SII_MATCH_GENERAL   0x08
+#define SII_MATCH_FMMU      0x10
+#define SII_MATCH_SYNCM     0x20
+#define SII_MATCH_PDO       0x40
+#define SII_MATCH_DC        0x80
+
+SiiIndex *sii_index_new(void);
+void sii_index_free(SiiIndex *index);
+
+/* copies file, returns 0 on success, -1 if out of memory */
+int sii_index_add(SiiIndex *index, const struct _sii_signature *sig, const char *file, int device);
+
+int sii_index_count(const SiiIndex *index);
+
+/* write the index as text, see sii_write_file() */
+int sii_index_write(SiiIndex *index, const char *outfile, unsigned int flags);
+
+/* NULL if the file can't be read or isn't an index */
+SiiIndex *sii_index_read(const char *file);
+
+/* name of a SII_MATCH_* bit */
+const char *sii_match_name(unsigned int match);
+
+/**
+ * \brief Entry which matches sig best
+ *
+ * Identity fields weigh more than category hashes. The PDO and DC hashes
+ * only count if sig has these categories, a dump without PDO mapping can
+ * still match exactly. An index from sii_index_read() is not modified, so
+ * several threads can look up in it at the same time.
+ *
+ * \param matched  SII_MATCH_* of the fields which are equal
+ * \param exact    set to 1 if all fields sig has are equal
+ * \return best entry, NULL if not even the vendor matches
+ */
+const struct _sii_index_entry *sii_index_lookup(SiiIndex *index, const struct _sii_signature *sig,
+		unsigned int *matched, int *exact);
+
+#endif /* SIIINDEX_H */
@@ -0,0 +1,344 @@
+/* siitool - library interface
+ */
+
+#include "siitool.h"
+#include "log.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <ctype.h>
+
+#include <libxml/xmlerror.h>
+
+#define MAX_MESSAGE_SIZE   (4096)
+
+/* smaller inputs can't hold preamble, std config and the end marker */
+#define SII_MIN_SIZE       (16+46+66+2)
+
+struct _siitool_context {
+	unsigned int flags;
+	struct _esi_device_selector device;
+	EsiData *esi;   /* ESI input, owns sii */
+	SiiInfo *sii;
+	Arena *arena;   /* sii is allocated from it, reused by every load */
+	int errors;     /* number of errors logged by the current call */
+	size_t msglen;
+	char message[MAX_MESSAGE_SIZE];
+};
+
+static void message_append(SiitoolContext *ctx, const char *msg)
+{
+	size_t len = strlen(msg);
+
+	if (ctx->msglen + len >= sizeof(ctx->message))
+		len = sizeof(ctx->message) - ctx->msglen - 1;
+
+	memcpy(ctx->message + ctx->msglen, msg, len);
+	ctx->msglen += len;
+	ctx->message[ctx->msglen] = '\0';
+}
+
+static void log_handler(void *arg, enum eLogLevel level, const char *msg)
+{
+	SiitoolContext *ctx = (SiitoolContext *)arg;
+
+	if (level == SII_LOG_ERROR)
+		ctx->errors++;
+
+	message_append(ctx, msg);
+}
+
+/* libxml2 reports its messages in pieces, they are only collected, failures
+ * are detected from the return values */
+static void xml_error(void *arg, const char *format, ...)
+{
+	SiitoolContext *ctx = (SiitoolContext *)arg;
+	char msg[1024];
+	va_list ap;
+
+	va_start(ap, format);
+	vsnprintf(msg, sizeof(msg), format, ap);
+	va_end(ap);
+
+	message_append(ctx, msg);
+}
+
+/* messages of the library and of libxml2 are collected in ctx until
+ * call_end(), both handlers are per thread */
+static void call_begin(SiitoolContext *ctx)
+{
+	ctx->errors = 0;
+	ctx->msglen = 0;
+	ctx->message[0] = '\0';
+
+	log_set_handler(log_handler, ctx);
+	xmlSetGenericErrorFunc(ctx, xml_error);
+	sii_use_arena(ctx->arena);
+}
+
+static int call_end(SiitoolContext *ctx, int ret)
+{
+	(void)ctx;
+
+	log_set_handler(NULL, NULL);
+	xmlSetGenericErrorFunc(NULL, NULL);
+	sii_use_arena(NULL);
+
+	return ret;
+}
+
+static void unload(SiitoolContext *ctx)
+{
+	if (ctx->esi != NULL)
+		esi_release(ctx->esi); /* also releases ctx->sii */
+	else if (ctx->sii != NULL)
+		sii_release(ctx->sii);
+
+	ctx->esi = NULL;
+	ctx->sii = NULL;
+	arena_reset(ctx->arena);
+}
+
+static int load_esi(SiitoolContext *ctx, const unsigned char *xml, size_t size)
+{
+	const struct _esi_device_selector *device = &ctx->device;
+	struct _esi_device_selector first = { .keys = ESI_SELECT_NUMBER, .number = 0 };
+	int include_pdo_strings = (ctx->flags & SIITOOL_PDO_MAPPING) != 0;
+
+	if (ctx->flags & SIITOOL_STREAM) {
+		ctx->esi = esi_init_stream(xml, size, device);
+		device = &first; /* the streamed document only holds the selected device */
+	} else {
+		ctx->esi = esi_init_string(xml, size);
+	}
+
+	if (ctx->esi == NULL)
+		return SIITOOL_ERROR_PARSE;
+
+	if (esi_parse_select(ctx->esi, device, include_pdo_strings) != 0) {
+		unload(ctx);
+		return SIITOOL_ERROR_DEVICE;
+	}
+
+	ctx->sii = esi_get_sii(ctx->esi);
+	sii_cat_sort_order(ctx->sii, (ctx->flags & SIITOOL_STARTUP_ORDER) ? SII_ORDER_STARTUP : SII_ORDER_TYPE);
+
+	return (ctx->errors > 0) ? SIITOOL_ERROR_PARSE : SIITOOL_OK;
+}
+
+static int load_sii(SiitoolContext *ctx, const unsigned char *input, size_t size)
+{
+	if (size < SII_MIN_SIZE)
+		return SIITOOL_ERROR_FORMAT;
+
+	/* parsed in place, the categories are bounds checked */
+	ctx->sii = sii_init_string(input, size);
+
+	if (ctx->sii == NULL)
+		return SIITOOL_ERROR_NOMEM;
+
+	return (ctx->errors > 0) ? SIITOOL_ERROR_PARSE : SIITOOL_OK;
+}
+
+SiitoolContext *siitool_context_new(void)
+{
+	SiitoolContext *ctx = calloc(1, sizeof(SiitoolContext));
+	if (ctx == NULL)
+		return NULL;
+
+	ctx->arena = arena_new();
+	if (ctx->arena == NULL) {
+		free(ctx);
+		return NULL;
+	}
+
+	ctx->device.keys = ESI_SELECT_NUMBER;
+	ctx->device.number = 0;
+
+	esi_library_init();
+
+	return ctx;
+}
+
+void siitool_context_free(SiitoolContext *ctx)
+{
+	if (ctx == NULL)
+		return;
+
+	unload(ctx);
+	arena_free(ctx->arena);
+	free(ctx);
+}
+
+void siitool_set_flags(SiitoolContext *ctx, unsigned int flags)
+{
+	ctx->flags = flags;
+}
+
+int siitool_select_device(SiitoolContext *ctx, const char *selector)
+{
+	struct _esi_device_selector device = { .keys = ESI_SELECT_NUMBER, .number = 0 };
+
+	if (selector == NULL || esi_selector_parse(&device, selector) != 0)
+		return SIITOOL_ERROR_INVALID;
+
+	ctx->device = device;
+
+	return SIITOOL_OK;
+}
+
+int siitool_load(SiitoolContext *ctx, const unsigned char *input, size_t size)
+{
+	const unsigned char *start = input;
+	const unsigned char *end = input + size;
+	int ret;
+
+	if (ctx == NULL || input == NULL || size == 0)
+		return SIITOOL_ERROR_INVALID;
+
+	call_begin(ctx);
+	unload(ctx);
+
+	/* skip byte order mark and leading white space of an XML document */
+	if (size >= 3 && memcmp(start, "\xef\xbb\xbf", 3) == 0)
+		start += 3;
+
+	while (start < end && isspace(*start))
+		start++;
+
+	if ((size_t)(end - start) >= 5 && strncmp((const char *)start, "<?xml", 5) == 0)
+		ret = load_esi(ctx, start, (size_t)(end - start));
+	else
+		ret = load_sii(ctx, input, size);
+
+	if (ret != SIITOOL_OK)
+		unload(ctx);
+
+	return call_end(ctx, ret);
+}
+
+/* with SIITOOL_FIT_EEPROM the optional content which doesn't fit is
+ * dropped, returns whether the PDO mapping is still written */
+static unsigned int pdo_mapping(SiitoolContext *ctx)
+{
+	unsigned int add_pdo_mapping = (ctx->flags & SIITOOL_PDO_MAPPING) != 0;
+
+	if (ctx->flags & SIITOOL_FIT_EEPROM)
+		sii_optimize(ctx->sii, &add_pdo_mapping, (ctx->flags & SIITOOL_DC_CONFIG) != 0);
+
+	return add_pdo_mapping;
+}
+
+int siitool_generate(SiitoolContext *ctx, const unsigned char **image, size_t *size)
+{
+	if (ctx == NULL || image == NULL || size == NULL)
+		return SIITOOL_ERROR_INVALID;
+
+	if (ctx->sii == NULL || ctx->sii->config == NULL)
+		return SIITOOL_ERROR_INVALID;
+
+	call_begin(ctx);
+
+	unsigned int add_pdo_mapping = pdo_mapping(ctx);
+
+	size_t written = sii_generate(ctx->sii, add_pdo_mapping, (ctx->flags & SIITOOL_DC_CONFIG) != 0);
+
+	if (written == 0 || ctx->errors > 0)
+		return call_end(ctx, SIITOOL_ERROR_GENERATE);
+
+	*image = ctx->sii->rawbytes;
+	*size = ctx->sii->rawsize;
+
+	return call_end(ctx, SIITOOL_OK);
+}
+
+int siitool_generate_into(SiitoolContext *ctx, unsigned char *buf, size_t size, size_t *required)
+{
+	if (ctx == NULL || required == NULL)
+		return SIITOOL_ERROR_INVALID;
+
+	if (ctx->sii == NULL || ctx->sii->config == NULL)
+		return SIITOOL_ERROR_INVALID;
+
+	call_begin(ctx);
+
+	unsigned int add_pdo_mapping = pdo_mapping(ctx);
+
+	size_t need = sii_generate_into(ctx->sii, add_pdo_mapping,
+			(ctx->flags & SIITOOL_DC_CONFIG) != 0, buf, size);
+
+	if (need == 0 || ctx->errors > 0)
+		return call_end(ctx, SIITOOL_ERROR_GENERATE);
+
+	*required = need;
+
+	if (buf == NULL || size < need)
+		return call_end(ctx, SIITOOL_ERROR_SIZE);
+
+	return call_end(ctx, SIITOOL_OK);
+}
+
+int siitool_layout(SiitoolContext *ctx, struct _sii_layout *layout)
+{
+	if (ctx == NULL || layout == NULL)
+		return SIITOOL_ERROR_INVALID;
+
+	if (ctx->sii == NULL || ctx->sii->config == NULL)
+		return SIITOOL_ERROR_INVALID;
+
+	call_begin(ctx);
+
+	int ret = sii_layout(ctx->sii, (ctx->flags & SIITOOL_PDO_MAPPING) != 0,
+			(ctx->flags & SIITOOL_DC_CONFIG) != 0, layout);
+
+	return call_end(ctx, ret == 0 ? SIITOOL_OK : SIITOOL_ERROR_SIZE);
+}
+
+int siitool_print(SiitoolContext *ctx, FILE *f)
+{
+	if (ctx == NULL || ctx->sii == NULL || f == NULL)
+		return SIITOOL_ERROR_INVALID;
+
+	call_begin(ctx);
+	sii_fprint(f, ctx->sii);
+
+	return call_end(ctx, SIITOOL_OK);
+}
+
+SiiInfo *siitool_sii(SiitoolContext *ctx)
+{
+	return ctx->sii;
+}
+
+const char *siitool_message(const SiitoolContext *ctx)
+{
+	return ctx->message;
+}
+
+const char *siitool_strerror(int error)
+{
+	switch (error) {
+	case SIITOOL_OK:
+		return "success";
+	case SIITOOL_ERROR_NOMEM:
+		return "out of memory";
+	case SIITOOL_ERROR_INVALID:
+		return "invalid argument";
+	case SIITOOL_ERROR_FORMAT:
+		return "input is neither ESI nor SII";
+	case SIITOOL_ERROR_PARSE:
+		return "malformed input";
+	case SIITOOL_ERROR_DEVICE:
+		return "device not found";
+	case SIITOOL_ERROR_GENERATE:
+		return "couldn't generate SII";
+	case SIITOOL_ERROR_SIZE:
+		return "buffer too small";
+	default:
+		break;
+	}
+
+	return "unknown error";
+}
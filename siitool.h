@@ -0,0 +1,103 @@
+/* siitool - library interface
+ *
+ * A SiitoolContext holds the settings, the loaded SII and the messages of
+ * one user. Nothing is printed, the functions return a SIITOOL_ERROR_* code
+ * and the messages of the last call are available from siitool_message().
+ *
+ * Different contexts can be used from different threads at the same time,
+ * a single context must only be used by one thread at a time.
+ */
+
+#ifndef SIITOOL_H
+#define SIITOOL_H
+
+#include "sii.h"
+#include "esi.h"
+
+#include <stdio.h>
+#include <stddef.h>
+
+enum eSiitoolError {
+	SIITOOL_OK = 0
+	,SIITOOL_ERROR_NOMEM = -1     /* out of memory */
+	,SIITOOL_ERROR_INVALID = -2   /* invalid argument or call order */
+	,SIITOOL_ERROR_FORMAT = -3    /* input is neither ESI nor SII */
+	,SIITOOL_ERROR_PARSE = -4     /* malformed ESI or SII */
+	,SIITOOL_ERROR_DEVICE = -5    /* selected device not found */
+	,SIITOOL_ERROR_GENERATE = -6  /* SII binary couldn't be generated */
+	,SIITOOL_ERROR_SIZE = -7      /* buffer too small */
+};
+
+/* flags for siitool_set_flags() */
+#define SIITOOL_PDO_MAPPING   0x01  /* write the PDO mapping */
+#define SIITOOL_DC_CONFIG     0x02  /* write the DC configuration */
+#define SIITOOL_STREAM        0x04  /* stream ESI input, see esi_init_stream() */
+#define SIITOOL_FIT_EEPROM    0x08  /* drop optional content to fit, see sii_optimize() */
+#define SIITOOL_STARTUP_ORDER 0x10  /* ESI categories in SII_ORDER_STARTUP */
+
+typedef struct _siitool_context SiitoolContext;
+
+SiitoolContext *siitool_context_new(void);
+void siitool_context_free(SiitoolContext *ctx);
+
+void siitool_set_flags(SiitoolContext *ctx, unsigned int flags);
+
+/* select the ESI device, same syntax as esi_selector_parse(), default is
+ * device number 0 */
+int siitool_select_device(SiitoolContext *ctx, const char *selector);
+
+/**
+ * \brief Load an ESI or SII from memory
+ *
+ * The type is recognized from the content. For ESI input the selected
+ * device is parsed. A previously loaded SII is released. The input is
+ * not referenced after the call returns.
+ *
+ * \return SIITOOL_OK or a negative SIITOOL_ERROR_* code
+ */
+int siitool_load(SiitoolContext *ctx, const unsigned char *input, size_t size);
+
+/**
+ * \brief Generate the SII binary of the loaded input
+ *
+ * \param image  set to the binary, owned by ctx and valid until the next
+ *               load or siitool_context_free()
+ * \param size   set to the size of the binary in bytes
+ * \return SIITOOL_OK or a negative SIITOOL_ERROR_* code
+ */
+int siitool_generate(SiitoolContext *ctx, const unsigned char **image, size_t *size);
+
+/**
+ * \brief Generate the SII binary into a caller provided buffer
+ *
+ * Nothing is allocated, see sii_generate_into(). Call with buf == NULL to
+ * query the size.
+ *
+ * \param required  set to the size of the binary in bytes
+ * \return SIITOOL_OK, SIITOOL_ERROR_SIZE if buf is NULL or smaller than
+ *         required, or another negative SIITOOL_ERROR_* code
+ */
+int siitool_generate_into(SiitoolContext *ctx, unsigned char *buf, size_t size, size_t *required);
+
+/**
+ * \brief Layout of the SII binary of the loaded input, see sii_layout()
+ *
+ * Nothing is generated, meant to size check many inputs.
+ *
+ * \return SIITOOL_OK, SIITOOL_ERROR_SIZE if the binary doesn't fit into
+ *         the EEPROM, or another negative SIITOOL_ERROR_* code
+ */
+int siitool_layout(SiitoolContext *ctx, struct _sii_layout *layout);
+
+/* human readable content of the loaded SII, like `siitool -p` */
+int siitool_print(SiitoolContext *ctx, FILE *f);
+
+/* the loaded SII, owned by ctx, NULL if nothing is loaded */
+SiiInfo *siitool_sii(SiitoolContext *ctx);
+
+/* errors and warnings of the last call, empty string if there were none */
+const char *siitool_message(const SiitoolContext *ctx);
+
+const char *siitool_strerror(int error);
+
+#endif /* SIITOOL_H */
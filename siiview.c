@@ -0,0 +1,172 @@
+/* siiview - read only view of a SII image
+ */
+
+#include "siiview.h"
+#include "sii.h"
+#include "crc8.h"
+
+#define SII_VIEW_HEADER_SIZE  4
+
+int sii_view_init(SiiView *view, const uint8_t *buffer, size_t size)
+{
+	view->data = buffer;
+	view->size = 0;
+
+	if (buffer == NULL || size < SII_CAT_OFFSET)
+		return -1;
+
+	/* a dump of the whole EEPROM may be larger than the image, a truncated
+	 * file smaller */
+	size_t eeprom = EE_TO_BYTES((size_t)BYTES_TO_WORD(buffer[SII_VIEW_EEPROM_OFFSET],
+				buffer[SII_VIEW_EEPROM_OFFSET+1]));
+	view->size = (eeprom < size) ? eeprom : size;
+
+	return 0;
+}
+
+uint16_t sii_view_word(const SiiView *view, size_t offset)
+{
+	if (offset + 2 > view->size)
+		return 0;
+
+	const uint8_t *b = view->data + offset;
+	return (uint16_t)BYTES_TO_WORD(b[0], b[1]);
+}
+
+uint32_t sii_view_dword(const SiiView *view, size_t offset)
+{
+	if (offset + 4 > view->size)
+		return 0;
+
+	const uint8_t *b = view->data + offset;
+	return BYTES_TO_DWORD(b[0], b[1], b[2], b[3]);
+}
+
+uint16_t sii_view_alias(const SiiView *view)
+{
+	return sii_view_word(view, SII_ALIAS_OFFSET);
+}
+
+uint32_t sii_view_vendor_id(const SiiView *view)
+{
+	return sii_view_dword(view, SII_VIEW_VENDOR_OFFSET);
+}
+
+uint32_t sii_view_product_id(const SiiView *view)
+{
+	return sii_view_dword(view, SII_VIEW_PRODUCT_OFFSET);
+}
+
+uint32_t sii_view_revision_id(const SiiView *view)
+{
+	return sii_view_dword(view, SII_VIEW_REVISION_OFFSET);
+}
+
+uint32_t sii_view_serial(const SiiView *view)
+{
+	return sii_view_dword(view, SII_SERIAL_OFFSET);
+}
+
+int sii_view_checksum_ok(const SiiView *view)
+{
+	if (view->size < SII_CHECKSUM_OFFSET + 2)
+		return 0;
+
+	return crc8_final(crc8_update(crc8_init(), view->data, SII_CHECKSUM_OFFSET + 2)) == 0;
+}
+
+int sii_view_next(const SiiView *view, struct _sii_view_cat *cat)
+{
+	size_t offset = SII_CAT_OFFSET;
+	if (cat->offset != 0)
+		offset = cat->offset + SII_VIEW_HEADER_SIZE + cat->size;
+
+	/* the end marker is a single word */
+	if (offset + 2 > view->size)
+		return -1;
+
+	uint16_t type = sii_view_word(view, offset);
+	if (type == SII_END)
+		return 0;
+
+	if (offset + SII_VIEW_HEADER_SIZE > view->size)
+		return -1;
+
+	size_t size = (size_t)sii_view_word(view, offset + 2) * 2;
+	if (size > view->size - offset - SII_VIEW_HEADER_SIZE)
+		return -1;
+
+	cat->type = type & 0x7fff;
+	cat->vendor = (type >> 15) & 0x1;
+	cat->offset = offset;
+	cat->size = size;
+	cat->data = view->data + offset + SII_VIEW_HEADER_SIZE;
+
+	return 1;
+}
+
+int sii_view_find(const SiiView *view, uint16_t type, struct _sii_view_cat *cat)
+{
+	int ret;
+
+	cat->offset = 0;
+	while ((ret = sii_view_next(view, cat)) > 0) {
+		if (cat->type == type && !cat->vendor)
+			return 1;
+	}
+
+	return ret;
+}
+
+unsigned int sii_view_validate(const SiiView *view)
+{
+	struct _sii_view_cat cat = { .offset = 0 };
+	unsigned int status = 0;
+	int ret;
+
+	if (!sii_view_checksum_ok(view))
+		status |= SII_VIEW_BAD_CHECKSUM;
+
+	while ((ret = sii_view_next(view, &cat)) > 0)
+		;
+
+	if (ret < 0) {
+		/* header of the category after the last valid one */
+		size_t next = SII_CAT_OFFSET;
+		if (cat.offset != 0)
+			next = cat.offset + SII_VIEW_HEADER_SIZE + cat.size;
+
+		status |= (next + SII_VIEW_HEADER_SIZE > view->size) ? SII_VIEW_NO_END : SII_VIEW_BAD_CHAIN;
+	}
+
+	return status;
+}
+
+const char *sii_view_string(const SiiView *view, unsigned int index, size_t *length)
+{
+	struct _sii_view_cat cat = { .offset = 0 };
+
+	if (index == 0 || sii_view_find(view, SII_CAT_STRINGS, &cat) != 1 || cat.size == 0)
+		return NULL;
+
+	const uint8_t *b = cat.data;
+	const uint8_t *end = cat.data + cat.size;
+
+	if (index > *b++)
+		return NULL;
+
+	for (unsigned int i = 1; b < end; i++) {
+		size_t len = *b++;
+		if (len > (size_t)(end - b))
+			return NULL;
+
+		if (i == index) {
+			*length = len;
+			return (const char *)b;
+		}
+
+		b += len;
+	}
+
+	return NULL;
+}
@@ -0,0 +1,87 @@
+/* siiview - read only view of a SII image
+ *
+ * The view borrows the image, e.g. a mapped file, and walks the category
+ * headers in place. Nothing is copied or allocated, a single category is
+ * decoded on demand with sii_view_decode(). Every access is checked
+ * against the image size, which is the smaller of the buffer size and the
+ * EEPROM size of the std config.
+ */
+
+#ifndef SIIVIEW_H
+#define SIIVIEW_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define SII_VIEW_VENDOR_OFFSET    16
+#define SII_VIEW_PRODUCT_OFFSET   20
+#define SII_VIEW_REVISION_OFFSET  24
+#define SII_VIEW_EEPROM_OFFSET    124  /* eeprom size of the std config */
+
+typedef struct _sii_view {
+	const uint8_t *data;
+	size_t size;
+} SiiView;
+
+/* one category of the image, offset 0 before the first category */
+struct _sii_view_cat {
+	uint16_t type;   /* without the vendor bit */
+	uint16_t vendor; /* vendor specific category */
+	size_t offset;   /* of the category header */
+	size_t size;     /* bytes of data after the header */
+	const uint8_t *data;
+};
+
+/**
+ * \brief Init a view of the image in buffer
+ *
+ * The buffer must stay valid as long as the view is used.
+ *
+ * \return 0 on success, -1 if buffer is too short for preamble and std config
+ */
+int sii_view_init(SiiView *view, const uint8_t *buffer, size_t size);
+
+/* little endian values of the image, 0 outside of the image */
+uint16_t sii_view_word(const SiiView *view, size_t offset);
+uint32_t sii_view_dword(const SiiView *view, size_t offset);
+
+uint16_t sii_view_alias(const SiiView *view);
+uint32_t sii_view_vendor_id(const SiiView *view);
+uint32_t sii_view_product_id(const SiiView *view);
+uint32_t sii_view_revision_id(const SiiView *view);
+uint32_t sii_view_serial(const SiiView *view);
+
+/* 1 if the crc8 of the preamble is correct */
+int sii_view_checksum_ok(const SiiView *view);
+
+/* result of sii_view_validate() */
+#define SII_VIEW_BAD_CHECKSUM  0x01  /* crc8 of the preamble is wrong */
+#define SII_VIEW_BAD_CHAIN     0x02  /* a category exceeds the image */
+#define SII_VIEW_NO_END        0x04  /* no end marker before the end of the image */
+
+/* check preamble checksum and category chain, 0 if the image is valid */
+unsigned int sii_view_validate(const SiiView *view);
+
+/**
+ * \brief Advance cat to the next category
+ *
+ * Start with a zeroed cat to get the first category.
+ *
+ * \return 1 for a category, 0 at the end marker, -1 if the header or the
+ *         data of the next category exceeds the image
+ */
+int sii_view_next(const SiiView *view, struct _sii_view_cat *cat);
+
+/* first category of type, same return values as sii_view_next() */
+int sii_view_find(const SiiView *view, uint16_t type, struct _sii_view_cat *cat);
+
+/**
+ * \brief String index of the Strings category, the first string is 1
+ *
+ * The string is not NUL terminated, its length is written to length.
+ *
+ * \return pointer into the image, NULL if there is no such string
+ */
+const char *sii_view_string(const SiiView *view, unsigned int index, size_t *length);
+
+#endif /* SIIVIEW_H */